@@ -0,0 +1,798 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/sem.h>
+#include <sys/msg.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "ticket_ring.h"
+#include "submit_queue.h"
+#include "config.h"
+#include "shm_sync.h"
+
+// Micro-benchmark dei percorsi critici della simulazione, eseguito su risorse
+// IPC private (IPC_PRIVATE) così da non interferire con una simulazione in
+// corso. Uso: ./benchmark queue [produttori] [consumatori] [ticket]
+//             ./benchmark submit [utenti] [richieste per utente]
+//             ./benchmark layout [processi] [iterazioni]
+//             ./benchmark lock [processi] [sezioni critiche per processo]
+//             ./benchmark recorder [processi] [eventi per processo]
+//
+// queue: coda di un servizio con processi produttori (il processo ticket) e
+// consumatori (gli operatori). Confronta il percorso a semafori usato prima
+// dei ring (SEM_QUEUE in accodamento, lock del servizio con SEM_UNDO in
+// estrazione) con il ring lock-free di ticket_ring.h.
+//
+// submit: invio di una richiesta di ticket dagli utenti al processo ticket.
+// Misura la latenza dall'invio alla ricezione da parte del processo ticket
+// con la coda di messaggi SysV (con e senza la usleep(1000) che precedeva
+// msgsnd in request_ticket) e con la coda di invio di submit_queue.h. Gli
+// utenti inviano a intervalli, così il processo ticket si addormenta e la
+// misura comprende anche il suo risveglio.
+//
+// layout: contatori dei ticket per servizio aggiornati in parallelo, ogni
+// processo sul proprio servizio come i worker ticket. Confronta gli array
+// paralleli usati prima in SharedMemory (i contatori di servizi diversi
+// condividono le linee di cache) con ServiceTicketing di config.h (una linea
+// per servizio). Riporta i ns per aggiornamento e, se il kernel espone i
+// contatori hardware (perf_event_open), i cache miss dei processi.
+//
+// lock: sezione critica breve (un incremento) eseguita da più processi, come
+// gli aggiornamenti degli indici degli sportelli. Confronta il semaforo SysV
+// usato come mutex (semop, con e senza SEM_UNDO) con il mutex pthread
+// condiviso e robusto di shm_sync.h. Con un solo processo misura il caso
+// senza contesa, in cui il mutex non entra nel kernel.
+//
+// recorder: costo di un evento del registratore di volo (flight_recorder.h)
+// con più processi che registrano nello stesso ring, come durante la
+// giornata. Riporta il tempo di CPU per evento e verifica che nessun evento
+// vada perso; conta gli slot finali non leggibili (vedi flight_recorder.h).
+
+#define BENCH_QUEUE_CAPACITY 4096   // Potenza di due, come queue_capacity
+#define BENCH_MAX_PROCS 64
+#define BENCH_MAX_REQUESTS 65536    // Richieste totali del caso submit
+#define BENCH_SUBMIT_INTERVAL_NS 100000L // Pausa tra due richieste dello stesso utente
+#define BENCH_RECORDER_CAPACITY 65536   // Come il default di FLIGHT_RECORDER_EVENTS
+
+// Coda circolare protetta da semafori (come le code prima dei ring)
+typedef struct {
+    int head;
+    int tail;
+    int waiting;
+    int values[BENCH_QUEUE_CAPACITY];
+} SemQueue;
+
+typedef struct {
+    TicketRing ring;
+    RingCell cells[BENCH_QUEUE_CAPACITY];
+} LockFreeQueue;
+
+// Area condivisa tra i processi del benchmark
+typedef struct {
+    SemQueue sem_queue;
+    LockFreeQueue ring_queue;
+    long consumed_sum[BENCH_MAX_PROCS];     // Somma dei valori estratti da ogni consumatore
+    long consumed_count[BENCH_MAX_PROCS];
+    long consumed_total;                    // Ticket estratti da tutti i consumatori
+
+    SubmitQueue submit_queue;
+    RingCell submit_cells[BENCH_QUEUE_CAPACITY];
+    struct timespec submit_time[BENCH_MAX_REQUESTS]; // Istante di invio di ogni richiesta
+    long latency_sum_ns;                    // Latenze misurate dal consumatore
+    long latency_max_ns;
+    long received;
+    pthread_mutex_t lock_mutex;             // Lock del caso lock (shm_sync.h)
+    long lock_counter;                      // Incrementato nella sezione critica
+} BenchShared;
+
+// Contatori dei ticket come erano in SharedMemory: array paralleli, gli
+// elementi di servizi diversi stanno sulle stesse linee di cache
+typedef struct {
+    int next_service_ticket[SERVICE_COUNT];
+    int daily_tickets_issued[SERVICE_COUNT];
+    atomic_int daily_operator_wakeups[SERVICE_COUNT];
+    atomic_int total_operator_wakeups[SERVICE_COUNT];
+} PackedTicketing;
+
+// Area del caso layout (allineata alla linea di cache dalla shmat)
+typedef struct {
+    PackedTicketing packed;
+    ServiceTicketing padded[SERVICE_COUNT] CACHE_ALIGNED;
+} LayoutShared;
+
+// Messaggio del caso submit (come il vecchio messaggio di richiesta ticket)
+typedef struct {
+    long mtype;
+    int request_index;
+} BenchMsg;
+
+#define SUBMIT_MSG_SLEEP 0          // usleep(1000) + msgsnd (vecchio request_ticket)
+#define SUBMIT_MSG 1                // Solo msgsnd
+#define SUBMIT_RING 2               // Coda di invio in memoria condivisa
+
+#define LOCK_SEMOP 0                // semop senza SEM_UNDO (come SEM_COUNTERS)
+#define LOCK_SEMOP_UNDO 1           // semop con SEM_UNDO (come i lock dei servizi)
+#define LOCK_MUTEX 2                // Mutex pthread condiviso e robusto
+
+#define SEM_BENCH_QUEUE 0           // Ruolo di SEM_QUEUE
+#define SEM_BENCH_SERVICE 1         // Ruolo di SEM_SERVICE_LOCK(service)
+
+BenchShared *bench = NULL;
+int bench_semid = -1;
+int bench_msgid = -1;
+
+long elapsed_ns(struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1000000000L + (end->tv_nsec - start->tv_nsec);
+}
+
+void sem_change(int sem_num, int delta, int flags)
+{
+    struct sembuf op = {.sem_num = sem_num, .sem_op = delta, .sem_flg = flags};
+    while (semop(bench_semid, &op, 1) < 0 && errno == EINTR) {
+    }
+}
+
+// Produttore sul percorso a semafori: accodamento sotto SEM_QUEUE
+void sem_producer(int first, int count)
+{
+    SemQueue *q = &bench->sem_queue;
+    for (int i = 0; i < count; i++) {
+        for (;;) {
+            sem_change(SEM_BENCH_QUEUE, -1, 0);
+            if (q->waiting < BENCH_QUEUE_CAPACITY) {
+                break;
+            }
+            sem_change(SEM_BENCH_QUEUE, 1, 0);
+            sched_yield(); // Coda piena
+        }
+        q->values[q->tail] = first + i;
+        q->tail = (q->tail + 1) % BENCH_QUEUE_CAPACITY;
+        __atomic_add_fetch(&q->waiting, 1, __ATOMIC_RELEASE);
+        sem_change(SEM_BENCH_QUEUE, 1, 0);
+    }
+}
+
+// Consumatore sul percorso a semafori: controllo senza lock e poi
+// estrazione sotto il lock del servizio, come serve_customer()
+void sem_consumer(int id, long total)
+{
+    SemQueue *q = &bench->sem_queue;
+    while (__atomic_load_n(&bench->consumed_total, __ATOMIC_ACQUIRE) < total) {
+        if (__atomic_load_n(&q->waiting, __ATOMIC_ACQUIRE) <= 0) {
+            sched_yield();
+            continue;
+        }
+        sem_change(SEM_BENCH_SERVICE, -1, SEM_UNDO);
+        int value = -1;
+        if (q->waiting > 0) {
+            value = q->values[q->head];
+            q->head = (q->head + 1) % BENCH_QUEUE_CAPACITY;
+            __atomic_sub_fetch(&q->waiting, 1, __ATOMIC_RELEASE);
+        }
+        sem_change(SEM_BENCH_SERVICE, 1, SEM_UNDO);
+        if (value >= 0) {
+            bench->consumed_sum[id] += value;
+            bench->consumed_count[id]++;
+            __atomic_add_fetch(&bench->consumed_total, 1, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+void ring_producer(int first, int count)
+{
+    LockFreeQueue *q = &bench->ring_queue;
+    for (int i = 0; i < count; i++) {
+        while (!ring_push(&q->ring, q->cells, first + i)) {
+            sched_yield(); // Coda piena
+        }
+    }
+}
+
+void ring_consumer(int id, long total)
+{
+    LockFreeQueue *q = &bench->ring_queue;
+    while (__atomic_load_n(&bench->consumed_total, __ATOMIC_ACQUIRE) < total) {
+        int value;
+        if (!ring_pop(&q->ring, q->cells, &value)) {
+            sched_yield();
+            continue;
+        }
+        bench->consumed_sum[id] += value;
+        bench->consumed_count[id]++;
+        __atomic_add_fetch(&bench->consumed_total, 1, __ATOMIC_RELEASE);
+    }
+}
+
+// Esegue un percorso con processi separati e restituisce i ns per ticket
+// (-1 se la verifica dei valori estratti fallisce)
+double run_queue_case(int use_ring, int producers, int consumers, int tickets)
+{
+    memset(bench, 0, sizeof(*bench));
+    ring_init(&bench->ring_queue.ring, bench->ring_queue.cells, BENCH_QUEUE_CAPACITY);
+    unsigned short init_values[2] = {1, 1};
+    union semun {
+        int val;
+        struct semid_ds *buf;
+        unsigned short *array;
+    } arg;
+    arg.array = init_values;
+    semctl(bench_semid, 0, SETALL, arg);
+
+    int per_producer = tickets / producers;
+    long total = (long)per_producer * producers;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (int c = 0; c < consumers; c++) {
+        if (fork() == 0) {
+            use_ring ? ring_consumer(c, total) : sem_consumer(c, total);
+            _exit(0);
+        }
+    }
+    for (int p = 0; p < producers; p++) {
+        if (fork() == 0) {
+            use_ring ? ring_producer(p * per_producer, per_producer) : sem_producer(p * per_producer, per_producer);
+            _exit(0);
+        }
+    }
+    while (wait(NULL) > 0) {
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // Ogni valore 0..total-1 deve essere stato estratto esattamente una volta
+    long sum = 0, count = 0;
+    for (int c = 0; c < consumers; c++) {
+        sum += bench->consumed_sum[c];
+        count += bench->consumed_count[c];
+    }
+    if (count != total || sum != total * (total - 1) / 2) {
+        return -1;
+    }
+    return (double)elapsed_ns(&start, &end) / total;
+}
+
+int bench_queue(int argc, char *argv[])
+{
+    int producers = argc > 2 ? atoi(argv[2]) : 1;
+    int consumers = argc > 3 ? atoi(argv[3]) : 4;
+    int tickets = argc > 4 ? atoi(argv[4]) : 1000000;
+    if (producers < 1 || consumers < 1 || producers + consumers >= BENCH_MAX_PROCS || tickets < producers) {
+        fprintf(stderr, "Parametri non validi\n");
+        return 1;
+    }
+
+    int shmid = shmget(IPC_PRIVATE, sizeof(BenchShared), IPC_CREAT | 0600);
+    bench_semid = semget(IPC_PRIVATE, 2, IPC_CREAT | 0600);
+    if (shmid < 0 || bench_semid < 0) {
+        perror("benchmark: risorse IPC");
+        return 1;
+    }
+    bench = shmat(shmid, NULL, 0);
+    shmctl(shmid, IPC_RMID, NULL); // Rimosso al detach dell'ultimo processo
+
+    printf("=== Coda di servizio: %d produttori, %d consumatori, %d ticket ===\n", producers, consumers, tickets);
+    double sem_ns = run_queue_case(0, producers, consumers, tickets);
+    double ring_ns = run_queue_case(1, producers, consumers, tickets);
+
+    printf("%-28s %12s\n", "Percorso", "ns/ticket");
+    printf("%-28s %12.1f\n", "Semafori (semop)", sem_ns);
+    printf("%-28s %12.1f\n", "Ring lock-free", ring_ns);
+    if (sem_ns > 0 && ring_ns > 0) {
+        printf("Speedup: %.2fx\n", sem_ns / ring_ns);
+    }
+
+    shmdt(bench);
+    semctl(bench_semid, 0, IPC_RMID);
+    if (sem_ns < 0 || ring_ns < 0) {
+        fprintf(stderr, "benchmark: verifica dei ticket estratti fallita\n");
+        return 1;
+    }
+    return 0;
+}
+
+// Utente del caso submit: invia count richieste a partire da first
+void submit_producer(int mode, int first, int count)
+{
+    struct timespec pause = {.tv_sec = 0, .tv_nsec = BENCH_SUBMIT_INTERVAL_NS};
+
+    for (int i = 0; i < count; i++) {
+        int request_index = first + i;
+        clock_gettime(CLOCK_MONOTONIC, &bench->submit_time[request_index]);
+
+        if (mode == SUBMIT_RING) {
+            while (!submit_queue_push(&bench->submit_queue, bench->submit_cells, request_index)) {
+                sched_yield(); // Coda piena
+            }
+        } else {
+            if (mode == SUBMIT_MSG_SLEEP) {
+                usleep(1000);
+            }
+            BenchMsg msg = {.mtype = 1, .request_index = request_index};
+            while (msgsnd(bench_msgid, &msg, sizeof(msg) - sizeof(long), 0) < 0 && errno == EINTR) {
+            }
+        }
+        nanosleep(&pause, NULL);
+    }
+}
+
+void submit_record_latency(int request_index)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long latency = elapsed_ns(&bench->submit_time[request_index], &now);
+    bench->latency_sum_ns += latency;
+    if (latency > bench->latency_max_ns) {
+        bench->latency_max_ns = latency;
+    }
+    bench->received++;
+}
+
+// Processo ticket del caso submit: riceve total richieste
+void submit_consumer(int mode, long total)
+{
+    volatile int keep_waiting = 1;
+    int batch[32];
+
+    while (bench->received < total) {
+        if (mode == SUBMIT_RING) {
+            int count = submit_queue_drain(&bench->submit_queue, bench->submit_cells, batch, 32);
+            if (count == 0) {
+                submit_queue_wait(&bench->submit_queue, &keep_waiting);
+            }
+            for (int i = 0; i < count; i++) {
+                submit_record_latency(batch[i]);
+            }
+        } else {
+            BenchMsg msg;
+            if (msgrcv(bench_msgid, &msg, sizeof(msg) - sizeof(long), 1, 0) > 0) {
+                submit_record_latency(msg.request_index);
+            }
+        }
+    }
+}
+
+// Esegue un caso submit e restituisce la latenza media in ns
+// (-1 se non tutte le richieste sono arrivate)
+double run_submit_case(int mode, int producers, int per_producer, double *max_us)
+{
+    memset(bench, 0, sizeof(*bench));
+    submit_queue_init(&bench->submit_queue, bench->submit_cells, BENCH_QUEUE_CAPACITY);
+    long total = (long)producers * per_producer;
+
+    if (fork() == 0) {
+        submit_consumer(mode, total);
+        _exit(0);
+    }
+    for (int p = 0; p < producers; p++) {
+        if (fork() == 0) {
+            submit_producer(mode, p * per_producer, per_producer);
+            _exit(0);
+        }
+    }
+    while (wait(NULL) > 0) {
+    }
+
+    if (bench->received != total) {
+        return -1;
+    }
+    *max_us = bench->latency_max_ns / 1000.0;
+    return (double)bench->latency_sum_ns / total;
+}
+
+int bench_submit(int argc, char *argv[])
+{
+    int producers = argc > 2 ? atoi(argv[2]) : 4;
+    int per_producer = argc > 3 ? atoi(argv[3]) : 2000;
+    if (producers < 1 || per_producer < 1 || producers >= BENCH_MAX_PROCS ||
+        (long)producers * per_producer > BENCH_MAX_REQUESTS) {
+        fprintf(stderr, "Parametri non validi\n");
+        return 1;
+    }
+
+    int shmid = shmget(IPC_PRIVATE, sizeof(BenchShared), IPC_CREAT | 0600);
+    bench_msgid = msgget(IPC_PRIVATE, IPC_CREAT | 0600);
+    if (shmid < 0 || bench_msgid < 0) {
+        perror("benchmark: risorse IPC");
+        return 1;
+    }
+    bench = shmat(shmid, NULL, 0);
+    shmctl(shmid, IPC_RMID, NULL); // Rimosso al detach dell'ultimo processo
+
+    printf("=== Invio richieste: %d utenti, %d richieste ciascuno ===\n", producers, per_producer);
+    const char *names[] = {"usleep(1000) + msgsnd", "msgsnd", "Coda di invio (futex)"};
+    double avg_ns[3], max_us[3];
+    int failed = 0;
+
+    printf("%-28s %16s %16s\n", "Percorso", "media (us)", "massimo (us)");
+    for (int mode = SUBMIT_MSG_SLEEP; mode <= SUBMIT_RING; mode++) {
+        avg_ns[mode] = run_submit_case(mode, producers, per_producer, &max_us[mode]);
+        if (avg_ns[mode] < 0) {
+            failed = 1;
+            continue;
+        }
+        printf("%-28s %16.1f %16.1f\n", names[mode], avg_ns[mode] / 1000.0, max_us[mode]);
+    }
+    if (!failed) {
+        printf("Riduzione della latenza rispetto a request_ticket con usleep: %.1fx\n",
+               avg_ns[SUBMIT_MSG_SLEEP] / avg_ns[SUBMIT_RING]);
+    }
+
+    shmdt(bench);
+    msgctl(bench_msgid, IPC_RMID, NULL);
+    if (failed) {
+        fprintf(stderr, "benchmark: richieste perse\n");
+        return 1;
+    }
+    return 0;
+}
+
+// Processo del caso lock: count sezioni critiche con il lock indicato
+void lock_worker(int mode, long count)
+{
+    for (long i = 0; i < count; i++) {
+        if (mode == LOCK_MUTEX) {
+            shm_mutex_lock(&bench->lock_mutex, "benchmark");
+            bench->lock_counter++;
+            shm_mutex_unlock(&bench->lock_mutex);
+        } else {
+            int flags = mode == LOCK_SEMOP_UNDO ? SEM_UNDO : 0;
+            sem_change(SEM_BENCH_SERVICE, -1, flags);
+            bench->lock_counter++;
+            sem_change(SEM_BENCH_SERVICE, 1, flags);
+        }
+    }
+}
+
+// Esegue un tipo di lock con processi separati e restituisce i ns per
+// sezione critica (-1 se il contatore finale non torna: lock non esclusivo)
+double run_lock_case(int mode, int processes, long per_process)
+{
+    bench->lock_counter = 0;
+    shm_mutex_init(&bench->lock_mutex);
+    semctl(bench_semid, SEM_BENCH_SERVICE, SETVAL, 1);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int p = 0; p < processes; p++) {
+        if (fork() == 0) {
+            lock_worker(mode, per_process);
+            _exit(0);
+        }
+    }
+    while (wait(NULL) > 0) {
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    pthread_mutex_destroy(&bench->lock_mutex);
+
+    long total = per_process * processes;
+    if (bench->lock_counter != total) {
+        return -1;
+    }
+    return (double)elapsed_ns(&start, &end) / total;
+}
+
+int bench_lock(int argc, char *argv[])
+{
+    int processes = argc > 2 ? atoi(argv[2]) : 4;
+    long per_process = argc > 3 ? atol(argv[3]) : 200000;
+    if (processes < 1 || processes >= BENCH_MAX_PROCS || per_process < 1) {
+        fprintf(stderr, "Parametri non validi\n");
+        return 1;
+    }
+
+    int shmid = shmget(IPC_PRIVATE, sizeof(BenchShared), IPC_CREAT | 0600);
+    bench_semid = semget(IPC_PRIVATE, 2, IPC_CREAT | 0600);
+    if (shmid < 0 || bench_semid < 0) {
+        perror("benchmark: risorse IPC");
+        return 1;
+    }
+    bench = shmat(shmid, NULL, 0);
+    shmctl(shmid, IPC_RMID, NULL); // Rimosso al detach dell'ultimo processo
+
+    printf("=== Lock: %d processi, %ld sezioni critiche ciascuno ===\n", processes, per_process);
+    const char *names[] = {"semop", "semop + SEM_UNDO", "Mutex robusto (pthread)"};
+    double ns[3];
+    int failed = 0;
+
+    printf("%-28s %16s\n", "Lock", "ns/sezione");
+    for (int mode = LOCK_SEMOP; mode <= LOCK_MUTEX; mode++) {
+        ns[mode] = run_lock_case(mode, processes, per_process);
+        if (ns[mode] < 0) {
+            failed = 1;
+            continue;
+        }
+        printf("%-28s %16.1f\n", names[mode], ns[mode]);
+    }
+    if (!failed) {
+        printf("Speedup rispetto a semop: %.2fx\n", ns[LOCK_SEMOP] / ns[LOCK_MUTEX]);
+    }
+
+    shmdt(bench);
+    semctl(bench_semid, 0, IPC_RMID);
+    if (failed) {
+        fprintf(stderr, "benchmark: sezioni critiche perse\n");
+        return 1;
+    }
+    return 0;
+}
+
+// Aggiornamenti del processo che possiede il servizio: un ticket emesso e un
+// risveglio, come in generate_ticket() e wake_idle_operators()
+void layout_worker(LayoutShared *area, int padded, int service, long iterations)
+{
+    if (padded) {
+        volatile ServiceTicketing *ticketing = &area->padded[service];
+        for (long i = 0; i < iterations; i++) {
+            ticketing->next_ticket++;
+            ticketing->daily_issued++;
+            atomic_fetch_add_explicit(&area->padded[service].daily_operator_wakeups, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&area->padded[service].total_operator_wakeups, 1, memory_order_relaxed);
+        }
+    } else {
+        volatile PackedTicketing *packed = &area->packed;
+        for (long i = 0; i < iterations; i++) {
+            packed->next_service_ticket[service]++;
+            packed->daily_tickets_issued[service]++;
+            atomic_fetch_add_explicit(&area->packed.daily_operator_wakeups[service], 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&area->packed.total_operator_wakeups[service], 1, memory_order_relaxed);
+        }
+    }
+}
+
+// Apre il contatore dei cache miss, ereditato dai processi figli. Ritorna
+// il descrittore o -1 se i contatori hardware non sono disponibili
+int open_cache_miss_counter(void)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// Esegue un layout con processi separati e restituisce i ns per
+// aggiornamento (-1 se i contatori finali non tornano). *misses resta -1
+// senza contatori hardware
+double run_layout_case(LayoutShared *area, int padded, int processes, long iterations, long *misses)
+{
+    memset(area, 0, sizeof(*area));
+    *misses = -1;
+    int perf_fd = open_cache_miss_counter();
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (perf_fd >= 0) {
+        ioctl(perf_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    for (int p = 0; p < processes; p++) {
+        if (fork() == 0) {
+            layout_worker(area, padded, p % SERVICE_COUNT, iterations);
+            _exit(0);
+        }
+    }
+    while (wait(NULL) > 0) {
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // I figli terminati hanno sommato i loro conteggi a quello del padre
+    if (perf_fd >= 0) {
+        long long value = 0;
+        ioctl(perf_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(perf_fd, &value, sizeof(value)) == sizeof(value)) {
+            *misses = value;
+        }
+        close(perf_fd);
+    }
+
+    for (int service = 0; service < SERVICE_COUNT; service++) {
+        long expected = 0;
+        for (int p = service; p < processes; p += SERVICE_COUNT) {
+            expected += iterations;
+        }
+        int issued = padded ? area->padded[service].daily_issued : area->packed.daily_tickets_issued[service];
+        if (issued != (int)expected) {
+            return -1;
+        }
+    }
+    return (double)elapsed_ns(&start, &end) / ((double)iterations * processes);
+}
+
+int bench_layout(int argc, char *argv[])
+{
+    int processes = argc > 2 ? atoi(argv[2]) : SERVICE_COUNT;
+    long iterations = argc > 3 ? atol(argv[3]) : 10000000;
+    if (processes < 1 || processes > SERVICE_COUNT || iterations < 1 || iterations > INT_MAX) {
+        fprintf(stderr, "Parametri non validi (processi: 1-%d)\n", SERVICE_COUNT);
+        return 1;
+    }
+
+    int shmid = shmget(IPC_PRIVATE, sizeof(LayoutShared), IPC_CREAT | 0600);
+    if (shmid < 0) {
+        perror("benchmark: risorse IPC");
+        return 1;
+    }
+    LayoutShared *area = shmat(shmid, NULL, 0);
+    shmctl(shmid, IPC_RMID, NULL); // Rimosso al detach dell'ultimo processo
+
+    printf("=== Contatori dei ticket: %d processi, %ld aggiornamenti ciascuno (CPU: %ld) ===\n",
+           processes, iterations, sysconf(_SC_NPROCESSORS_ONLN));
+    const char *names[] = {"Array paralleli", "ServiceTicketing (padding)"};
+    double ns[2];
+    long misses[2];
+    int failed = 0;
+
+    printf("%-28s %16s %16s\n", "Layout", "ns/aggiornamento", "cache miss");
+    for (int padded = 0; padded <= 1; padded++) {
+        ns[padded] = run_layout_case(area, padded, processes, iterations, &misses[padded]);
+        if (ns[padded] < 0) {
+            failed = 1;
+            continue;
+        }
+        if (misses[padded] >= 0) {
+            printf("%-28s %16.2f %16ld\n", names[padded], ns[padded], misses[padded]);
+        } else {
+            printf("%-28s %16.2f %16s\n", names[padded], ns[padded], "n/d");
+        }
+    }
+    if (!failed) {
+        printf("Speedup: %.2fx\n", ns[0] / ns[1]);
+        if (misses[0] < 0) {
+            printf("Contatori hardware non disponibili (perf_event_open): solo tempi\n");
+        } else if (misses[1] > 0) {
+            printf("Riduzione dei cache miss: %.1fx\n", (double)misses[0] / misses[1]);
+        }
+    }
+
+    shmdt(area);
+    if (failed) {
+        fprintf(stderr, "benchmark: contatori finali errati\n");
+        return 1;
+    }
+    return 0;
+}
+
+// Registratore di volo condiviso dai processi del caso recorder
+typedef struct {
+    atomic_ulong next CACHE_ALIGNED;
+    long cpu_ns[BENCH_MAX_PROCS];           // Tempo di CPU di ogni processo
+    FlightEvent events[BENCH_RECORDER_CAPACITY] CACHE_ALIGNED;
+} RecorderShared;
+
+// Esegue processes processi che registrano per_process eventi ciascuno e
+// restituisce il tempo di CPU medio per evento: con meno CPU che processi il
+// tempo reale misurerebbe anche l'attesa del proprio turno (-1 se mancano
+// eventi). *unreadable conta gli ultimi slot che il salvataggio salterebbe
+double run_recorder_case(RecorderShared *area, int processes, long per_process, long *unreadable)
+{
+    flight_recorder_init(&area->next, area->events, BENCH_RECORDER_CAPACITY);
+
+    for (int p = 0; p < processes; p++) {
+        if (fork() == 0) {
+            flight_pid = getpid();
+            struct timespec start, end;
+            clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+            for (long i = 0; i < per_process; i++) {
+                flight_recorder_record(&area->next, area->events, BENCH_RECORDER_CAPACITY,
+                                       FLIGHT_SERVICE_END, p % SERVICE_COUNT, p, (int)i, 0);
+            }
+            clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+            area->cpu_ns[p] = elapsed_ns(&start, &end);
+            _exit(0);
+        }
+    }
+    while (wait(NULL) > 0) {
+    }
+
+    unsigned long recorded = atomic_load_explicit(&area->next, memory_order_acquire);
+    if (recorded != (unsigned long)processes * per_process) {
+        return -1;
+    }
+    *unreadable = 0;
+    unsigned long first = recorded > BENCH_RECORDER_CAPACITY ? recorded - BENCH_RECORDER_CAPACITY : 0;
+    FlightEvent event;
+    for (unsigned long pos = first; pos < recorded; pos++) {
+        if (!flight_recorder_read(area->events, BENCH_RECORDER_CAPACITY, pos, &event)) {
+            (*unreadable)++;
+        }
+    }
+    long cpu_ns = 0;
+    for (int p = 0; p < processes; p++) {
+        cpu_ns += area->cpu_ns[p];
+    }
+    return (double)cpu_ns / ((double)processes * per_process);
+}
+
+int bench_recorder(int argc, char *argv[])
+{
+    int processes = argc > 2 ? atoi(argv[2]) : 4;
+    long per_process = argc > 3 ? atol(argv[3]) : 2000000;
+    if (processes < 1 || processes >= BENCH_MAX_PROCS || per_process < 1 || per_process > INT_MAX) {
+        fprintf(stderr, "Parametri non validi\n");
+        return 1;
+    }
+
+    int shmid = shmget(IPC_PRIVATE, sizeof(RecorderShared), IPC_CREAT | 0600);
+    if (shmid < 0) {
+        perror("benchmark: risorse IPC");
+        return 1;
+    }
+    RecorderShared *area = shmat(shmid, NULL, 0);
+    shmctl(shmid, IPC_RMID, NULL); // Rimosso al detach dell'ultimo processo
+
+    printf("=== Registratore di volo: fino a %d processi, %ld eventi ciascuno, ring da %d (CPU: %ld) ===\n",
+           processes, per_process, BENCH_RECORDER_CAPACITY, sysconf(_SC_NPROCESSORS_ONLN));
+    int failed = 0;
+
+    // Riferimento: la sola lettura dell'orologio, inclusa in ogni evento
+    struct timespec start, end, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long i = 0; i < per_process; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Lettura di CLOCK_MONOTONIC: %.1f ns\n", (double)elapsed_ns(&start, &end) / per_process);
+
+    printf("%-28s %16s %16s\n", "Processi", "ns CPU/evento", "slot saltati");
+    // Processi raddoppiati a ogni caso; l'ultimo usa tutti quelli richiesti
+    for (int count = 1; ; count = count * 2 < processes ? count * 2 : processes) {
+        long unreadable = 0;
+        double ns = run_recorder_case(area, count, per_process, &unreadable);
+        if (ns < 0) {
+            failed = 1;
+        } else {
+            printf("%-28d %16.1f %16ld\n", count, ns, unreadable);
+        }
+        if (count == processes) {
+            break;
+        }
+    }
+
+    shmdt(area);
+    if (failed) {
+        fprintf(stderr, "benchmark: eventi persi nel ring\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || strcmp(argv[1], "queue") == 0) {
+        return bench_queue(argc, argv);
+    }
+    if (strcmp(argv[1], "submit") == 0) {
+        return bench_submit(argc, argv);
+    }
+    if (strcmp(argv[1], "layout") == 0) {
+        return bench_layout(argc, argv);
+    }
+    if (strcmp(argv[1], "lock") == 0) {
+        return bench_lock(argc, argv);
+    }
+    if (strcmp(argv[1], "recorder") == 0) {
+        return bench_recorder(argc, argv);
+    }
+    printf("Uso: %s queue [produttori] [consumatori] [ticket]\n", argv[0]);
+    printf("     %s submit [utenti] [richieste per utente]\n", argv[0]);
+    printf("     %s layout [processi] [iterazioni]\n", argv[0]);
+    printf("     %s lock [processi] [sezioni critiche per processo]\n", argv[0]);
+    printf("     %s recorder [processi] [eventi per processo]\n", argv[0]);
+    return 1;
+}
@@ -0,0 +1,11 @@
+#ifndef CACHE_LINE_H
+#define CACHE_LINE_H
+
+// Dimensione della linea di cache. Una scrittura invalida l'intera linea
+// nelle cache degli altri core: dati scritti spesso da processi diversi vanno
+// su linee separate, altrimenti si contendono la linea anche se non
+// condividono nessun campo (false sharing).
+#define CACHE_LINE_SIZE 64
+#define CACHE_ALIGNED __attribute__((aligned(CACHE_LINE_SIZE)))
+
+#endif // CACHE_LINE_H
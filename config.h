@@ -4,10 +4,13 @@
 #include <limits.h>
 #include <sys/types.h>
 #include <time.h>
+#include <pthread.h>
 #include "config_reader.h"
-
-// Limiti di sistema per la memoria condivisa
-#define SHM_SIZE sizeof(SharedMemory)
+#include "cache_line.h"
+#include "ticket_ring.h"
+#include "submit_queue.h"
+#include "latency_hist.h"
+#include "flight_recorder.h"
 
 // Macro per accedere ai valori di configurazione
 #define WORK_DAY_HOURS config.WORK_DAY_HOURS
@@ -28,42 +31,17 @@
 
 #define OFFICE_OPEN_TIME config.OFFICE_OPEN_TIME
 #define OFFICE_CLOSE_TIME config.OFFICE_CLOSE_TIME
-
-// Configurazione semafori
-#define SEM_KEY 0x1234
-
-// Definizione degli indici dei semafori
-#define SEM_MUTEX 0         // Mutex per accesso generale
-#define SEM_QUEUE 1         // Semaforo per la gestione delle code
-#define SEM_TICKET_REQ 2    // Richiesta di biglietti
-#define SEM_TICKET_READY 3  // Biglietti pronti
-#define SEM_COUNTERS 4      // Accesso agli sportelli
-#define SEM_SYNC 5          // Sincronizzazione generica
-#define SEM_DAY_START 6     // Sincronizzazione inizio giorno
-#define SEM_TICKET_WAIT 7   // Sincronizzazione attesa ticket
-
-// Semafori separati per ogni servizio (molto più efficiente!)
-#define SEM_SERVICE_LOCK_BASE 8  // Base per i semafori dei servizi
-#define SEM_SERVICE_LOCK_PACKAGES (SEM_SERVICE_LOCK_BASE + PACKAGES)      
-#define SEM_SERVICE_LOCK_LETTERS (SEM_SERVICE_LOCK_BASE + LETTERS)        
-#define SEM_SERVICE_LOCK_BANCOPOST (SEM_SERVICE_LOCK_BASE + BANCOPOST)    
-#define SEM_SERVICE_LOCK_BILLS (SEM_SERVICE_LOCK_BASE + BILLS)            
-#define SEM_SERVICE_LOCK_FINANCIAL (SEM_SERVICE_LOCK_BASE + FINANCIAL)    
-#define SEM_SERVICE_LOCK_WATCHES (SEM_SERVICE_LOCK_BASE + WATCHES)        
-
-// Macro per calcolare il semaforo specifico di un servizio
-#define SEM_SERVICE_LOCK(service) (SEM_SERVICE_LOCK_BASE + (service))
-
-#define NUM_SEMS (SEM_SERVICE_LOCK_BASE + SERVICE_COUNT)  // 14 semafori totali
-
-// Dimensione massima della coda delle richieste di ticket
-#define MAX_REQUESTS 2000
-
-// Dimensione massima della coda per ogni servizio
-#define MAX_SERVICE_QUEUE 2000
-
-// Chiave per la coda messaggi
-#define MSG_QUEUE_KEY 8912
+#define USER_HOST config.USER_HOST
+#define TICKET_BATCH_SIZE config.TICKET_BATCH_SIZE
+#define NOF_TICKET_WORKERS config.NOF_TICKET_WORKERS
+#define OPERATOR_SKILLS config.OPERATOR_SKILLS
+#define STEAL_THRESHOLD config.STEAL_THRESHOLD
+#define REBALANCE_INTERVAL config.REBALANCE_INTERVAL
+#define SHM_BACKEND config.SHM_BACKEND
+#define SHM_HUGEPAGES config.SHM_HUGEPAGES
+#define SHM_PREFAULT config.SHM_PREFAULT
+#define SHM_MLOCK config.SHM_MLOCK
+#define FLIGHT_RECORDER_EVENTS config.FLIGHT_RECORDER_EVENTS
 
 // Prefissi per i ticket di ogni servizio
 static const char SERVICE_PREFIXES[] = {
@@ -95,18 +73,6 @@ typedef enum {
     REQUEST_REJECTED = 4     // Richiesta rifiutata
 } RequestStatus;
 
-// Aggiungi questa definizione per i messaggi
-#define MSG_TICKET_REQUEST 1
-
-typedef struct {
-    long mtype;             // Tipo di messaggio (sempre 1 per ticket request)
-    int user_id;            // ID utente richiedente
-    int service_id;         // Servizio richiesto
-    int request_index;      // Indice della richiesta in shared memory
-    time_t request_time;    // Timestamp della richiesta
-    pid_t user_pid;         // PID del processo utente richiedente
-} TicketRequestMsg;
-
 // Array dei nomi dei servizi 
 const char* SERVICE_NAMES[] = {
     "Pacchi",
@@ -144,9 +110,11 @@ typedef enum {
 typedef struct TicketRequest {
     int user_id;                // ID dell'utente che ha fatto la richiesta
     int service_id;             // Servizio richiesto
+    pid_t user_pid;             // Processo da avvisare con l'esito (utente o host degli utenti)
     struct timespec request_time;       // Timestamp preciso della richiesta (nanosecondi)
     struct timespec service_start_time; // Timestamp preciso di quando inizia il servizio
     RequestStatus status;       // Stato attuale della richiesta
+    atomic_uint outcome_seq;    // Parola futex dell'utente: incrementata quando il ticket è emesso
     int ticket_number;          // Numero del ticket assegnato (progressivo per servizio)
     char ticket_id[10];         // Identificativo del ticket (es. "L5", "B12")
     int counter_id;             // ID dello sportello assegnato (se presente)
@@ -154,16 +122,27 @@ typedef struct TicketRequest {
     int being_served;           // Flag: 1 se attualmente in servizio, 0 altrimenti
     int served_successfully;    // Flag: 1 se il servizio è stato completato con successo, 0 altrimenti
     long wait_time_ns;          // Tempo di attesa in nanosecondi (calcolato quando il servizio finisce)
+
+    // Gestione dello slot (request_pool.h): non azzerati quando lo slot viene riassegnato
+    atomic_int refs;            // Riferimenti ancora attivi (utente e sistema)
+    atomic_int next_free;       // Slot successivo nella pila dei liberi (indice + 1)
+    unsigned int generation;    // Giornata (day_epoch) in cui lo slot è stato assegnato
 } TicketRequest;
 
-// Strutture per la memoria condivisa
+// Strutture per la memoria condivisa. Sportelli e operatori sono allineati
+// alla linea di cache: ogni operatore aggiorna il proprio stato e quello del
+// suo sportello senza invalidare le linee degli altri
 
 typedef struct Counter { // Aggiunto nome tag struttura
     pid_t operator_pid; // PID dell'operatore assegnato a questo sportello
     int active;
     ServiceType current_service;
     int total_served;
-} Counter;
+    int handover_to;    // Servizio (+1) a cui passa lo sportello dopo il cliente in corso, 0 = nessuno
+    int free_prev;      // Sportelli liberi dello stesso servizio (id + 1, vedi counter_index.h)
+    int free_next;
+    int free_listed;    // 1 se lo sportello è nell'insieme dei liberi
+} CACHE_ALIGNED Counter;
 
 typedef struct Operator { // Aggiunto nome tag struttura
     pid_t pid;                     // ID processo dell'operatore
@@ -172,40 +151,156 @@ typedef struct Operator { // Aggiunto nome tag struttura
     int total_served;             // Numero totale di utenti serviti
     int total_pauses;             // Numero di pause fatte
     OperatorStatus status;        // Stato corrente dell'operatore
-} Operator;
+    atomic_uint wakeup_seq;       // Parola futex per i risvegli mirati (vedi notify.h)
+    atomic_int idle_listed;       // 1 se l'operatore è nella pila degli inattivi
+    atomic_int idle_next;         // Operatore successivo nella pila (id + 1)
+    int skills;                   // Servizi che sa erogare (bit 1 << servizio, sempre incluso il proprio)
+    atomic_int steal_listed;      // 1 se inattivo e disponibile a rubare ticket di altri servizi
+    int counter_id;               // Sportello assegnato (-1 se nessuno)
+    int wait_next;                // Operatore successivo nella coda di attesa di uno sportello (id + 1)
+    int wait_listed;              // 1 se in coda per uno sportello (counter_index.h)
+    long day_context_switches;    // Cambi di contesto nell'ultima giornata (getrusage)
+} CACHE_ALIGNED Operator;
+
+// Servizi completati da un operatore nella giornata (stats_shard.h). Scritto
+// solo dal proprio operatore, senza lock; l'allineamento alla linea di cache
+// evita che operatori diversi si contendano la stessa linea
+typedef struct {
+    atomic_uint seq;                        // Dispari durante un aggiornamento (seqlock)
+    unsigned int epoch;                     // Giornata (day_epoch) a cui si riferiscono i dati
+    int served[SERVICE_COUNT];              // Ticket serviti per servizio
+    int stolen[SERVICE_COUNT];              // Di cui rubati ad altri servizi
+    long service_time_total[SERVICE_COUNT]; // Tempi di servizio (nanosecondi)
+    long service_time_min[SERVICE_COUNT];
+    long service_time_max[SERVICE_COUNT];
+    long wait_time_total[SERVICE_COUNT];    // Tempi di attesa (nanosecondi)
+    long wait_time_min[SERVICE_COUNT];
+    long wait_time_max[SERVICE_COUNT];
+} CACHE_ALIGNED OperatorStatsShard;
+
+// Processo del distributore di ticket. Con più worker ognuno possiede i
+// servizi con service % ticket_worker_count == id: ha la propria coda di
+// invio e scrive da solo i contatori dei ticket dei propri servizi
+typedef struct {
+    SubmitQueue submit_queue;   // Richieste per i servizi del worker (celle nella regione submit_queues)
+    pid_t pid;
+} TicketWorker;
 
-// Questa è la struttura principale per il segmento di memoria condivisa
+// Pila degli operatori inattivi di un servizio (notify.h), su una linea
+// propria: la modificano il worker del servizio e i suoi operatori
 typedef struct {
-    // ID dei processi
-    pid_t ticket_pid;
-    pid_t user_pids[MAX_USERS];     // Array per memorizzare tutti i PID degli utenti
-    pid_t operator_pids[MAX_WORKERS]; // Array per memorizzare tutti i PID degli operatori
+    atomic_ulong top;           // Cima della pila con contatore anti-ABA
+} CACHE_ALIGNED IdleStack;
 
-    // Disponibilità servizi
-    int service_available[SERVICE_COUNT];
+// Contatori dei ticket di un servizio, scritti dal suo worker ticket. Ogni
+// servizio ha la sua linea di cache: worker diversi non se la contendono
+typedef struct {
+    int next_ticket;                     // Numero del prossimo ticket
+    int daily_issued;                    // Ticket emessi nella giornata
+    atomic_int daily_operator_wakeups;   // Risvegli mirati inviati nella giornata
+    atomic_int total_operator_wakeups;   // Risvegli mirati in tutta la simulazione
+} CACHE_ALIGNED ServiceTicketing;
 
-    // Sportelli e operatori
-    Counter counters[MAX_WORKER_SEATS];
-    Operator operators[MAX_WORKERS]; // Array per memorizzare informazioni dettagliate degli operatori
+// Statistiche di un singolo giorno della simulazione (per calcolare le medie)
+typedef struct {
+    int users_served;
+    int services_not_provided;
+    long total_wait_time;                  // Tempo totale di attesa (in nanosecondi)
+    int wait_count;
+    long total_service_time;
+    int service_count;
+    int pauses;
+    int operators_active;
+
+    // Statistiche per servizio (per le medie per tipo di servizio)
+    int users_served_per_service[SERVICE_COUNT];
+    int services_not_provided_per_service[SERVICE_COUNT];
+    long total_wait_time_per_service[SERVICE_COUNT];    // Tempo di attesa per servizio (in nanosecondi)
+    int wait_count_per_service[SERVICE_COUNT];
+    long total_service_time_per_service[SERVICE_COUNT];
+    int service_count_per_service[SERVICE_COUNT];
+
+    // Medie cumulative progressive fino a questo giorno
+    double cumulative_avg_users_served;
+    double cumulative_avg_services_provided;
+    double cumulative_avg_services_not_provided;
+} DailyStatistics;
+
+// Intestazione del segmento di memoria condivisa. Gli array dimensionati dalla
+// configurazione (utenti, operatori, sportelli, richieste, code, giorni) non
+// hanno più una dimensione massima fissa: stanno in regioni che seguono
+// l'intestazione, raggiungibili tramite offset (vedi shm_layout.h). Gli offset
+// e non i puntatori restano validi in ogni processo, qualunque sia l'indirizzo
+// a cui il segmento viene attaccato.
+typedef struct {
+    // Descrizione del layout (scritta dal direttore, letta da tutti)
+    unsigned int magic;             // SHM_MAGIC se il segmento è inizializzato
+    size_t total_size;              // Dimensione totale del segmento in byte
+    int user_capacity;              // Elementi nella regione dei PID utente
+    int worker_capacity;            // Operatori (e relativi PID)
+    int counter_capacity;           // Sportelli
+    int request_capacity;           // Richieste di ticket per giornata
+    int queue_capacity;             // Posti in ciascuna coda di servizio (potenza di due)
+    int day_capacity;               // Giorni con statistiche giornaliere
+    int ticket_worker_count;        // Processi ticket (al più uno per servizio)
+    unsigned long flight_capacity;  // Eventi nel registratore di volo (potenza di due, 0 = spento)
+    size_t user_pids_offset;
+    size_t operator_pids_offset;
+    size_t counters_offset;
+    size_t operators_offset;
+    size_t ticket_requests_offset;
+    size_t service_queues_offset;
+    size_t submit_queues_offset;
+    size_t day_stats_offset;
+    size_t stats_shards_offset;
+    size_t flight_events_offset;
+
+    // ID dei processi
+    pid_t user_host_pid;            // PID del processo host degli utenti (USER_HOST=1)
 
-    // Controllo simulazione
+    // Controllo simulazione (scritto dal direttore tra una giornata e l'altra)
     int simulation_day;    // Giorno corrente nella simulazione
     int day_in_progress;   // Flag per indicare se un giorno è attualmente in corso
     int termination_flag; // Segnale per i processi di uscire
     int reset_complete;
-
-    // Gestione richieste ticket
-    int next_request_index;                 // Indice per la prossima richiesta di ticket
-    TicketRequest ticket_requests[MAX_REQUESTS];  // Coda delle richieste di ticket
-
-    // Code separate per ogni servizio
-    int next_service_ticket[SERVICE_COUNT]; // Contatore per i ticket di ogni servizio
-    int service_queues[SERVICE_COUNT][MAX_SERVICE_QUEUE]; // Code dei ticket (indici delle richieste)
-    int service_queue_head[SERVICE_COUNT];  // Indice di testa per ogni coda
-    int service_queue_tail[SERVICE_COUNT];  // Indice di coda per ogni coda
-    int service_tickets_waiting[SERVICE_COUNT]; // Numero di ticket in attesa per ogni servizio
-
-    int daily_tickets_served[SERVICE_COUNT]; // Ticket serviti per ogni servizio
+    atomic_uint day_epoch;                  // Giornata corrente, generazione delle richieste
+    atomic_uint day_seq;                    // Barriera delle giornate (day_barrier.h): dispari = aperta
+    long day_opened_ns;                     // Apertura della giornata (CLOCK_MONOTONIC)
+    int day_open_wake_count;                // Processi svegliati dall'apertura (ritorno di FUTEX_WAKE)
+    unsigned int ready_target;              // Processi pronti attesi dal direttore (day_barrier.h)
+    unsigned int done_target;               // Processi che devono chiudere ogni giornata
+
+    // Da qui in poi i dati modificati durante la giornata, raggruppati per
+    // processo che li scrive e separati dai dati in sola lettura qui sopra
+
+    // Pila degli slot liberi delle richieste (request_pool.h): utenti e operatori
+    atomic_ulong free_requests CACHE_ALIGNED;
+
+    // Code separate per ogni servizio (posizioni su linee proprie, celle nella
+    // regione service_queues), operatori inattivi e contatori dei ticket
+    TicketRing service_rings[SERVICE_COUNT];
+    IdleStack idle_operators[SERVICE_COUNT];
+    ServiceTicketing ticketing[SERVICE_COUNT];
+
+    TicketWorker ticket_workers[SERVICE_COUNT]; // Processi ticket e relative code di invio
+
+    // Lock degli sportelli (shm_sync.h): protegge gli indici che seguono
+    pthread_mutex_t counters_lock CACHE_ALIGNED;
+
+    // Disponibilità servizi: sportelli con un operatore per ogni servizio,
+    // aggiornati da counter_index.h e letti senza lock all'arrivo degli utenti
+    atomic_int service_available[SERVICE_COUNT];
+
+    // Indici degli sportelli (counter_index.h, protetti da counters_lock)
+    int free_counters[SERVICE_COUNT];       // Sportelli liberi per servizio (id + 1)
+    int waiting_head[SERVICE_COUNT];        // Operatori in attesa di uno sportello, dal più vecchio
+    int waiting_tail[SERVICE_COUNT];
+
+    // Statistiche della giornata e della simulazione: scritte a fine giornata
+    // o di rado, in fondo all'intestazione. I contatori aggiornati durante la
+    // giornata da utenti e operatori sono protetti da stats_lock (shm_sync.h)
+    pthread_mutex_t stats_lock CACHE_ALIGNED;
+    int daily_tickets_served[SERVICE_COUNT]; // Ticket serviti per ogni servizio (registri degli operatori uniti a fine giornata)
     int daily_users_home[SERVICE_COUNT];    // Utenti tornati a casa per ogni servizio
     int daily_users_timeout[SERVICE_COUNT];  // Utenti non serviti per mancanza di tempo
     int daily_users_no_ticket[SERVICE_COUNT]; // Utenti che non hanno ricevuto il ticket entro la giornata
@@ -244,36 +339,71 @@ typedef struct {
     int total_services_provided_simulation; // Totale servizi erogati in tutta la simulazione 
     int total_services_not_provided_simulation; // Totale servizi non erogati in tutta la simulazione
     int total_pauses_simulation;           // Totale pause in tutta la simulazione
-    
-    // Array per memorizzare le statistiche di ogni giorno (per calcolare le medie)
-    int users_served_per_day[MAX_SIM_DURATION];
-    int services_not_provided_per_day[MAX_SIM_DURATION]; 
-    long total_wait_time_per_day[MAX_SIM_DURATION];      // Tempo totale di attesa per giorno (in nanosecondi)
-    int wait_count_per_day[MAX_SIM_DURATION];
-    long total_service_time_per_day[MAX_SIM_DURATION];
-    int service_count_per_day[MAX_SIM_DURATION];
-    int pauses_per_day[MAX_SIM_DURATION];
-    int operators_active_per_day[MAX_SIM_DURATION];
-    
-    // Statistiche per servizio per giorno (per le medie per tipo di servizio)
-    int users_served_per_service_per_day[SERVICE_COUNT][MAX_SIM_DURATION];
-    int services_not_provided_per_service_per_day[SERVICE_COUNT][MAX_SIM_DURATION];
-    long total_wait_time_per_service_per_day[SERVICE_COUNT][MAX_SIM_DURATION];  // Tempo di attesa per servizio per giorno (in nanosecondi)
-    int wait_count_per_service_per_day[SERVICE_COUNT][MAX_SIM_DURATION];
-    long total_service_time_per_service_per_day[SERVICE_COUNT][MAX_SIM_DURATION];
-    int service_count_per_service_per_day[SERVICE_COUNT][MAX_SIM_DURATION];
-
-    // Medie cumulative progressive per ogni giorno
-    double cumulative_avg_users_served[MAX_SIM_DURATION];
-    double cumulative_avg_services_provided[MAX_SIM_DURATION];
-    double cumulative_avg_services_not_provided[MAX_SIM_DURATION];
+    int daily_counter_moves;               // Sportelli passati a un altro servizio nella giornata
+    int total_counter_moves;               // Sportelli passati a un altro servizio in tutta la simulazione
     
     // Somma totale degli operatori attivi per servizio durante tutta la simulazione
     int operators_active_per_service_total[SERVICE_COUNT];
 
+    // Risvegli degli operatori che hanno trovato la coda vuota (i risvegli
+    // inviati sono in ticketing): scritti dagli operatori, su una linea propria
+    atomic_int daily_spurious_wakeups[SERVICE_COUNT] CACHE_ALIGNED;
+    atomic_int total_spurious_wakeups[SERVICE_COUNT];
+
+    // Distribuzione dei tempi di attesa e di servizio per servizio
+    // (latency_hist.h): quelle della giornata sono aggiornate senza lock a
+    // ogni servizio completato e unite a fine giornata in quelle della simulazione
+    LatencyHistogram daily_wait_hist[SERVICE_COUNT] CACHE_ALIGNED;
+    LatencyHistogram daily_service_hist[SERVICE_COUNT];
+    LatencyHistogram wait_hist[SERVICE_COUNT];
+    LatencyHistogram service_hist[SERVICE_COUNT];
+
+    // Ticket serviti da operatori di un altro servizio (work stealing)
+    int daily_tickets_stolen[SERVICE_COUNT];
+    int total_tickets_stolen[SERVICE_COUNT];
+
+    // Latenza di avvio della giornata (day_barrier.h): ogni processo la
+    // registra una volta all'apertura, su una linea propria
+    atomic_long day_start_latency_total_ns CACHE_ALIGNED;
+    atomic_long day_start_latency_max_ns;
+    atomic_int day_start_woken;
+
+    // Conferme dei processi figli (day_barrier.h): pronti dopo l'avvio e
+    // giornata chiusa. Il direttore dorme su queste parole
+    atomic_uint ready_count;
+    atomic_uint done_count;
+
+    // Risvegli dei processi utente nella giornata (cambi di contesto
+    // volontari), sommati da ciascuno prima della conferma di fine giornata
+    atomic_long daily_user_wakeups;
+
+    // Esplosione (ticket.c): utenti in coda nel momento in cui la soglia è
+    // stata superata, 0 finché non succede. Il direttore dorme su questa parola
+    atomic_uint explode_waiting;
+
+    // Registratore di volo (flight_recorder.h): posizione del prossimo
+    // evento, incrementata da tutti i processi, su una linea propria
+    atomic_ulong flight_next CACHE_ALIGNED;
+
 } SharedMemory;
 
 // Chiavi IPC
 #define SHM_KEY 0x1234
+#define SHM_MAGIC 0x534F4631       // "SOF1": segmento inizializzato dal direttore
+
+// Accesso alle regioni del segmento tramite gli offset dell'intestazione
+#define SHM_REGION(shm, offset, type) ((type *)((char *)(shm) + (shm)->offset))
+#define SHM_USER_PIDS(shm) SHM_REGION(shm, user_pids_offset, pid_t)
+#define SHM_OPERATOR_PIDS(shm) SHM_REGION(shm, operator_pids_offset, pid_t)
+#define SHM_COUNTERS(shm) SHM_REGION(shm, counters_offset, Counter)
+#define SHM_OPERATORS(shm) SHM_REGION(shm, operators_offset, Operator)
+#define SHM_REQUESTS(shm) SHM_REGION(shm, ticket_requests_offset, TicketRequest)
+#define SHM_SERVICE_RING(shm, service) (&(shm)->service_rings[service])
+#define SHM_SERVICE_CELLS(shm, service) (SHM_REGION(shm, service_queues_offset, RingCell) + (size_t)(service) * (shm)->queue_capacity)
+#define SHM_SUBMIT_CELLS(shm, worker) (SHM_REGION(shm, submit_queues_offset, RingCell) + (size_t)(worker) * (shm)->queue_capacity)
+#define TICKET_WORKER_OF(shm, service) ((service) % (shm)->ticket_worker_count)
+#define SHM_DAY_STATS(shm, day) (&SHM_REGION(shm, day_stats_offset, DailyStatistics)[day])
+#define SHM_STATS_SHARDS(shm) SHM_REGION(shm, stats_shards_offset, OperatorStatsShard)
+#define SHM_FLIGHT_EVENTS(shm) SHM_REGION(shm, flight_events_offset, FlightEvent)
 
 #endif
\ No newline at end of file
@@ -5,12 +5,6 @@
 #include <stdlib.h>
 #include <string.h>
 
-// Costanti massime per le strutture dati
-#define MAX_WORKERS 200
-#define MAX_USERS 2000  
-#define MAX_WORKER_SEATS 200
-#define MAX_SIM_DURATION 10
-
 // Struttura per contenere i parametri di configurazione
 typedef struct {
     int WORK_DAY_HOURS;
@@ -26,6 +20,17 @@ typedef struct {
     int EXPLODE_THRESHOLD;
     int OFFICE_OPEN_TIME;
     int OFFICE_CLOSE_TIME;
+    int USER_HOST;              // 1 = tutti gli utenti simulati da un unico processo
+    int TICKET_BATCH_SIZE;      // Richieste ticket elaborate per lotto (1 = una alla volta)
+    int NOF_TICKET_WORKERS;     // Processi ticket, ognuno con un sottoinsieme dei servizi
+    int OPERATOR_SKILLS;        // Servizi che ogni operatore sa erogare (1 = solo il proprio)
+    int STEAL_THRESHOLD;        // Ticket in coda oltre i quali un operatore inattivo ruba da un altro servizio
+    int REBALANCE_INTERVAL;     // Minuti simulati tra due ribilanciamenti degli sportelli (0 = sportelli fissi)
+    int SHM_BACKEND;            // Memoria condivisa: 0 = SysV (shmget), 1 = POSIX (shm_open/mmap)
+    int SHM_HUGEPAGES;          // 1 = segmento POSIX su pagine huge (hugetlbfs o transparent huge pages)
+    int SHM_PREFAULT;           // 1 = ogni processo mappa tutte le pagine del segmento al collegamento
+    int SHM_MLOCK;              // 1 = pagine del segmento bloccate in RAM (mlock)
+    int FLIGHT_RECORDER_EVENTS; // Eventi nel registratore di volo (arrotondati a potenza di due, 0 = spento)
     
     // Parametri calcolati
     int WORK_DAY_MINUTES;
@@ -59,11 +64,28 @@ void set_default_config() {
     config.EXPLODE_THRESHOLD = 1000;
     config.OFFICE_OPEN_TIME = 0;
     config.OFFICE_CLOSE_TIME = 480;
+    config.USER_HOST = 0;
+    config.TICKET_BATCH_SIZE = 32;
+    config.NOF_TICKET_WORKERS = 1;
+    config.OPERATOR_SKILLS = 1;
+    config.STEAL_THRESHOLD = 2;
+    config.REBALANCE_INTERVAL = 0;
+    config.SHM_BACKEND = 0;
+    config.SHM_HUGEPAGES = 0;
+    config.SHM_PREFAULT = 0;
+    config.SHM_MLOCK = 0;
+    config.FLIGHT_RECORDER_EVENTS = 65536;
     calculate_derived_values();
 }
 
 void calculate_derived_values() {
     config.WORK_DAY_MINUTES = config.WORK_DAY_HOURS * 60;
+    if (config.TICKET_BATCH_SIZE < 1) config.TICKET_BATCH_SIZE = 1;
+    if (config.NOF_TICKET_WORKERS < 1) config.NOF_TICKET_WORKERS = 1;
+    if (config.OPERATOR_SKILLS < 1) config.OPERATOR_SKILLS = 1;
+    if (config.STEAL_THRESHOLD < 1) config.STEAL_THRESHOLD = 1;
+    if (config.REBALANCE_INTERVAL < 0) config.REBALANCE_INTERVAL = 0;
+    if (config.FLIGHT_RECORDER_EVENTS < 0) config.FLIGHT_RECORDER_EVENTS = 0;
     config.TOTAL_SIMULATION_TIME = config.SIM_DURATION * config.DAY_SIMULATION_TIME;
     config.N_NANO_SECS = (config.DAY_SIMULATION_TIME * 1000000000L) / config.WORK_DAY_MINUTES;
 }
@@ -93,41 +115,33 @@ int read_config(const char* config_file) {
         if (sscanf(line, "%[^=]=%d", key, &value) == 2) {
             if (strcmp(key, "WORK_DAY_HOURS") == 0) config.WORK_DAY_HOURS = value;
             else if (strcmp(key, "DAY_SIMULATION_TIME") == 0) config.DAY_SIMULATION_TIME = value;
-            else if (strcmp(key, "SIM_DURATION") == 0) {
-                if (value > MAX_SIM_DURATION) {
-                    value = MAX_SIM_DURATION;
-                }
-                config.SIM_DURATION = value;
-            }
+            else if (strcmp(key, "SIM_DURATION") == 0) config.SIM_DURATION = value;
             else if (strcmp(key, "BREAK_PROBABILITY") == 0) config.BREAK_PROBABILITY = value;
-            else if (strcmp(key, "NOF_WORKERS") == 0) {
-                if (value > MAX_WORKERS) {
-                    value = MAX_WORKERS;
-                }
-                config.NOF_WORKERS = value;
-            }
-            else if (strcmp(key, "NOF_USERS") == 0) {
-                if (value > MAX_USERS) {
-                    value = MAX_USERS;
-                }
-                config.NOF_USERS = value;
-            }
-            else if (strcmp(key, "NOF_WORKER_SEATS") == 0) {
-                if (value > MAX_WORKER_SEATS) {
-                    value = MAX_WORKER_SEATS;
-                }
-                config.NOF_WORKER_SEATS = value;
-            }
+            else if (strcmp(key, "NOF_WORKERS") == 0) config.NOF_WORKERS = value;
+            else if (strcmp(key, "NOF_USERS") == 0) config.NOF_USERS = value;
+            else if (strcmp(key, "NOF_WORKER_SEATS") == 0) config.NOF_WORKER_SEATS = value;
             else if (strcmp(key, "NOF_PAUSE") == 0) config.NOF_PAUSE = value;
             else if (strcmp(key, "P_SERV_MIN") == 0) config.P_SERV_MIN = value;
             else if (strcmp(key, "P_SERV_MAX") == 0) config.P_SERV_MAX = value;
             else if (strcmp(key, "EXPLODE_THRESHOLD") == 0) config.EXPLODE_THRESHOLD = value;
             else if (strcmp(key, "OFFICE_OPEN_TIME") == 0) config.OFFICE_OPEN_TIME = value;
             else if (strcmp(key, "OFFICE_CLOSE_TIME") == 0) config.OFFICE_CLOSE_TIME = value;
+            else if (strcmp(key, "USER_HOST") == 0) config.USER_HOST = value;
+            else if (strcmp(key, "TICKET_BATCH_SIZE") == 0) config.TICKET_BATCH_SIZE = value;
+            else if (strcmp(key, "NOF_TICKET_WORKERS") == 0) config.NOF_TICKET_WORKERS = value;
+            else if (strcmp(key, "OPERATOR_SKILLS") == 0) config.OPERATOR_SKILLS = value;
+            else if (strcmp(key, "STEAL_THRESHOLD") == 0) config.STEAL_THRESHOLD = value;
+            else if (strcmp(key, "REBALANCE_INTERVAL") == 0) config.REBALANCE_INTERVAL = value;
+            else if (strcmp(key, "SHM_BACKEND") == 0) config.SHM_BACKEND = value;
+            else if (strcmp(key, "SHM_HUGEPAGES") == 0) config.SHM_HUGEPAGES = value;
+            else if (strcmp(key, "SHM_PREFAULT") == 0) config.SHM_PREFAULT = value;
+            else if (strcmp(key, "SHM_MLOCK") == 0) config.SHM_MLOCK = value;
+            else if (strcmp(key, "FLIGHT_RECORDER_EVENTS") == 0) config.FLIGHT_RECORDER_EVENTS = value;
         }
     }
     
     fclose(file);
+
     calculate_derived_values();
     
     return 1;
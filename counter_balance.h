@@ -0,0 +1,74 @@
+#ifndef COUNTER_BALANCE_H
+#define COUNTER_BALANCE_H
+
+#include "config.h"
+#include "shm_layout.h"
+#include "counter_index.h"
+
+// Ribilanciamento degli sportelli durante la giornata. Ogni REBALANCE_INTERVAL
+// minuti simulati il direttore confronta, per ogni servizio, i ticket in coda
+// con quelli serviti nell'ultimo intervallo: se un servizio accumula più
+// ticket di quanti ne smaltisce, uno sportello di un servizio senza coda passa
+// a lui. Lo sportello libero cambia servizio subito; quello con un operatore
+// viene marcato (handover_to) e l'operatore lo lascia dopo il cliente in corso.
+// La politica è condivisa dai processi reali e dal motore a tempo virtuale,
+// che applicano lo spostamento ciascuno a modo suo.
+
+int rebalance_pick_move(SharedMemory *shm, const int *recent_served, int *counter_id, int *service);
+
+// Implementazione delle funzioni
+
+// Sceglie uno spostamento: il servizio più congestionato (coda meno ticket
+// serviti nell'ultimo intervallo, almeno 2) che ha un operatore senza
+// sportello, e uno sportello di un servizio con la coda vuota che non sia
+// l'ultimo del suo servizio. Ritorna 1 se lo spostamento esiste
+int rebalance_pick_move(SharedMemory *shm, const int *recent_served, int *counter_id, int *service)
+{
+    int counters_per_service[SERVICE_COUNT] = {0};
+    for (int i = 0; i < NOF_WORKER_SEATS; i++) {
+        if (SHM_COUNTERS(shm)[i].active && SHM_COUNTERS(shm)[i].handover_to == 0) {
+            counters_per_service[SHM_COUNTERS(shm)[i].current_service]++;
+        }
+    }
+
+    // Servizio destinazione: serve un operatore in coda che possa sedersi
+    int target = -1;
+    int target_backlog = 1;
+    for (int s = 0; s < SERVICE_COUNT; s++) {
+        int backlog = service_queue_length(shm, s) - recent_served[s];
+        if (backlog > target_backlog && shm->waiting_head[s] != COUNTER_INDEX_NONE) {
+            target = s;
+            target_backlog = backlog;
+        }
+    }
+    if (target < 0) {
+        return 0;
+    }
+
+    // Sportello di partenza: prima uno libero, poi uno con operatore inattivo
+    int best = -1;
+    for (int i = 0; i < NOF_WORKER_SEATS; i++) {
+        Counter *counter = &SHM_COUNTERS(shm)[i];
+        int from = counter->current_service;
+        if (!counter->active || counter->handover_to != 0 || from == target ||
+            counters_per_service[from] <= 1 || service_queue_length(shm, from) > 0) {
+            continue;
+        }
+        if (counter->operator_pid == 0) {
+            best = i;
+            break;
+        }
+        if (best < 0) {
+            best = i;
+        }
+    }
+    if (best < 0) {
+        return 0;
+    }
+
+    *counter_id = best;
+    *service = target;
+    return 1;
+}
+
+#endif // COUNTER_BALANCE_H
@@ -0,0 +1,182 @@
+#ifndef COUNTER_INDEX_H
+#define COUNTER_INDEX_H
+
+#include "config.h"
+#include "shm_layout.h"
+
+// Indici degli sportelli in memoria condivisa. Per ogni servizio ci sono
+// l'insieme degli sportelli liberi (lista doppiamente collegata negli
+// sportelli) e la coda FIFO degli operatori in attesa di uno sportello
+// (lista collegata negli operatori). Gli indici sono id + 1, 0 = nessuno.
+// Uno sportello liberato va direttamente all'operatore compatibile in attesa
+// da più tempo, senza scorrere sportelli e operatori; entra nell'insieme dei
+// liberi solo se nessuno lo aspetta. Ne segue che, per ogni servizio, non ci
+// sono mai insieme sportelli liberi e operatori in attesa.
+// Ogni cambio dell'operatore di uno sportello passa da counter_staff() e
+// counter_unstaff(), che tengono aggiornato il numero di sportelli presidiati
+// per servizio (service_available): l'utente che arriva lo legge senza
+// scorrere sportelli e operatori.
+// Tutte le funzioni vanno chiamate con il lock degli sportelli (counters_lock,
+// o il mutex equivalente della variante multi-thread).
+
+#define COUNTER_INDEX_NONE 0
+
+void counter_index_reset(SharedMemory *shm);
+void counter_staff(SharedMemory *shm, int counter_id, pid_t operator_pid);
+void counter_unstaff(SharedMemory *shm, int counter_id);
+void counter_free_push(SharedMemory *shm, int counter_id);
+void counter_free_remove(SharedMemory *shm, int counter_id);
+int counter_free_pop(SharedMemory *shm, int service);
+void waiting_operator_enqueue(SharedMemory *shm, int op_id);
+int waiting_operator_dequeue(SharedMemory *shm, int service);
+int counter_handoff(SharedMemory *shm, int counter_id);
+
+// Implementazione delle funzioni
+
+// Ricostruisce gli indici a inizio giornata: nessun operatore ha uno
+// sportello o è in coda, tutti gli sportelli attivi sono liberi
+void counter_index_reset(SharedMemory *shm)
+{
+    for (int service = 0; service < SERVICE_COUNT; service++) {
+        atomic_store_explicit(&shm->service_available[service], 0, memory_order_relaxed);
+        shm->free_counters[service] = COUNTER_INDEX_NONE;
+        shm->waiting_head[service] = COUNTER_INDEX_NONE;
+        shm->waiting_tail[service] = COUNTER_INDEX_NONE;
+    }
+    for (int op_id = 0; op_id < shm->worker_capacity; op_id++) {
+        SHM_OPERATORS(shm)[op_id].counter_id = -1;
+        SHM_OPERATORS(shm)[op_id].wait_next = COUNTER_INDEX_NONE;
+        SHM_OPERATORS(shm)[op_id].wait_listed = 0;
+    }
+    for (int counter_id = shm->counter_capacity - 1; counter_id >= 0; counter_id--) {
+        SHM_COUNTERS(shm)[counter_id].free_listed = 0;
+        SHM_COUNTERS(shm)[counter_id].operator_pid = 0;
+        if (SHM_COUNTERS(shm)[counter_id].active) {
+            counter_free_push(shm, counter_id);
+        }
+    }
+}
+
+// Assegna l'operatore allo sportello: il servizio diventa disponibile
+void counter_staff(SharedMemory *shm, int counter_id, pid_t operator_pid)
+{
+    Counter *counter = &SHM_COUNTERS(shm)[counter_id];
+    if (counter->operator_pid == 0) {
+        atomic_fetch_add_explicit(&shm->service_available[counter->current_service], 1, memory_order_release);
+    }
+    counter->operator_pid = operator_pid;
+}
+
+// Lo sportello resta senza operatore. Va chiamata prima di cambiarne il servizio
+void counter_unstaff(SharedMemory *shm, int counter_id)
+{
+    Counter *counter = &SHM_COUNTERS(shm)[counter_id];
+    if (counter->operator_pid != 0) {
+        atomic_fetch_sub_explicit(&shm->service_available[counter->current_service], 1, memory_order_release);
+    }
+    counter->operator_pid = 0;
+}
+
+// Aggiunge uno sportello all'insieme dei liberi del suo servizio
+void counter_free_push(SharedMemory *shm, int counter_id)
+{
+    Counter *counter = &SHM_COUNTERS(shm)[counter_id];
+    int service = counter->current_service;
+
+    if (counter->free_listed) {
+        return;
+    }
+    counter->free_prev = COUNTER_INDEX_NONE;
+    counter->free_next = shm->free_counters[service];
+    if (counter->free_next != COUNTER_INDEX_NONE) {
+        SHM_COUNTERS(shm)[counter->free_next - 1].free_prev = counter_id + 1;
+    }
+    shm->free_counters[service] = counter_id + 1;
+    counter->free_listed = 1;
+}
+
+// Toglie uno sportello dall'insieme dei liberi (es. prima di cambiarne il servizio)
+void counter_free_remove(SharedMemory *shm, int counter_id)
+{
+    Counter *counter = &SHM_COUNTERS(shm)[counter_id];
+
+    if (!counter->free_listed) {
+        return;
+    }
+    if (counter->free_prev != COUNTER_INDEX_NONE) {
+        SHM_COUNTERS(shm)[counter->free_prev - 1].free_next = counter->free_next;
+    } else {
+        shm->free_counters[counter->current_service] = counter->free_next;
+    }
+    if (counter->free_next != COUNTER_INDEX_NONE) {
+        SHM_COUNTERS(shm)[counter->free_next - 1].free_prev = counter->free_prev;
+    }
+    counter->free_listed = 0;
+}
+
+// Prende uno sportello libero del servizio. Ritorna l'id o -1 se non ce ne sono
+int counter_free_pop(SharedMemory *shm, int service)
+{
+    int first = shm->free_counters[service];
+    if (first == COUNTER_INDEX_NONE) {
+        return -1;
+    }
+    counter_free_remove(shm, first - 1);
+    return first - 1;
+}
+
+// Mette l'operatore in fondo alla coda di attesa del suo servizio
+void waiting_operator_enqueue(SharedMemory *shm, int op_id)
+{
+    Operator *op = &SHM_OPERATORS(shm)[op_id];
+    int service = op->current_service;
+
+    if (op->wait_listed) {
+        return;
+    }
+    op->wait_next = COUNTER_INDEX_NONE;
+    if (shm->waiting_tail[service] != COUNTER_INDEX_NONE) {
+        SHM_OPERATORS(shm)[shm->waiting_tail[service] - 1].wait_next = op_id + 1;
+    } else {
+        shm->waiting_head[service] = op_id + 1;
+    }
+    shm->waiting_tail[service] = op_id + 1;
+    op->wait_listed = 1;
+}
+
+// Toglie l'operatore in attesa da più tempo. Ritorna l'id o -1 se la coda è vuota
+int waiting_operator_dequeue(SharedMemory *shm, int service)
+{
+    int first = shm->waiting_head[service];
+    if (first == COUNTER_INDEX_NONE) {
+        return -1;
+    }
+    Operator *op = &SHM_OPERATORS(shm)[first - 1];
+    shm->waiting_head[service] = op->wait_next;
+    if (op->wait_next == COUNTER_INDEX_NONE) {
+        shm->waiting_tail[service] = COUNTER_INDEX_NONE;
+    }
+    op->wait_next = COUNTER_INDEX_NONE;
+    op->wait_listed = 0;
+    return first - 1;
+}
+
+// Consegna uno sportello appena liberato: va all'operatore del suo servizio in
+// attesa da più tempo, che lo trova già assegnato (counter_id) al risveglio,
+// altrimenti entra tra i liberi. Ritorna l'operatore da svegliare o -1
+int counter_handoff(SharedMemory *shm, int counter_id)
+{
+    counter_unstaff(shm, counter_id);
+
+    int op_id = waiting_operator_dequeue(shm, SHM_COUNTERS(shm)[counter_id].current_service);
+    if (op_id < 0) {
+        counter_free_push(shm, counter_id);
+        return -1;
+    }
+    counter_staff(shm, counter_id, SHM_OPERATORS(shm)[op_id].pid);
+    SHM_OPERATORS(shm)[op_id].counter_id = counter_id;
+    SHM_OPERATORS(shm)[op_id].status = OPERATOR_WORKING;
+    return op_id;
+}
+
+#endif // COUNTER_INDEX_H
@@ -0,0 +1,266 @@
+#ifndef DAY_BARRIER_H
+#define DAY_BARRIER_H
+
+#include <stdio.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <stdatomic.h>
+#include "config.h"
+#include "futex_ops.h"
+
+// Barriera delle giornate in memoria condivisa, al posto di SIGUSR1/SIGUSR2
+// mandati dal direttore a ogni processo e di SEM_DAY_START. day_seq è una
+// generazione: dispari a giornata aperta, pari a giornata chiusa. Il
+// direttore la incrementa e fa un solo FUTEX_WAKE che sveglia tutti i
+// processi in attesa, qualunque sia il loro numero. Chi aspetta ricorda
+// l'ultima giornata vista, quindi non può rientrare due volte nella stessa
+// giornata né perdere un'apertura arrivata prima di addormentarsi.
+// Operatori e processi ticket dormono anche sulla propria parola futex:
+// futex_wait_either() li sveglia con il primo dei due eventi.
+// Nel verso opposto i figli confermano al direttore di essere pronti
+// (collegati e inizializzati) e, a ogni chiusura, di aver finito la
+// giornata: il direttore aspetta esattamente queste conferme invece di
+// pause fisse. Solo l'ultimo processo atteso fa FUTEX_WAKE.
+
+#define DAY_BARRIER_IS_OPEN(seq) (((seq) & 1U) != 0)
+#define HANDSHAKE_TIMEOUT_SEC 10    // Attesa massima senza nuove conferme
+
+void day_barrier_init(SharedMemory *shm);
+void day_barrier_open(SharedMemory *shm);
+void day_barrier_close(SharedMemory *shm);
+int day_barrier_is_current(SharedMemory *shm, unsigned int day);
+unsigned int day_barrier_wait_open(SharedMemory *shm, unsigned int last_day,
+                                   atomic_uint *own_word, volatile int *keep_waiting);
+void day_barrier_wait_close(SharedMemory *shm, unsigned int day,
+                            atomic_uint *own_word, volatile int *keep_waiting);
+void day_barrier_sleep(SharedMemory *shm, unsigned int day, atomic_uint *own_word, unsigned int own_seen);
+long day_barrier_sleep_until(SharedMemory *shm, unsigned int day, atomic_uint *own_word, unsigned int own_seen,
+                             const struct timespec *deadline);
+void day_barrier_print_latency(SharedMemory *shm, int day);
+void day_barrier_ready(SharedMemory *shm);
+void day_barrier_done(SharedMemory *shm);
+unsigned int day_barrier_wait_ready(SharedMemory *shm, unsigned int expected);
+unsigned int day_barrier_wait_done(SharedMemory *shm);
+
+// Implementazione delle funzioni
+
+long day_barrier_now_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+// Giornata chiusa e latenze azzerate (direttore, prima di creare i processi)
+void day_barrier_init(SharedMemory *shm)
+{
+    atomic_store_explicit(&shm->day_seq, 0, memory_order_relaxed);
+    atomic_store_explicit(&shm->day_start_latency_total_ns, 0, memory_order_relaxed);
+    atomic_store_explicit(&shm->day_start_latency_max_ns, 0, memory_order_relaxed);
+    atomic_store_explicit(&shm->day_start_woken, 0, memory_order_relaxed);
+    atomic_store_explicit(&shm->ready_count, 0, memory_order_relaxed);
+    atomic_store_explicit(&shm->done_count, 0, memory_order_relaxed);
+    atomic_store_explicit(&shm->daily_user_wakeups, 0, memory_order_relaxed);
+    shm->day_open_wake_count = 0;
+    shm->day_opened_ns = 0;
+    shm->ready_target = 0;
+    shm->done_target = 0;
+}
+
+// Apre la giornata (direttore): i dati della giornata vanno preparati prima,
+// l'incremento con rilascio li rende visibili a chi vede la nuova generazione
+void day_barrier_open(SharedMemory *shm)
+{
+    atomic_store_explicit(&shm->day_start_latency_total_ns, 0, memory_order_relaxed);
+    atomic_store_explicit(&shm->day_start_latency_max_ns, 0, memory_order_relaxed);
+    atomic_store_explicit(&shm->day_start_woken, 0, memory_order_relaxed);
+    atomic_store_explicit(&shm->done_count, 0, memory_order_relaxed);
+    atomic_store_explicit(&shm->daily_user_wakeups, 0, memory_order_relaxed);
+    shm->day_opened_ns = day_barrier_now_ns();
+    shm->day_in_progress = 1;
+
+    atomic_fetch_add_explicit(&shm->day_seq, 1, memory_order_release);
+    shm->day_open_wake_count = (int)futex_wake(&shm->day_seq, INT_MAX);
+}
+
+// Chiude la giornata (direttore). day_in_progress torna a 0 prima della
+// nuova generazione: chi si sveglia lo trova già aggiornato
+void day_barrier_close(SharedMemory *shm)
+{
+    shm->day_in_progress = 0;
+    atomic_fetch_add_explicit(&shm->day_seq, 1, memory_order_release);
+    futex_wake(&shm->day_seq, INT_MAX);
+}
+
+// 1 se la giornata day (valore restituito da day_barrier_wait_open) è ancora aperta
+int day_barrier_is_current(SharedMemory *shm, unsigned int day)
+{
+    return atomic_load_explicit(&shm->day_seq, memory_order_acquire) == day;
+}
+
+// Dorme finché la giornata day non cambia o qualcuno incrementa own_word
+// (se non è NULL), letto dal chiamante in own_seen prima di ricontrollare le
+// proprie condizioni. Ritorna subito se una delle due è già cambiata
+void day_barrier_sleep(SharedMemory *shm, unsigned int day, atomic_uint *own_word, unsigned int own_seen)
+{
+    if (own_word == NULL) {
+        futex_wait(&shm->day_seq, day, NULL);
+    } else {
+        futex_wait_either(own_word, own_seen, &shm->day_seq, day, NULL);
+    }
+}
+
+// Come day_barrier_sleep(), ma al più fino all'istante deadline
+// (CLOCK_MONOTONIC, assoluto). Ritorna -1 con ETIMEDOUT alla scadenza
+long day_barrier_sleep_until(SharedMemory *shm, unsigned int day, atomic_uint *own_word, unsigned int own_seen,
+                             const struct timespec *deadline)
+{
+    if (own_word == NULL) {
+        return futex_wait_until(&shm->day_seq, day, deadline);
+    }
+    return futex_wait_either_until(own_word, own_seen, &shm->day_seq, day, deadline);
+}
+
+// Registra quanto ci ha messo questo processo a ripartire dopo l'apertura
+void day_barrier_record_latency(SharedMemory *shm)
+{
+    long latency_ns = day_barrier_now_ns() - shm->day_opened_ns;
+    if (latency_ns < 0) {
+        latency_ns = 0;
+    }
+
+    atomic_fetch_add_explicit(&shm->day_start_latency_total_ns, latency_ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&shm->day_start_woken, 1, memory_order_relaxed);
+    long max_ns = atomic_load_explicit(&shm->day_start_latency_max_ns, memory_order_relaxed);
+    while (latency_ns > max_ns &&
+           !atomic_compare_exchange_weak_explicit(&shm->day_start_latency_max_ns, &max_ns, latency_ns,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+// Attende l'apertura di una giornata diversa da last_day (0 prima della
+// prima). Ritorna la giornata aperta, da passare alle altre funzioni, o 0 se
+// *keep_waiting è diventato 0 (terminazione). Con own_word non NULL si
+// sveglia anche quando qualcuno incrementa la parola, per ricontrollare
+// *keep_waiting. La latenza è registrata solo se il processo ha dormito
+unsigned int day_barrier_wait_open(SharedMemory *shm, unsigned int last_day,
+                                   atomic_uint *own_word, volatile int *keep_waiting)
+{
+    int slept = 0;
+
+    for (;;) {
+        unsigned int own_seen = own_word != NULL ? atomic_load_explicit(own_word, memory_order_acquire) : 0;
+        unsigned int day = atomic_load_explicit(&shm->day_seq, memory_order_acquire);
+        if (DAY_BARRIER_IS_OPEN(day) && day != last_day) {
+            if (slept) {
+                day_barrier_record_latency(shm);
+            }
+            return day;
+        }
+        if (!*keep_waiting) {
+            return 0;
+        }
+        day_barrier_sleep(shm, day, own_word, own_seen);
+        slept = 1;
+    }
+}
+
+// Attende la chiusura della giornata day (o la terminazione, come sopra)
+void day_barrier_wait_close(SharedMemory *shm, unsigned int day,
+                            atomic_uint *own_word, volatile int *keep_waiting)
+{
+    while (*keep_waiting) {
+        unsigned int own_seen = own_word != NULL ? atomic_load_explicit(own_word, memory_order_acquire) : 0;
+        if (!day_barrier_is_current(shm, day)) {
+            return;
+        }
+        day_barrier_sleep(shm, day, own_word, own_seen);
+    }
+}
+
+// Riepilogo dell'apertura della giornata (direttore, a fine giornata)
+void day_barrier_print_latency(SharedMemory *shm, int day)
+{
+    int woken = atomic_load_explicit(&shm->day_start_woken, memory_order_relaxed);
+    long total_ns = atomic_load_explicit(&shm->day_start_latency_total_ns, memory_order_relaxed);
+    long max_ns = atomic_load_explicit(&shm->day_start_latency_max_ns, memory_order_relaxed);
+
+    printf("Avvio giornata %d: 1 FUTEX_WAKE, %d processi svegliati, %d ripartiti, latenza media %.1f us, massima %.1f us\n",
+           day, shm->day_open_wake_count, woken,
+           woken > 0 ? total_ns / 1000.0 / woken : 0.0, max_ns / 1000.0);
+}
+
+// Conferma sul contatore count: sveglia il direttore solo se è l'ultima
+// attesa. Il rilascio rende visibili al direttore le scritture precedenti
+void day_barrier_post(atomic_uint *count, unsigned int target)
+{
+    unsigned int posted = atomic_fetch_add_explicit(count, 1, memory_order_acq_rel) + 1;
+    if (posted >= target) {
+        futex_wake(count, 1);
+    }
+}
+
+// Il processo figlio è collegato alla memoria condivisa e inizializzato
+void day_barrier_ready(SharedMemory *shm)
+{
+    day_barrier_post(&shm->ready_count, shm->ready_target);
+}
+
+// Il processo figlio ha chiuso la giornata: nessun'altra scrittura su
+// statistiche, sportelli o richieste fino all'apertura successiva
+void day_barrier_done(SharedMemory *shm)
+{
+    day_barrier_post(&shm->done_count, shm->done_target);
+}
+
+// Aspetta che count arrivi a target. Rinuncia dopo HANDSHAKE_TIMEOUT_SEC
+// senza nuove conferme (un processo morto o bloccato). Ritorna il valore raggiunto
+unsigned int day_barrier_wait_count(atomic_uint *count, unsigned int target)
+{
+    unsigned int seen = atomic_load_explicit(count, memory_order_acquire);
+    long deadline_ns = day_barrier_now_ns() + HANDSHAKE_TIMEOUT_SEC * 1000000000L;
+
+    while (seen < target) {
+        long remaining_ns = deadline_ns - day_barrier_now_ns();
+        if (remaining_ns <= 0) {
+            break;
+        }
+        struct timespec timeout = {.tv_sec = remaining_ns / 1000000000L, .tv_nsec = remaining_ns % 1000000000L};
+        futex_wait(count, seen, &timeout);
+
+        unsigned int now = atomic_load_explicit(count, memory_order_acquire);
+        if (now != seen) {
+            deadline_ns = day_barrier_now_ns() + HANDSHAKE_TIMEOUT_SEC * 1000000000L;
+            seen = now;
+        }
+    }
+    return seen;
+}
+
+// Direttore: aspetta che expected processi in totale siano pronti. Il
+// traguardo va fissato prima di creare i processi, perché la sveglia la
+// fa chi lo raggiunge
+unsigned int day_barrier_wait_ready(SharedMemory *shm, unsigned int expected)
+{
+    unsigned int ready = day_barrier_wait_count(&shm->ready_count, expected);
+    if (ready < expected) {
+        fprintf(stderr, "Direttore: solo %u processi su %u pronti dopo %d secondi, continuo\n",
+                ready, expected, HANDSHAKE_TIMEOUT_SEC);
+    }
+    return ready;
+}
+
+// Direttore, dopo day_barrier_close(): aspetta che tutti i processi abbiano
+// chiuso la giornata prima di unire le statistiche e svuotare le code
+unsigned int day_barrier_wait_done(SharedMemory *shm)
+{
+    unsigned int done = day_barrier_wait_count(&shm->done_count, shm->done_target);
+    if (done < shm->done_target) {
+        fprintf(stderr, "Direttore: solo %u processi su %u hanno chiuso la giornata, continuo\n",
+                done, shm->done_target);
+    }
+    return done;
+}
+
+#endif // DAY_BARRIER_H
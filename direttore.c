@@ -5,55 +5,89 @@
 #include <sys/time.h>
 #include <signal.h> // Necessario per la gestione dei segnali
 #include <time.h>
-#include <sys/msg.h>
 #include <sys/types.h>
 #include "config.h"
+#include "shm_layout.h"
+#include "shm_backend.h"
+#include "shm_sync.h"
+#include "statistics.h"
+#include "virtual_time.h"
+#include "counter_balance.h"
+#include "day_barrier.h"
 #include <sys/shm.h>
 #include <sys/ipc.h>
-#include <sys/sem.h>
 #include <string.h>
 #include <errno.h>
 #include <sys/wait.h>
 
-// Variabili globali per la memoria condivisa e i semafori
-int shmid = -1;
-int semid = -1;
+// Variabili globali per la memoria condivisa (il segmento è gestito da
+// shm_backend.h)
 SharedMemory *shared_memory = NULL;
 volatile sig_atomic_t alarm_triggered = 0; // Flag per l'alarm handler
 volatile sig_atomic_t cleanup_in_progress = 0; // Flag per prevenire re-entrata
+int virtual_time = 0; // Modalità --virtual-time: nessun processo figlio, memoria privata
+int flight_dump_reason = FLIGHT_DUMP_NONE; // Motivo per salvare il registratore di volo (flight_recorder.h)
+int flight_dump_signal = 0;
 
 // Handler per SIGALRM
 void alarm_handler(int signum __attribute__((unused))) {
     alarm_triggered = 1;
 }
 
-// Handler per la pulizia in caso di segnali di terminazione
-void cleanup_handler(int signum __attribute__((unused))) {
+// Salva il registratore di volo dopo un'esplosione o una terminazione
+// anomala, quando i processi figli sono già terminati
+void dump_flight_recorder(SharedMemory *shm) {
+    if (flight_dump_reason == FLIGHT_DUMP_NONE || shm->flight_capacity == 0) {
+        return;
+    }
+    long saved = flight_recorder_dump(FLIGHT_RECORDER_FILE, &shm->flight_next, SHM_FLIGHT_EVENTS(shm),
+                                      shm->flight_capacity, flight_dump_reason, flight_dump_signal);
+    if (saved < 0) {
+        printf("Registratore di volo: salvataggio in %s fallito: %s\n", FLIGHT_RECORDER_FILE, strerror(errno));
+    } else {
+        printf("Registratore di volo (%s): %ld eventi salvati in %s (./flight_decode %s)\n",
+               FLIGHT_DUMP_REASONS[flight_dump_reason], saved, FLIGHT_RECORDER_FILE, FLIGHT_RECORDER_FILE);
+    }
+}
+
+// Handler per la pulizia in caso di segnali di terminazione (signum 0 se
+// chiamato dal direttore stesso)
+void cleanup_handler(int signum) {
     if (cleanup_in_progress) {
         return;
     }
     cleanup_in_progress = 1;
 
+    if (signum != 0) {
+        flight_dump_reason = FLIGHT_DUMP_SIGNAL;
+        flight_dump_signal = signum;
+    }
+
     printf("Pulizia iniziata...\n");
 
-    // 1. Termina tutti i processi figli
-    if (shared_memory != NULL && shared_memory != (void *)-1) {
-        // Termina il processo ticket
-        if (shared_memory->ticket_pid > 0) {
-            kill(shared_memory->ticket_pid, SIGTERM);
+    // 1. Termina tutti i processi figli (in tempo virtuale non ce ne sono)
+    if (!virtual_time && shared_memory != NULL && shared_memory != (void *)-1) {
+        // Termina i processi ticket
+        for (int w = 0; w < shared_memory->ticket_worker_count; w++) {
+            if (shared_memory->ticket_workers[w].pid > 0) {
+                kill(shared_memory->ticket_workers[w].pid, SIGTERM);
+            }
         }
         
-        // Termina tutti gli utenti
-        for (int i = 0; i < NOF_USERS; i++) {
-            if (shared_memory->user_pids[i] > 0) {
-                kill(shared_memory->user_pids[i], SIGTERM);
+        // Termina tutti gli utenti (o l'host che li simula)
+        if (shared_memory->user_host_pid > 0) {
+            kill(shared_memory->user_host_pid, SIGTERM);
+        }
+        for (int i = 0; !USER_HOST && i < NOF_USERS; i++) {
+            if (SHM_USER_PIDS(shared_memory)[i] > 0) {
+                kill(SHM_USER_PIDS(shared_memory)[i], SIGTERM);
             }
         }
         
         // Termina tutti gli operatori
         for (int i = 0; i < NOF_WORKERS; i++) {
-            if (shared_memory->operator_pids[i] > 0) {
-                kill(shared_memory->operator_pids[i], SIGTERM);
+            if (SHM_OPERATOR_PIDS(shared_memory)[i] > 0) {
+                kill(SHM_OPERATOR_PIDS(shared_memory)[i], SIGTERM);
             }
         }
 
@@ -71,6 +105,11 @@ void cleanup_handler(int signum __attribute__((unused))) {
             
             if (wpid > 0) {
                 children_terminated++;
+                // Un figlio ucciso da un segnale diverso da quello della pulizia è un crash
+                if (WIFSIGNALED(status) && WTERMSIG(status) != SIGTERM && flight_dump_reason == FLIGHT_DUMP_NONE) {
+                    flight_dump_reason = FLIGHT_DUMP_CHILD_CRASH;
+                    flight_dump_signal = WTERMSIG(status);
+                }
                 timeout_count = 0; // Reset timeout se termina un processo
             } else if (wpid == 0) {
                 // Nessun processo terminato, incrementa timeout
@@ -91,36 +130,26 @@ void cleanup_handler(int signum __attribute__((unused))) {
         if (timeout_count >= MAX_TIMEOUT) {
             printf("Timeout raggiunto nel cleanup dei processi figli. Procedendo comunque...\n");
         }
+
+        dump_flight_recorder(shared_memory);
     }
     
-    // 2. Pulisci la coda di messaggi
+    // 2. Pulisci la memoria condivisa (contiene anche la coda di invio delle richieste)
     printf("Pulendo le risorse IPC...\n");
-    int msgid = msgget(MSG_QUEUE_KEY, 0666);
-    if (msgid != -1) {
-        if (msgctl(msgid, IPC_RMID, NULL) == -1) {
-            perror("Failed to remove message queue");
-        }
-    }
-    
-    // 3. Pulisci la memoria condivisa
     if (shared_memory != NULL && shared_memory != (void *)-1) {
-        shmdt(shared_memory);
+        if (virtual_time) {
+            // In tempo virtuale la "memoria condivisa" è privata del direttore
+            free(shared_memory);
+            vt_destroy();
+        } else {
+            shm_segment_detach(shared_memory);
+            shm_segment_remove();
+        }
         shared_memory = NULL;
     }
     
-    if (shmid != -1) {
-        shmctl(shmid, IPC_RMID, NULL);
-        shmid = -1;
-    }
-    
-    // 4. Pulisci i semafori
-    if (semid != -1) {
-        semctl(semid, 0, IPC_RMID);
-        semid = -1;
-    }
-    
     printf("Pulizia completata.\n");
-    // 5. Esci dal programma
+    // 3. Esci dal programma
     exit(EXIT_SUCCESS);
 }
 
@@ -129,9 +158,12 @@ void handle_timeout(int signum __attribute__((unused))) {
     printf("Simulation timeout reached. Cleaning up...\n");
     
     // Notifica tutti i processi di terminare
-    for (int i = 0; i < NOF_USERS; i++) {
-        if (shared_memory->user_pids[i] > 0) {
-            kill(shared_memory->user_pids[i], SIGTERM);
+    if (shared_memory->user_host_pid > 0) {
+        kill(shared_memory->user_host_pid, SIGTERM);
+    }
+    for (int i = 0; !USER_HOST && i < NOF_USERS; i++) {
+        if (SHM_USER_PIDS(shared_memory)[i] > 0) {
+            kill(SHM_USER_PIDS(shared_memory)[i], SIGTERM);
         }
     }
     
@@ -146,7 +178,7 @@ void create_users(SharedMemory *shm_ptr)
         if (user_pid == 0)
         {
             // Processi figli
-            char user_id[10];
+            char user_id[12];
             snprintf(user_id, sizeof(user_id), "%d", i);
             execl("./utente", "./utente", user_id, NULL);
             perror("execl failed for utente");
@@ -161,30 +193,62 @@ void create_users(SharedMemory *shm_ptr)
         else
         {
             // Processo padre: Memorizza il PID nella memoria condivisa
-            shm_ptr->user_pids[i] = user_pid;
+            SHM_USER_PIDS(shm_ptr)[i] = user_pid;
         }
     }
 }
 
-void create_ticket_process(SharedMemory *shm_ptr)
+// Crea un unico processo che simula tutti gli utenti (USER_HOST=1)
+void create_user_host(SharedMemory *shm_ptr)
 {
-    pid_t ticket_pid = fork();
-    if (ticket_pid == 0)
+    pid_t host_pid = fork();
+    if (host_pid == 0)
     {
-        // Processi figli
-        execl("./ticket", "./ticket", NULL);
-        perror("execl failed for ticket");
+        // Processo figlio
+        execl("./utenti", "./utenti", NULL);
+        perror("execl failed for utenti");
         exit(EXIT_FAILURE);
     }
-    else if (ticket_pid < 0)
+    else if (host_pid < 0)
     {
-        perror("fork for ticket failed");
+        perror("fork for utenti failed");
+        cleanup_handler(0); // Chiamata a cleanup in caso di errore di fork
         exit(EXIT_FAILURE);
     }
     else
     {
-        // Processo genitore: Memorizza il PID in memoria condivisa
-        shm_ptr->ticket_pid = ticket_pid;
+        // Processo padre: Memorizza il PID nella memoria condivisa
+        shm_ptr->user_host_pid = host_pid;
+    }
+}
+
+// Crea i processi ticket: ognuno riceve l'indice del worker e gestisce i
+// servizi con service % ticket_worker_count == indice
+void create_ticket_processes(SharedMemory *shm_ptr)
+{
+    for (int w = 0; w < shm_ptr->ticket_worker_count; w++)
+    {
+        char worker_id[12];
+        snprintf(worker_id, sizeof(worker_id), "%d", w);
+
+        pid_t ticket_pid = fork();
+        if (ticket_pid == 0)
+        {
+            // Processi figli
+            execl("./ticket", "./ticket", worker_id, NULL);
+            perror("execl failed for ticket");
+            exit(EXIT_FAILURE);
+        }
+        else if (ticket_pid < 0)
+        {
+            perror("fork for ticket failed");
+            exit(EXIT_FAILURE);
+        }
+        else
+        {
+            // Processo genitore: Memorizza il PID in memoria condivisa
+            shm_ptr->ticket_workers[w].pid = ticket_pid;
+        }
     }
 }
 
@@ -194,9 +258,9 @@ void create_operators(SharedMemory *shm_ptr)
 
     // Inizializza gli operatori in memoria condivisa
     for (int i = 0; i < NOF_WORKERS; i++) {
-        shm_ptr->operators[i].active = 1;
-        shm_ptr->operators[i].total_served = 0;
-        shm_ptr->operators[i].total_pauses = 0;
+        SHM_OPERATORS(shm_ptr)[i].active = 1;
+        SHM_OPERATORS(shm_ptr)[i].total_served = 0;
+        SHM_OPERATORS(shm_ptr)[i].total_pauses = 0;
     }
 
     // Crea i processi operatore
@@ -206,7 +270,7 @@ void create_operators(SharedMemory *shm_ptr)
         if (operator_pid == 0)
         {
             // Processi figli
-            char operator_id[10];
+            char operator_id[12];
             snprintf(operator_id, sizeof(operator_id), "%d", i);
             execl("./operatore", "./operatore", operator_id, NULL);
             perror("execl failed for operatore");
@@ -220,803 +284,101 @@ void create_operators(SharedMemory *shm_ptr)
         else
         {
             // Processo padre: Memorizza il PID
-            shm_ptr->operator_pids[i] = operator_pid;
-            shm_ptr->operators[i].pid = operator_pid;
+            SHM_OPERATOR_PIDS(shm_ptr)[i] = operator_pid;
+            SHM_OPERATORS(shm_ptr)[i].pid = operator_pid;
         }
     }
     printf("Tutti gli operatori creati con successo.\n");
 }
 
-// Inizializza gli sportelli con servizi casuali all'inizio di ogni giornata
-void initialize_counters_for_day(SharedMemory *shm_ptr)
-{
-    // Generatore di numeri casuali
-    srand(time(NULL) ^ shm_ptr->simulation_day);
-    
-    for (int counter_idx = 0; counter_idx < NOF_WORKER_SEATS; counter_idx++) {
-        // Genera un servizio casuale
-        int random_service = rand() % SERVICE_COUNT;
-        
-        // Inizializza lo sportello
-        shm_ptr->counters[counter_idx].active = 1;
-        shm_ptr->counters[counter_idx].current_service = random_service;
-        shm_ptr->counters[counter_idx].operator_pid = 0;
-        shm_ptr->counters[counter_idx].total_served = 0;
-        
-        // DEBUG: stampa l'inizializzazione dello sportello
-        //printf("Sportello %d: Servizio %s (%d)\n", counter_idx, SERVICE_NAMES[random_service], random_service);
-    }
-
-}
-
-// Funzione per gestire la condizione di "esplosione"
-void handle_explode_condition(SharedMemory *shm) {
-    int total_waiting_users = 0;
-    for (int i = 0; i < SERVICE_COUNT; i++) {
-        total_waiting_users += shm->service_tickets_waiting[i];
-    }
-
+// Funzione per gestire la condizione di "esplosione": total_waiting_users
+// sono gli utenti in coda quando la soglia è stata superata
+void handle_explode_condition(int total_waiting_users) {
     if (total_waiting_users > EXPLODE_THRESHOLD) {
         printf("\n\n[EXPLODE] Il numero totale di utenti in coda (%d) ha superato la soglia di %d.\nLa simulazione termina per congestione eccessiva.\n\n", total_waiting_users, EXPLODE_THRESHOLD);
+        flight_record(shared_memory, FLIGHT_EXPLODE, -1, 0, total_waiting_users, EXPLODE_THRESHOLD);
+        flight_dump_reason = FLIGHT_DUMP_EXPLODE;
         
         // Trigger cleanup e terminazione
         cleanup_handler(0);
     }
 }
 
-// Funzione per contare i ticket rimasti in coda alla fine della giornata
-void count_remaining_tickets(SharedMemory *shm) {
-    for (int i = 0; i < MAX_REQUESTS; i++) {
-        TicketRequest *ticket = &shm->ticket_requests[i];
-        
-        // Ticket ricevuto ma non servito con successo
-        if (ticket->status == REQUEST_COMPLETED && !ticket->served_successfully) {
-            
-            shm->daily_users_timeout[ticket->service_id]++;
-            shm->total_users_timeout++;
-            
-            // DEBUG: stampa conteggio
-            //printf("[CONTEGGIO] Ticket %s (utente #%d) non servito entro fine giornata - contato come interrotto\n", ticket->ticket_id, ticket->user_id);
-        }
-    }
-}
-
-// Funzione per svuotare tutte le code alla fine della giornata
-void clear_all_queues_at_day_end(SharedMemory *shm) {
-    //printf("[RESET] Svuotamento di tutte le code alla fine della giornata %d\n", shm->simulation_day);
-    
-    // Svuota tutte le code dei servizi
-    for (int service = 0; service < SERVICE_COUNT; service++) {
-        if (shm->service_tickets_waiting[service] > 0) {
-            // DEBUG: stampa quanti e quali ticket vengono scartati
-            //printf("[RESET] Servizio %s: %d ticket non serviti scartati\n", SERVICE_NAMES[service], shm->service_tickets_waiting[service]);
-        }
-        
-        // Reset delle code per questo servizio
-        shm->service_tickets_waiting[service] = 0;
-        shm->service_queue_head[service] = 0;
-        shm->service_queue_tail[service] = 0;
-        
-        // Pulisce anche l'array della coda
-        memset(shm->service_queues[service], 0, MAX_SERVICE_QUEUE * sizeof(int));
-    }
-    
-}
-
-// Funzione per stampare il riepilogo giornaliero unificato
-void print_daily_summary(SharedMemory *shm_ptr) {
-    // Calcola il numero di giorni completati
-    int days_completed = shm_ptr->simulation_day;
-    
-    // Calcola i valori SOLO del giorno corrente
-    int daily_users_served = 0;
-    int daily_services_not_provided = 0;
-    int daily_users_not_presented = 0;
-    
-    // Somma tutti i servizi del giorno corrente
-    for (int i = 0; i < SERVICE_COUNT; i++) {
-        daily_users_served += shm_ptr->daily_tickets_served[i];
-        daily_services_not_provided += shm_ptr->daily_users_home[i] + shm_ptr->daily_users_timeout[i] + shm_ptr->daily_users_no_ticket[i];
-        daily_users_not_presented += shm_ptr->daily_users_not_arrived[i];
-    }
-    
-    // Valori totali della simulazione
-    int total_services_not_provided = shm_ptr->total_services_not_provided_simulation;
-    int total_users_not_presented = shm_ptr->total_users_not_arrived;
-    
-    // Tabella unificata: Giornaliero | Totale Simulazione | Media Cumulativa
-    printf("\n+----------------------+--------------------+--------------------+--------------------+\n");
-    printf("| STATISTICHE UNIFICATE GIORNO %-3d                                         |\n", shm_ptr->simulation_day);
-    printf("+----------------------+--------------------+--------------------+--------------------+\n");
-    printf("|     Descrizione      |    Giornaliero     | Totale Simulazione |  Media Cumulativa  |\n");
-    printf("+----------------------+--------------------+--------------------+--------------------+\n");
-    
-    // Riga Utenti Serviti
-    double avg_users_served = days_completed > 0 ? (double)shm_ptr->total_users_served_simulation / days_completed : 0.0;
-    printf("| Utenti Serviti       | %-18d | %-18d | %-18.2f |\n", 
-           daily_users_served,  // SOLO del giorno corrente
-           shm_ptr->total_users_served_simulation, 
-           avg_users_served);
-    
-    // Riga Servizi Non Erogati 
-    double avg_services_not_provided = days_completed > 0 ? (double)total_services_not_provided / days_completed : 0.0;
-    printf("| Servizi Non Erogati  | %-18d | %-18d | %-18.2f |\n", 
-           daily_services_not_provided,  // SOLO del giorno corrente
-           total_services_not_provided, 
-           avg_services_not_provided);
-    
-    // Riga Utenti Non Presentati
-    double avg_users_not_presented = days_completed > 0 ? (double)total_users_not_presented / days_completed : 0.0;
-    printf("| Utenti Non Presentati| %-18d | %-18d | %-18.2f |\n", 
-           daily_users_not_presented,  // SOLO del giorno corrente
-           total_users_not_presented, 
-           avg_users_not_presented);
-    
-    printf("+----------------------+--------------------+--------------------+--------------------+\n");
-    
-    // Tabella dettagliata per servizio (solo giornaliera)
-    printf("\n+----------------------+----------------------+----------------------+----------------------+----------------------+----------------------+\n");
-    printf("| DETTAGLIO PER SERVIZIO - GIORNO %-3d                                                                               |\n", shm_ptr->simulation_day);
-    printf("+----------------------+----------------------+----------------------+----------------------+----------------------+----------------------+\n");
-    printf("|      Servizio       |  Utenti Serviti      |  Tornati a Casa      | Ticket Non Ricevuti  |  Servizio Interrotto |   Non Presentati    |\n");
-    printf("+----------------------+----------------------+----------------------+----------------------+----------------------+----------------------+\n");
-
-    int total_timeout = 0;
-    int total_no_ticket = 0;
-    int total_not_arrived = 0;
-    for (int i = 0; i < SERVICE_COUNT; i++) {
-        printf("| %-20s | %-20d | %-20d | %-20d | %-20d | %-20d |\n",
-               SERVICE_NAMES[i],
-               shm_ptr->daily_tickets_served[i],
-               shm_ptr->daily_users_home[i],
-               shm_ptr->daily_users_no_ticket[i],
-               shm_ptr->daily_users_timeout[i],
-               shm_ptr->daily_users_not_arrived[i]);
-        total_timeout += shm_ptr->daily_users_timeout[i];
-        total_no_ticket += shm_ptr->daily_users_no_ticket[i];
-        total_not_arrived += shm_ptr->daily_users_not_arrived[i];
-    }
-
-    printf("+----------------------+----------------------+----------------------+----------------------+----------------------+----------------------+\n");
-    printf("| Totale               | %-20d | %-20d | %-20d | %-20d | %-20d |\n",
-           daily_users_served,  // Usa il valore giornaliero calcolato
-           shm_ptr->total_users_home,
-           total_no_ticket,
-           total_timeout,
-           total_not_arrived);
-    printf("+----------------------+----------------------+----------------------+----------------------+----------------------+----------------------+\n");
-}
-
-// Funzione per notificare tutti i processi con un segnale specifico
-void notify_all_processes(SharedMemory *shm, int signum) {
-    const char *signal_name;
-    if (signum == SIGUSR1) {
-        signal_name = "SIGUSR1";
-    } else if (signum == SIGUSR2) {
-        signal_name = "SIGUSR2";
-    } else {
-        signal_name = "Unknown Signal";
-    }
-
-    // Notifica il processo ticket
-    if (shm->ticket_pid > 0) {
-        if (kill(shm->ticket_pid, signum) < 0) {
-            char error_msg[100];
-            snprintf(error_msg, sizeof(error_msg), "Impossibile inviare %s al processo ticket", signal_name);
-            perror(error_msg);
-        }
-    }
-
-    // Notifica tutti gli operatori
-    for (int i = 0; i < NOF_WORKERS; i++) {
-        if (shm->operator_pids[i] > 0) {
-            if (kill(shm->operator_pids[i], signum) < 0) {
-                char error_msg[100];
-                snprintf(error_msg, sizeof(error_msg), "Impossibile inviare %s all'operatore %d", signal_name, i);
-                perror(error_msg);
+// Ribilanciamento degli sportelli durante la giornata (counter_balance.h).
+// last_served contiene i ticket serviti al ribilanciamento precedente.
+// Lo sportello libero cambia servizio e va subito a un operatore in attesa;
+// quello occupato viene marcato e l'operatore lo lascia dopo il cliente in corso
+void rebalance_counters(SharedMemory *shm, int *last_served) {
+    int recent_served[SERVICE_COUNT];
+    for (int s = 0; s < SERVICE_COUNT; s++) {
+        int served = operator_stats_served(shm, s);
+        recent_served[s] = served - last_served[s];
+        last_served[s] = served;
+    }
+
+    shm_mutex_lock(&shm->counters_lock, "sportelli");
+
+    int counter_id, service;
+    if (rebalance_pick_move(shm, recent_served, &counter_id, &service)) {
+        Counter *counter = &SHM_COUNTERS(shm)[counter_id];
+        if (counter->operator_pid == 0) {
+            // Lo sportello lascia i liberi del vecchio servizio e va al primo in coda del nuovo
+            counter_free_remove(shm, counter_id);
+            flight_record(shm, FLIGHT_COUNTER_MOVE, service, counter_id, counter->current_service, 0);
+            counter->current_service = service;
+            int op_id = counter_handoff(shm, counter_id);
+            if (op_id >= 0) {
+                operator_wakeup(shm, op_id);
             }
-        }
-    }
-
-    // Notifica tutti gli utenti
-    for (int i = 0; i < NOF_USERS; i++) {
-        if (shm->user_pids[i] > 0) {
-            if (kill(shm->user_pids[i], signum) < 0) {
-                char error_msg[100];
-                snprintf(error_msg, sizeof(error_msg), "Impossibile inviare %s all'utente %d", signal_name, i);
-                perror(error_msg);
+        } else {
+            counter->handover_to = service + 1;
+            flight_record(shm, FLIGHT_COUNTER_MOVE, service, counter_id, counter->current_service, 1);
+            // Un operatore inattivo dorme sul futex: va svegliato per lasciare lo sportello
+            for (int op_id = 0; op_id < NOF_WORKERS; op_id++) {
+                if (SHM_OPERATORS(shm)[op_id].pid == counter->operator_pid) {
+                    operator_wakeup(shm, op_id);
+                    break;
+                }
             }
         }
-    }
-}
+        shm->daily_counter_moves++;
+        shm->total_counter_moves++;
 
-// Funzione per raccogliere le statistiche di fine giornata
-void collect_daily_statistics(SharedMemory *shm, int day_index) {
-    // Calcola gli utenti serviti SOLO per questo giorno
-    int daily_users_served = 0;
-    for (int i = 0; i < SERVICE_COUNT; i++) {
-        daily_users_served += shm->daily_tickets_served[i];
-    }
-    
-    // Raccoglie le statistiche aggregate della giornata
-    shm->users_served_per_day[day_index] = daily_users_served;
-    shm->total_users_served_simulation += daily_users_served;  // Aggiunge solo quelli del giorno corrente
-    
-    // Calcola servizi non erogati totali per questa giornata
-    int daily_services_not_provided = 0;
-    int daily_total_wait_count = 0;
-    long daily_total_wait_time = 0;
-    int daily_total_service_count = 0;
-    long daily_total_service_time = 0;
-    
-    for (int i = 0; i < SERVICE_COUNT; i++) {
-        // Servizi non erogati = utenti tornati a casa + timeout + no ticket
-        int service_not_provided = shm->daily_users_home[i] + shm->daily_users_timeout[i] + shm->daily_users_no_ticket[i];
-        daily_services_not_provided += service_not_provided;
-        
-        // Raccoglie statistiche per servizio per questo giorno
-        // usa una matrice 2D [servizio][giorno]
-        shm->users_served_per_service_per_day[i][day_index] = shm->daily_tickets_served[i];
-        shm->services_not_provided_per_service_per_day[i][day_index] = service_not_provided;
-        shm->total_wait_time_per_service_per_day[i][day_index] = shm->total_wait_time[i];
-        shm->wait_count_per_service_per_day[i][day_index] = shm->wait_count[i];
-        shm->total_service_time_per_service_per_day[i][day_index] = shm->total_service_time[i];
-        shm->service_count_per_service_per_day[i][day_index] = shm->service_count[i];
-        
-        // Accumula per le statistiche aggregate giornaliere
-        daily_total_wait_count += shm->wait_count[i];
-        daily_total_wait_time += shm->total_wait_time[i];
-        daily_total_service_count += shm->service_count[i];
-        daily_total_service_time += shm->total_service_time[i];
+        // DEBUG: stampa ribilanciamento
+        //printf("[RIBILANCIAMENTO] Sportello %d passa al servizio %s\n", counter_id, SERVICE_NAMES[service]);
     }
-    
-    shm->services_not_provided_per_day[day_index] = daily_services_not_provided;
-    shm->total_services_not_provided_simulation += daily_services_not_provided;
-    
-    shm->total_wait_time_per_day[day_index] = daily_total_wait_time;
-    shm->wait_count_per_day[day_index] = daily_total_wait_count;
-    shm->total_service_time_per_day[day_index] = daily_total_service_time;
-    shm->service_count_per_day[day_index] = daily_total_service_count;
-    
-    // Conta operatori attivi e pause per questo giorno
-    int daily_operators_active = 0;
-    int daily_total_pauses = 0;
-    
-    for (int i = 0; i < NOF_WORKERS; i++) {
-        // Conto le pause degli operatori attivi
-        if (shm->operators[i].active && shm->operators[i].total_served > 0) {
-            daily_operators_active++;
-        }
-        daily_total_pauses += shm->operators[i].total_pauses;
-    }
-    
-    // Calcola le pause SOLO di questo giorno
-    int pauses_for_this_day_only = 0;
-    if (day_index == 0) {
-        // Primo giorno: usa il totale corrente
-        pauses_for_this_day_only = daily_total_pauses;
-    } else {
-        // Giorni successivi: calcola la differenza tra totale corrente e totale simulazione precedente
-        int previous_total = shm->total_pauses_simulation;
-        pauses_for_this_day_only = daily_total_pauses - previous_total;
-        // Assicurati che non sia mai negativo
-        if (pauses_for_this_day_only < 0) {
-            pauses_for_this_day_only = 0;
-        }
-    }
-    
-    shm->operators_active_per_day[day_index] = daily_operators_active;
-    shm->pauses_per_day[day_index] = pauses_for_this_day_only; // Solo le pause di questo giorno
-    shm->total_pauses_simulation += pauses_for_this_day_only;
-    
-    // Conta operatori attivi per servizio e aggiorna le somme totali
-    for (int service = 0; service < SERVICE_COUNT; service++) {
-        int active_operators_for_service = 0;
-        
-        // Conta gli operatori attivi per questo servizio specifico
-        for (int i = 0; i < NOF_WORKERS; i++) {
-            if (shm->operators[i].active && 
-                (int)shm->operators[i].current_service == service && 
-                shm->operators[i].total_served > 0) {
-                active_operators_for_service++;
-            }
-        }
-        
-        // Somma al totale per questo servizio
-        shm->operators_active_per_service_total[service] += active_operators_for_service;
-    }
-    
-    // Calcola le medie cumulative progressive fino al giorno corrente
-    shm->cumulative_avg_users_served[day_index] = (double)shm->total_users_served_simulation / (day_index + 1);
-    shm->cumulative_avg_services_provided[day_index] = (double)shm->total_services_provided_simulation / (day_index + 1);
-    shm->cumulative_avg_services_not_provided[day_index] = (double)shm->total_services_not_provided_simulation / (day_index + 1);
-    
-}
 
-// Funzione per convertire nanosecondi in minuti simulati
-double nanoseconds_to_simulated_minutes(long nanoseconds) {
-    
-    double real_seconds = nanoseconds / 1000000000.0;
-    
-    // Converte secondi reali in minuti simulati
-    double simulated_minutes = (real_seconds / DAY_SIMULATION_TIME) * WORK_DAY_MINUTES;
-    
-    return simulated_minutes;
+    shm_mutex_unlock(&shm->counters_lock);
 }
 
-// Funzione per stampare la tabella separata dei tempi di servizio
-void print_service_timing_statistics_table(SharedMemory *shm, int days_completed) {
-    printf("\n+----------------------+----------+----------+----------+----------+----------+----------+----------+----------+\n");
-    printf("| STATISTICHE TEMPI DI SERVIZIO                                                                  |\n");
-    printf("+----------------------+----------+----------+----------+----------+----------+----------+----------+----------+\n");
-    printf("|      Servizio        | Tempo    | Tempo    | Tempo    | Tempo    | Minimo   | Minimo   | Massimo  | Massimo  |\n");
-    printf("|                      | Serv.    | Serv.    | Serv.    | Serv.    | Giorno   | Giorno   | Giorno   | Giorno   |\n");
-    printf("|                      | Medio    | Medio    | Medio    | Medio    | (Sec)    | (Min)    | (Sec)    | (Min)    |\n");
-    printf("|                      | Giorno   | Simul.   | Giorno   | Simul.   |          |          |          |          |\n");
-    printf("+----------------------+----------+----------+----------+----------+----------+----------+----------+----------+\n");
-    
-    for (int i = 0; i < SERVICE_COUNT; i++) {
-        int total_service_count_service = 0;
-        long total_service_time_service = 0;
-        
-        // Calcola statistiche per tutta la simulazione
-        for (int day = 0; day < SIM_DURATION; day++) {
-            total_service_time_service += shm->total_service_time_per_service_per_day[i][day];
-            total_service_count_service += shm->service_count_per_service_per_day[i][day];
-        }
-        
-        // Calcola la media del tempo di servizio per l'ultimo giorno
-        double avg_service_time_daily = 0;
-        int last_day = days_completed - 1;
-        if (last_day >= 0 && shm->service_count_per_service_per_day[i][last_day] > 0) {
-            avg_service_time_daily = (double)shm->total_service_time_per_service_per_day[i][last_day] / 
-                                   shm->service_count_per_service_per_day[i][last_day] / 1000000000.0;
-        }
-        
-        // Calcola la media del tempo di servizio per tutta la simulazione
-        double avg_service_time_simulation = 0;
-        if (total_service_count_service > 0) {
-            avg_service_time_simulation = (double)total_service_time_service / total_service_count_service / 1000000000.0; // Converti in secondi
-        }
-
-        double min_service_time_sec = shm->min_service_time[i] == LONG_MAX ? 0 : shm->min_service_time[i] / 1000000000.0;
-        double max_service_time_sec = shm->max_service_time[i] / 1000000000.0;
-        
-        // Calcola i tempi in minuti simulati usando la funzione di conversione
-        double avg_service_time_daily_min = 0;
-        double avg_service_time_simulation_min = 0;
-        
-        if (last_day >= 0 && shm->service_count_per_service_per_day[i][last_day] > 0) {
-            long avg_nano_daily = shm->total_service_time_per_service_per_day[i][last_day] / 
-                                 shm->service_count_per_service_per_day[i][last_day];
-            avg_service_time_daily_min = nanoseconds_to_simulated_minutes(avg_nano_daily);
-        }
-        
-        if (total_service_count_service > 0) {
-            long avg_nano_simulation = total_service_time_service / total_service_count_service;
-            avg_service_time_simulation_min = nanoseconds_to_simulated_minutes(avg_nano_simulation);
-        }
-
-        double min_service_time_min = shm->min_service_time[i] == LONG_MAX ? 0 : nanoseconds_to_simulated_minutes(shm->min_service_time[i]);
-        double max_service_time_min = nanoseconds_to_simulated_minutes(shm->max_service_time[i]);
-        
-        // Buffer per formattare i valori
-        char val1[10], val2[10], val3[10], val4[10], val5[10], val6[10], val7[10], val8[10];
-        
-        snprintf(val1, sizeof(val1), avg_service_time_daily > 0 ? "%.3f" : "N/A", avg_service_time_daily);
-        snprintf(val2, sizeof(val2), avg_service_time_simulation > 0 ? "%.3f" : "N/A", avg_service_time_simulation);
-        snprintf(val3, sizeof(val3), avg_service_time_daily_min > 0 ? "%.3f" : "N/A", avg_service_time_daily_min);
-        snprintf(val4, sizeof(val4), avg_service_time_simulation_min > 0 ? "%.3f" : "N/A", avg_service_time_simulation_min);
-        snprintf(val5, sizeof(val5), min_service_time_sec > 0 ? "%.3f" : "N/A", min_service_time_sec);
-        snprintf(val6, sizeof(val6), min_service_time_min > 0 ? "%.3f" : "N/A", min_service_time_min);
-        snprintf(val7, sizeof(val7), max_service_time_sec > 0 ? "%.3f" : "N/A", max_service_time_sec);
-        snprintf(val8, sizeof(val8), max_service_time_min > 0 ? "%.3f" : "N/A", max_service_time_min);
-        
-        printf("| %-20s | %8s | %8s | %8s | %8s | %8s | %8s | %8s | %8s |\n",
-               SERVICE_NAMES[i], val1, val2, val3, val4, val5, val6, val7, val8);
+// Cambi di contesto degli operatori nella giornata, rispetto ai clienti
+// serviti: con l'attesa a eventi ogni servizio costa pochi risvegli.
+// Da chiamare dopo le conferme di fine giornata e prima di unire i registri
+void print_operator_context_switches(SharedMemory *shm, int day) {
+    long switches = 0;
+    for (int op_id = 0; op_id < NOF_WORKERS; op_id++) {
+        switches += SHM_OPERATORS(shm)[op_id].day_context_switches;
     }
-    
-    printf("+----------------------+----------+----------+----------+----------+----------+----------+----------+----------+\n");
-}
-
-// Funzione per stampare le statistiche complete finali
-void print_comprehensive_statistics(SharedMemory *shm, int days_completed) {
-    printf("\n");
-    printf("================================================================================\n");
-    printf("                     STATISTICHE DETTAGLIATE DELLA SIMULAZIONE\n");
-    printf("================================================================================\n");
-    
-    // Calcoli preliminari
-    int total_operators_active = 0;
-    long total_wait_time_simulation = 0;
-    int total_wait_count_simulation = 0;
-    long total_service_time_simulation = 0;
-    int total_service_count_simulation = 0;
-    
-    for (int i = 0; i < SERVICE_COUNT; i++) {
-        total_wait_time_simulation += shm->total_wait_time[i];
-        total_wait_count_simulation += shm->wait_count[i];
-        total_service_time_simulation += shm->total_service_time[i];
-        total_service_count_simulation += shm->service_count[i];
-    }
-    
-    for (int i = 0; i < NOF_WORKERS; i++) {
-        if (shm->operators[i].total_served > 0) {
-            total_operators_active++;
-        }
-    }
-    
-    double avg_operators_per_day = 0;
-    for (int day = 0; day < days_completed; day++) {
-        avg_operators_per_day += shm->operators_active_per_day[day];
-    }
-    if (days_completed > 0) {
-        avg_operators_per_day /= days_completed;
-    }
-    
-    // TABELLA 1: RAPPORTO OPERATORI/SPORTELLI PER SERVIZIO (ultima giornata)
-    printf("\n+----------------------+--------------------+--------------------+--------------------+--------------------+--------------------+\n");
-    printf("| RAPPORTO OPERATORI/SPORTELLI PER SERVIZIO (ultima giornata)                                                               |\n");
-    printf("+----------------------+--------------------+--------------------+--------------------+--------------------+--------------------+\n");
-    printf("|      Servizio        |     Sportelli      |     Operatori      |      Rapporto      |   Op. Attivi       |   Op. Attivi       |\n");
-    printf("|                      |                    |                    |                    |   Ultimo Giorno    |   Tutti i Giorni   |\n");
-    printf("+----------------------+--------------------+--------------------+--------------------+--------------------+--------------------+\n");
-    
-    // Calcola statistiche generali degli operatori
-    int total_operators_active_last_day = 0;
-    int total_operators_active_simulation = 0;
-    int total_pauses_last_day = 0;
-    int total_pauses_simulation = 0;
-    
-    if (days_completed > 0) {
-        total_operators_active_last_day = shm->operators_active_per_day[days_completed - 1];
-        // Le pause dell'ultimo giorno sono già calcolate correttamente come differenziali
-        total_pauses_last_day = shm->pauses_per_day[days_completed - 1];
-    }
-    
-    // Calcola totale operatori attivi e pause in tutta la simulazione
-    for (int day = 0; day < days_completed; day++) {
-        total_operators_active_simulation += shm->operators_active_per_day[day];
-        total_pauses_simulation += shm->pauses_per_day[day];
-    }
-    
-    for (int service = 0; service < SERVICE_COUNT; service++) {
-        // Array per memorizzare gli sportelli e operatori per questo servizio
-        int *counters_for_service = malloc(NOF_WORKER_SEATS * sizeof(int));
-        int *operators_for_service = malloc(NOF_WORKERS * sizeof(int));
-        int counter_count = 0;
-        int operator_count = 0;
-        int active_operators_for_service_last_day = 0;
-        int active_operators_for_service_all_days = 0;
-        
-        // Trova tutti gli sportelli assegnati a questo servizio per la giornata corrente
-        for (int i = 0; i < NOF_WORKER_SEATS; i++) {
-            if (shm->counters[i].active && (int)shm->counters[i].current_service == service) {
-                counters_for_service[counter_count++] = i;
-            }
-        }
-        
-        // Trova tutti gli operatori che hanno questo servizio come servizio fisso
-        for (int i = 0; i < NOF_WORKERS; i++) {
-            if (shm->operators[i].active && (int)shm->operators[i].current_service == service) {
-                operators_for_service[operator_count++] = i;
-                // Conta quelli che hanno effettivamente servito utenti nell'ultimo giorno
-                if (shm->operators[i].total_served > 0) {
-                    active_operators_for_service_last_day++;
-                }
-            }
-        }
-        
-        // Calcola operatori attivi per questo servizio da tutta la simulazione
-        active_operators_for_service_all_days = shm->operators_active_per_service_total[service];
-        
-        // Crea stringhe per sportelli e operatori
-        char counters_str[200] = "";
-        char operators_str[200] = "";
-        
-        // Formatta la lista degli sportelli
-        for (int i = 0; i < counter_count; i++) {
-            char temp[10];
-            snprintf(temp, sizeof(temp), "%d", counters_for_service[i]);
-            if (strlen(counters_str) + strlen(temp) < sizeof(counters_str) - 1) strncat(counters_str, temp, sizeof(counters_str) - strlen(counters_str) - 1);
-            if (i < counter_count - 1 && strlen(counters_str) + 2 < sizeof(counters_str)) strncat(counters_str, ",", sizeof(counters_str) - strlen(counters_str) - 1);
-        }
-        if (counter_count == 0) strncpy(counters_str, "Nessuno", sizeof(counters_str) - 1);
-        counters_str[sizeof(counters_str) - 1] = '\0';
-        
-        // Formatta la lista degli operatori
-        for (int i = 0; i < operator_count; i++) {
-            char temp[10];
-            snprintf(temp, sizeof(temp), "%d", operators_for_service[i]);
-            if (strlen(operators_str) + strlen(temp) < sizeof(operators_str) - 1) strncat(operators_str, temp, sizeof(operators_str) - strlen(operators_str) - 1);
-            if (i < operator_count - 1 && strlen(operators_str) + 2 < sizeof(operators_str)) strncat(operators_str, ",", sizeof(operators_str) - strlen(operators_str) - 1);
-        }
-        if (operator_count == 0) strncpy(operators_str, "Nessuno", sizeof(operators_str) - 1);
-        operators_str[sizeof(operators_str) - 1] = '\0';
-        
-        // Calcola il rapporto
-        double ratio = counter_count > 0 ? (double)operator_count / counter_count : 0.0;
-        
-        printf("| %-20s | %-18s | %-18s | %18.2f | %18d | %18d |\n",
-               SERVICE_NAMES[service], 
-               counters_str,
-               operators_str,
-               ratio,
-               active_operators_for_service_last_day,
-               active_operators_for_service_all_days);
-        
-        free(counters_for_service);
-        free(operators_for_service);
-    }
-    printf("+----------------------+--------------------+--------------------+--------------------+--------------------+--------------------+\n");
-    
-    // Riga separata per le pause totali
-    printf("| %-20s | %-18s | %-18s | %18s | %18d | %18d |\n",
-           "PAUSE TOTALI", 
-           "-",
-           "-", 
-           "-",
-           total_pauses_last_day,
-           total_pauses_simulation);
-    printf("+----------------------+--------------------+--------------------+--------------------+--------------------+--------------------+\n");
-    
-    // TABELLA 2: STATISTICHE GENERALI OPERATORI E PAUSE
-    printf("\n+--------------------------------+--------------------+--------------------+--------------------+\n");
-    printf("| STATISTICHE OPERATORI E PAUSE                                                              |\n");
-    printf("+--------------------------------+--------------------+--------------------+--------------------+\n");
-    printf("| Descrizione                    | Ultimo Giorno      | Totale Simulazione | Media al Giorno    |\n");
-    printf("+--------------------------------+--------------------+--------------------+--------------------+\n");
-    printf("| Operatori Attivi               | %-18d | %-18d | %-18.2f |\n", 
-           total_operators_active_last_day, total_operators_active_simulation,
-           days_completed > 0 ? (double)total_operators_active_simulation / days_completed : 0.0);
-    printf("| Pause Totali                   | %-18d | %-18d | %-18.2f |\n", 
-           total_pauses_last_day, total_pauses_simulation,
-           days_completed > 0 ? (double)total_pauses_simulation / days_completed : 0.0);
-    printf("| Media Pause per Operatore      | %-18.2f | %-18.2f | %-18.2f |\n", 
-           total_operators_active_last_day > 0 ? (double)total_pauses_last_day / total_operators_active_last_day : 0.0,
-           total_operators_active_simulation > 0 ? (double)total_pauses_simulation / total_operators_active_simulation : 0.0,
-           days_completed > 0 && total_operators_active_simulation > 0 ? (double)total_pauses_simulation / days_completed / (total_operators_active_simulation / days_completed) : 0.0);
-    printf("+--------------------------------+--------------------+--------------------+--------------------+\n");
-    
-    // TABELLA 3: STATISTICHE TEMPI DI ATTESA
-    printf("\n+----------------------+----------+----------+----------+----------+----------+----------+\n");
-    printf("| STATISTICHE TEMPI DI ATTESA (TOTALI SIMULAZIONE)                                      |\n");
-    printf("+----------------------+----------+----------+----------+----------+----------+----------+\n");
-    printf("|      Servizio        | Tempo    | Tempo    | Tempo    | Tempo    | Tempo    | Tempo    |\n");
-    printf("|                      | Min      | Min      | Max      | Max      | Medio    | Medio    |\n");
-    printf("|                      | (ms)     | (minuti) | (ms)     | (minuti) | (ms)     | (minuti) |\n");
-    printf("+----------------------+----------+----------+----------+----------+----------+----------+\n");
-    
-    long overall_min_wait = LONG_MAX;
-    long overall_max_wait = 0;
-    long total_wait_time_all = 0;
-    int total_wait_count_all = 0;
-    
-    for (int i = 0; i < SERVICE_COUNT; i++) {
-        if (shm->wait_count[i] > 0) {
-            double min_ms = shm->min_wait_time[i] / 1000000.0;
-            double max_ms = shm->max_wait_time[i] / 1000000.0;
-            double avg_ms = (shm->total_wait_time[i] / 1000000.0) / shm->wait_count[i];
-            
-            // Converti in minuti simulati
-            double min_min = nanoseconds_to_simulated_minutes(shm->min_wait_time[i]);
-            double max_min = nanoseconds_to_simulated_minutes(shm->max_wait_time[i]);
-            double avg_min = nanoseconds_to_simulated_minutes(shm->total_wait_time[i] / shm->wait_count[i]);
-            
-            printf("| %-20s | %8.1f | %8.3f | %8.1f | %8.3f | %8.1f | %8.3f |\n",
-                   SERVICE_NAMES[i],
-                   min_ms, min_min,
-                   max_ms, max_min,
-                   avg_ms, avg_min);
-            
-            total_wait_time_all += shm->total_wait_time[i];
-            total_wait_count_all += shm->wait_count[i];
-            
-            if (shm->min_wait_time[i] < overall_min_wait) {
-                overall_min_wait = shm->min_wait_time[i];
-            }
-            if (shm->max_wait_time[i] > overall_max_wait) {
-                overall_max_wait = shm->max_wait_time[i];
-            }
-        } else {
-            printf("| %-20s | %8s | %8s | %8s | %8s | %8s | %8s |\n",
-                   SERVICE_NAMES[i], "N/A", "N/A", "N/A", "N/A", "N/A", "N/A");
-        }
-    }
-    
-    printf("+----------------------+----------+----------+----------+----------+----------+----------+\n");
-    
-    // Calculate simulation-wide average for the "Media" row
-    long simulation_total_wait_time = 0;
-    int simulation_total_wait_count = 0;
-    
-    for (int day = 0; day < shm->simulation_day; day++) {
-        if (shm->wait_count_per_day[day] > 0) {
-            simulation_total_wait_time += shm->total_wait_time_per_day[day];
-            simulation_total_wait_count += shm->wait_count_per_day[day];
-        }
-    }
-    
-    if (simulation_total_wait_count > 0) {
-        // Media calcolata su TUTTI gli utenti serviti di tutta la simulazione
-        double simulation_avg_ms = (simulation_total_wait_time / 1000000.0) / simulation_total_wait_count;
-        double simulation_avg_min = nanoseconds_to_simulated_minutes(simulation_total_wait_time / simulation_total_wait_count);
-        
-        printf("| Media                | %8s | %8s | %8s | %8s | %8.1f | %8.3f |\n",
-               "-", "-", "-", "-", simulation_avg_ms, simulation_avg_min);
-    } else {
-        printf("| Media                | %8s | %8s | %8s | %8s | %8s | %8s |\n",
-               "N/A", "N/A", "N/A", "N/A", "N/A", "N/A");
-    }
-    printf("+----------------------+----------+----------+----------+----------+----------+----------+\n");
-    
-    printf("\n");
-    printf("================================================================================\n");
-}
-
-// Funzione per inizializzare le variabili statistiche
-void initialize_statistics(SharedMemory *shm) {
-    // Inizializza le variabili per la simulazione (attesa)
-    for (int i = 0; i < SERVICE_COUNT; i++) {
-        shm->min_wait_time[i] = LONG_MAX;
-        shm->max_wait_time[i] = 0;
-        shm->total_wait_time[i] = 0;
-        shm->wait_count[i] = 0;
-        
-        // Inizializza anche le statistiche tempi (servizio)
-        shm->min_service_time[i] = LONG_MAX;
-        shm->max_service_time[i] = 0;
-        shm->total_service_time[i] = 0;
-        shm->service_count[i] = 0;
-        
-        // Inizializza gli array delle statistiche giornaliere
-        for (int day = 0; day < SIM_DURATION; day++) {
-            shm->users_served_per_service_per_day[i][day] = 0;
-            shm->services_not_provided_per_service_per_day[i][day] = 0;
-            shm->total_wait_time_per_service_per_day[i][day] = 0;
-            shm->wait_count_per_service_per_day[i][day] = 0;
-            shm->total_service_time_per_service_per_day[i][day] = 0;
-            shm->service_count_per_service_per_day[i][day] = 0;
-        }
-    }
-    
-    // Inizializza le statistiche aggregate per la simulazione
-    shm->total_users_served_simulation = 0;
-    shm->total_services_provided_simulation = 0;
-    shm->total_services_not_provided_simulation = 0;
-    shm->total_pauses_simulation = 0;
-    shm->total_users_not_arrived = 0;
-    
-    // Inizializza le somme totali degli operatori attivi per servizio
-    for (int i = 0; i < SERVICE_COUNT; i++) {
-        shm->operators_active_per_service_total[i] = 0;
-        shm->total_users_not_arrived_per_service[i] = 0;
-    }
-    
-    // Inizializza gli array delle statistiche giornaliere aggregate
-    for (int day = 0; day < SIM_DURATION; day++) {
-        shm->users_served_per_day[day] = 0;
-        shm->services_not_provided_per_day[day] = 0;
-        shm->total_wait_time_per_day[day] = 0;
-        shm->wait_count_per_day[day] = 0;
-        shm->total_service_time_per_day[day] = 0;
-        shm->service_count_per_day[day] = 0;
-        shm->pauses_per_day[day] = 0;
-        shm->operators_active_per_day[day] = 0;
-        
-        // Inizializza le medie cumulative
-        shm->cumulative_avg_users_served[day] = 0.0;
-        shm->cumulative_avg_services_provided[day] = 0.0;
-        shm->cumulative_avg_services_not_provided[day] = 0.0;
+    int served = 0;
+    for (int s = 0; s < SERVICE_COUNT; s++) {
+        served += operator_stats_served(shm, s);
     }
+    printf("Operatori giornata %d: %ld cambi di contesto, %d clienti serviti, %.1f per cliente\n",
+           day, switches, served, served > 0 ? (double)switches / served : 0.0);
 }
 
-// Funzione per inizializzare i semafori
-void initialize_semaphores(int semid, int shmid, SharedMemory *shm) {
-    // Inizializza i valori iniziali dei semafori
-    unsigned short init_values[NUM_SEMS];
-    init_values[SEM_MUTEX] = 1;         // Mutex per accesso alla memoria condivisa
-    init_values[SEM_QUEUE] = 1;         // Mutex per accesso alla coda
-    init_values[SEM_TICKET_REQ] = 0;    // Imposto a 0, ticket richiesti
-    init_values[SEM_TICKET_READY] = 0;  // Imposto a 0, ticket pronti
-    init_values[SEM_COUNTERS] = 1;      // Mutex per accesso agli sportelli
-    init_values[SEM_SYNC] = 0;          // Sincronizzazione inizio giornata
-    init_values[SEM_DAY_START] = 0;     // Giorno inizio segnalazione
-    init_values[SEM_TICKET_WAIT] = 0;   // Mutex per attesa ticket
-    
-    // Inizializza i semafori di lock per i servizi (tutti sbloccati all'inizio)
-    init_values[SEM_SERVICE_LOCK_PACKAGES] = 1;   // Pacchi sbloccato
-    init_values[SEM_SERVICE_LOCK_LETTERS] = 1;    // Lettere sbloccato
-    init_values[SEM_SERVICE_LOCK_BANCOPOST] = 1;  // Bancoposta sbloccato
-    init_values[SEM_SERVICE_LOCK_BILLS] = 1;      // Bollette sbloccato
-    init_values[SEM_SERVICE_LOCK_FINANCIAL] = 1;  // Finanza sbloccato
-    init_values[SEM_SERVICE_LOCK_WATCHES] = 1;    // Orologi sbloccato
-
-    // Inizializza la struttura per semctl
-    union semun
-    {
-        int val;
-        struct semid_ds *buf;
-        unsigned short *array;
-        struct seminfo *__buf;
-    } arg;
-    arg.array = init_values;
-
-    if (semctl(semid, 0, SETALL, arg) == -1)
-    {
-        perror("semctl SETALL failed");
-        // Pulizia in caso di errore
-        semctl(semid, 0, IPC_RMID);
-        shmdt(shm);
-        shmctl(shmid, IPC_RMID, NULL);
-        exit(EXIT_FAILURE);
-    }
+// Risvegli dei processi utente nella giornata, per utente simulato: con
+// l'host degli utenti sono quelli dell'unico processo divisi per NOF_USERS
+void print_user_wakeups(SharedMemory *shm, int day) {
+    long wakeups = atomic_load_explicit(&shm->daily_user_wakeups, memory_order_relaxed);
+    printf("Utenti giornata %d: %ld risvegli, %.2f per utente\n",
+           day, wakeups, NOF_USERS > 0 ? (double)wakeups / NOF_USERS : 0.0);
 }
 
 // Funzione per resettare lo stato giornaliero
-void reset_daily_state(SharedMemory *shm, int semid) {
-    // Resetta i contatori giornalieri
-    memset(shm->daily_tickets_served, 0, sizeof(int) * SERVICE_COUNT);
-    memset(shm->daily_users_home, 0, sizeof(int) * SERVICE_COUNT);
-    memset(shm->daily_users_timeout, 0, sizeof(int) * SERVICE_COUNT);
-    memset(shm->daily_users_no_ticket, 0, sizeof(int) * SERVICE_COUNT);
-    memset(shm->daily_users_not_arrived, 0, sizeof(int) * SERVICE_COUNT);
-    shm->total_tickets_served = 0;
-    shm->total_users_home = 0;
-    shm->total_users_timeout = 0;
-    shm->total_users_no_ticket = 0;
-    // NON resettiamo shm->total_users_not_arrived e shm->total_users_not_arrived_per_service perché sono cumulativi
-    
-    // Resetta le statistiche sui tempi di attesa
-    for (int i = 0; i < SERVICE_COUNT; i++) {
-        shm->min_wait_time[i] = LONG_MAX; // Valore massimo possibile
-        shm->max_wait_time[i] = 0;
-        shm->total_wait_time[i] = 0;
-        shm->wait_count[i] = 0;
-        
-        // Resetta anche le statistiche giornaliere sui tempi di attesa
-        shm->daily_total_wait_time[i] = 0;
-        shm->daily_wait_count[i] = 0;
-        
-        // Resetta anche le statistiche sui tempi di servizio
-        shm->min_service_time[i] = LONG_MAX;
-        shm->max_service_time[i] = 0;
-        shm->total_service_time[i] = 0;
-        shm->service_count[i] = 0;
-        
-        // Azzera anche i contatori giornalieri
-        shm->daily_users_timeout[i] = 0;
-        shm->daily_users_not_arrived[i] = 0;
-    }
-    shm->total_users_timeout = 0;
-    // NON resettiamo shm->total_users_not_arrived perché è cumulativo
-    
-    // Resetta anche le statistiche aggregate sui tempi di attesa
-    shm->daily_total_wait_time_all = 0;
-    shm->daily_wait_count_all = 0;
-    
-    // Reset anche del next_request_index per il giorno successivo
-    shm->next_request_index = 0;
-
-    // Reset the day start semaphore for the next day
-    struct sembuf reset_day_start;
-    reset_day_start.sem_num = SEM_DAY_START;
-    reset_day_start.sem_op = -semctl(semid, SEM_DAY_START, GETVAL);  // Reset to 0
-    reset_day_start.sem_flg = 0;
-    if (semop(semid, &reset_day_start, 1) < 0)
-    {
-        perror("Failed to reset day start semaphore");
-    }
-    
-    // Reset the ticket ready semaphore for the next day
-    struct sembuf reset_ticket_ready;
-    reset_ticket_ready.sem_num = SEM_TICKET_READY;
-    reset_ticket_ready.sem_op = -semctl(semid, SEM_TICKET_READY, GETVAL);  // Reset to 0
-    reset_ticket_ready.sem_flg = 0;
-    if (semop(semid, &reset_ticket_ready, 1) < 0)
-    {
-        perror("Failed to reset ticket ready semaphore");
-    }
+void reset_daily_state(SharedMemory *shm) {
+    // Resetta i contatori e le statistiche giornaliere
+    reset_daily_statistics(shm);
 }
 
 int main(int argc, char *argv[])
@@ -1024,13 +386,15 @@ int main(int argc, char *argv[])
     // Determina quale configurazione utilizzare
     const char* config_file = "timeout.conf"; // Default
     
-    if (argc > 1) {
-        if (strcmp(argv[1], "explode") == 0) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "explode") == 0) {
             config_file = "explode.conf";
-        } else if (strcmp(argv[1], "timeout") == 0) {
+        } else if (strcmp(argv[i], "timeout") == 0) {
             config_file = "timeout.conf";
+        } else if (strcmp(argv[i], "--virtual-time") == 0) {
+            virtual_time = 1;
         } else {
-            printf("Uso: %s [explode|timeout]\n", argv[0]);
+            printf("Uso: %s [explode|timeout] [--virtual-time]\n", argv[0]);
             printf("Default: timeout\n");
         }
     }
@@ -1053,49 +417,84 @@ int main(int argc, char *argv[])
     signal(SIGTERM, cleanup_handler);  // Terminazione forzata
     signal(SIGALRM, alarm_handler);    // Allarme per fine giornata simulata
 
-    // Inizializza la memoria condivisa con una chiave fissa
-    shmid = shmget(SHM_KEY, SHM_SIZE, IPC_CREAT | 0666);
-    if (shmid < 0)
-    {
-        perror("shmget");
-        exit(EXIT_FAILURE);
-    }
+    struct timespec run_start;
+    clock_gettime(CLOCK_MONOTONIC, &run_start);
 
-    // Attacca la memoria condivisa
-    shared_memory = (SharedMemory *)shmat(shmid, NULL, 0);
-    if (shared_memory == (void *)-1)
-    {
-        perror("shmat");
-        shmctl(shmid, IPC_RMID, NULL);
-        exit(EXIT_FAILURE);
-    }
+    if (virtual_time) {
+        // Tempo virtuale: tutto il modello gira nel direttore su memoria privata
+        shared_memory = shm_alloc_private();
+        if (shared_memory == NULL) {
+            perror("calloc");
+            exit(EXIT_FAILURE);
+        }
+        initialize_statistics(shared_memory);
+        srand(time(NULL));
+        vt_init(shared_memory);
+        printf("Modalità tempo virtuale: nessun processo figlio, orologio a eventi discreti.\n");
+    } else {
+        // Dimensione del segmento calcolata dalla configurazione
+        SharedMemory layout;
+        size_t shm_size = shm_compute_layout(&layout);
+
+        // Crea e attacca la memoria condivisa (SysV o POSIX, vedi SHM_BACKEND)
+        shared_memory = shm_segment_create(shm_size);
+        if (shared_memory == NULL)
+        {
+            exit(EXIT_FAILURE);
+        }
+        shm_segment_describe();
     
-    // Inizializza la memoria condivisa
-    memset(shared_memory, 0, sizeof(SharedMemory)); // Azzera tutta la memoria condivisa
+        // Inizializza la memoria condivisa
+        memset(shared_memory, 0, shm_size); // Azzera tutta la memoria condivisa
+        shm_compute_layout(shared_memory);  // Intestazione con capacità e offset delle regioni
+        service_queues_init(shared_memory); // Ring delle code dei servizi vuoti
+        request_pool_init(shared_memory);   // Tutti gli slot delle richieste liberi
+        flight_recorder_init(&shared_memory->flight_next, SHM_FLIGHT_EVENTS(shared_memory), shared_memory->flight_capacity);
+        if (shm_mutex_init(&shared_memory->counters_lock) != 0 ||
+            shm_mutex_init(&shared_memory->stats_lock) != 0)
+        {
+            fprintf(stderr, "Direttore: inizializzazione dei lock condivisi fallita\n");
+            shm_segment_detach(shared_memory);
+            shm_segment_remove();
+            exit(EXIT_FAILURE);
+        }
     
-    // Inizializza le variabili statistiche
-    initialize_statistics(shared_memory);
+        day_barrier_init(shared_memory);    // Giornata chiusa: i figli aspettano la prima apertura
 
-    // Inizializza i semafori
-    semid = semget(SEM_KEY, NUM_SEMS, IPC_CREAT | 0666);
-    if (semid < 0)
-    {
-        perror("semget failed");
-        shmdt(shared_memory);
-        shmctl(shmid, IPC_RMID, NULL);
-        exit(EXIT_FAILURE);
-    }
+        // Inizializza le variabili statistiche
+        initialize_statistics(shared_memory);
 
-    // Inizializza i semafori
-    initialize_semaphores(semid, shmid, shared_memory);
+        // Crea i processi necessari. Dopo ogni gruppo il direttore aspetta
+        // che tutti si siano collegati e inizializzati (day_barrier.h); il
+        // traguardo va fissato prima della creazione
+        unsigned int expected = shared_memory->ticket_worker_count;
+        shared_memory->ready_target = expected;
+        create_ticket_processes(shared_memory);
+        day_barrier_wait_ready(shared_memory, expected);
 
-    // Crea i processi necessari
-    create_ticket_process(shared_memory);
-    sleep(1);
-    create_operators(shared_memory);
-    sleep(1);
-    create_users(shared_memory);
-    sleep(1);
+        expected += NOF_WORKERS;
+        shared_memory->ready_target = expected;
+        create_operators(shared_memory);
+        day_barrier_wait_ready(shared_memory, expected);
+
+        expected += USER_HOST ? 1 : NOF_USERS;
+        shared_memory->ready_target = expected;
+        if (USER_HOST) {
+            create_user_host(shared_memory);
+        } else {
+            create_users(shared_memory);
+        }
+        day_barrier_wait_ready(shared_memory, expected);
+
+        // Tutti i processi chiudono ogni giornata
+        shared_memory->done_target = expected;
+    }
+
+    // Tempo di avvio: creazione dei processi e conferme di inizializzazione
+    long startup_ns = day_barrier_now_ns() - (run_start.tv_sec * 1000000000L + run_start.tv_nsec);
+    long rollover_total_ns = 0;    // Dalla chiusura di una giornata all'apertura della successiva
+    long rollover_max_ns = 0;
+    long day_closed_ns = 0;
 
     // -----------------------------------------------------------------------------------------------------------------------------
     // LOOP PRINCIPALE DEL DIRETTORE
@@ -1115,60 +514,99 @@ int main(int argc, char *argv[])
 
         initialize_counters_for_day(shared_memory);
 
-        // Notifica a tutti i processi l'inizio della giornata
-        notify_all_processes(shared_memory, SIGUSR1);
+        if (virtual_time) {
+            // L'intera giornata viene simulata istantaneamente
+            shared_memory->day_in_progress = 1;
+            if (vt_run_day(shared_memory) < 0) {
+                handle_explode_condition(count_waiting_users(shared_memory));
+            }
+            shared_memory->day_in_progress = 0;
+            printf("Giorno %d simulato in tempo virtuale (%ld eventi).\n", day + 1, virtual_engine.events_processed);
+        } else {
+            // Apre la giornata: day_in_progress, nuova generazione di day_seq
+            // e un solo FUTEX_WAKE per tutti i processi (day_barrier.h)
+            day_barrier_open(shared_memory);
+            flight_record(shared_memory, FLIGHT_DAY_OPEN, -1, day + 1, 0, 0);
+            if (day > 0) {
+                long rollover_ns = shared_memory->day_opened_ns - day_closed_ns;
+                rollover_total_ns += rollover_ns;
+                if (rollover_ns > rollover_max_ns) {
+                    rollover_max_ns = rollover_ns;
+                }
+            }
 
-        // Imposta il flag day_in_progress 
-        shared_memory->day_in_progress = 1;
+            // -----------------------------------------------------------------
+            // Inizia la simulazione della GIORNATA lavorativa
+            // -----------------------------------------------------------------
+            printf("Simulazione giornata lavorativa %d (durata: %d secondi)...\n", day + 1, DAY_SIMULATION_TIME);
+        
+            // Il direttore dorme sulla parola dell'esplosione fino al prossimo
+            // istante in cui ha qualcosa da fare (stampa dei secondi,
+            // ribilanciamento, fine giornata): un processo ticket lo sveglia
+            // appena gli utenti in coda superano EXPLODE_THRESHOLD
+            const long second_ns = 1000000000L;
+            const long day_end_ns = shared_memory->day_opened_ns + DAY_SIMULATION_TIME * second_ns;
+            long next_print_ns = shared_memory->day_opened_ns + second_ns;
+            int elapsed_seconds = 0;
+
+            // Ribilanciamento degli sportelli ogni REBALANCE_INTERVAL minuti simulati
+            const long rebalance_interval_ns = (long)REBALANCE_INTERVAL * N_NANO_SECS;
+            long next_rebalance_ns = rebalance_interval_ns > 0 ? shared_memory->day_opened_ns + rebalance_interval_ns : LONG_MAX;
+            int last_served[SERVICE_COUNT] = {0};
+
+            for (;;) {
+                long now_ns = day_barrier_now_ns();
+
+                // Stampa lo stato ogni secondo
+                if (now_ns >= next_print_ns && next_print_ns <= day_end_ns) {
+                    elapsed_seconds++;
+                    printf("Giorno %d: %d secondi passati\n", day + 1, elapsed_seconds);
+                    next_print_ns += second_ns;
+                }
 
-        // Semaforo contatore per iniziare la giornata
-        struct sembuf barrier_release;
-        barrier_release.sem_num = SEM_DAY_START;  
-        barrier_release.sem_op = NOF_USERS + NOF_WORKERS + 1;
-        barrier_release.sem_flg = 0;
-        
-        if (semop(semid, &barrier_release, 1) < 0) {
-            perror("Failed to release day start semaphore");
-        }
+                if (now_ns >= next_rebalance_ns) {
+                    rebalance_counters(shared_memory, last_served);
+                    next_rebalance_ns += rebalance_interval_ns;
+                }
 
-        // -----------------------------------------------------------------
-        // Inizia la simulazione della GIORNATA lavorativa
-        // -----------------------------------------------------------------
-        printf("Simulazione giornata lavorativa %d (durata: %d secondi)...\n", day + 1, DAY_SIMULATION_TIME);
-        
-        int elapsed_time_ms = 0;
-        const int check_interval_ms = 100; // Controllo ogni 100ms
-        const int total_time_ms = DAY_SIMULATION_TIME * 1000; // Converti secondi in millisecondi
-        
-        while (elapsed_time_ms < total_time_ms) {
-            // Usa nanosleep per attendere 100ms
-            struct timespec sleep_time;
-            sleep_time.tv_sec = 0;
-            sleep_time.tv_nsec = check_interval_ms * 1000000L; // 100ms in nanosecondi
-            
-            nanosleep(&sleep_time, NULL);
-            
-            elapsed_time_ms += check_interval_ms;
-            
-            // Stampa lo stato ogni secondo (ogni 10 cicli di 100ms)
-            if (elapsed_time_ms % 1000 == 0) {
-                int elapsed_seconds = elapsed_time_ms / 1000;
-                printf("Giorno %d: %d secondi passati\n", day + 1, elapsed_seconds);
+                if (now_ns >= day_end_ns) {
+                    break;
+                }
+
+                long wake_ns = day_end_ns;
+                if (next_print_ns < wake_ns) {
+                    wake_ns = next_print_ns;
+                }
+                if (next_rebalance_ns < wake_ns) {
+                    wake_ns = next_rebalance_ns;
+                }
+                struct timespec deadline = {.tv_sec = wake_ns / second_ns, .tv_nsec = wake_ns % second_ns};
+                futex_wait_until(&shared_memory->explode_waiting, 0, &deadline);
+
+                handle_explode_condition((int)atomic_load_explicit(&shared_memory->explode_waiting, memory_order_acquire));
             }
 
-            // Controlla la condizione di esplosione ogni 100ms
-            handle_explode_condition(shared_memory);
-        }
-        
-        int final_seconds = elapsed_time_ms / 1000;
-        printf("Giorno %d Completato dopo %d secondi.\n", day + 1, final_seconds);
+            printf("Giorno %d Completato dopo %d secondi.\n", day + 1, elapsed_seconds);
 
-        // Notifica tutti i processi della fine della giornata
-        printf("Notifying all users about day %d end...\n", day + 1);
-        shared_memory->day_in_progress = 0;  
+            // Chiude la giornata per tutti i processi con lo stesso FUTEX_WAKE
+            printf("Notifying all users about day %d end...\n", day + 1);
+            day_barrier_close(shared_memory);
+            flight_record(shared_memory, FLIGHT_DAY_CLOSE, -1, day + 1, 0, 0);
+            day_closed_ns = day_barrier_now_ns();
+            day_barrier_print_latency(shared_memory, day + 1);
 
-        // Breve attesa per stampare le statistiche
-        sleep(2);
+            // Le statistiche si contano quando tutti i processi hanno chiuso
+            // la giornata: nessuno scrive più statistiche, sportelli o code
+            unsigned int done = day_barrier_wait_done(shared_memory);
+            printf("Chiusura giornata %d: %u processi su %u confermati in %.1f ms\n", day + 1,
+                   done, shared_memory->done_target, (day_barrier_now_ns() - day_closed_ns) / 1000000.0);
+            print_operator_context_switches(shared_memory, day + 1);
+            print_user_wakeups(shared_memory, day + 1);
+        }
+
+        // Unisce i registri statistici degli operatori: i ticket serviti
+        // servono già per contare quelli rimasti
+        merge_operator_stats(shared_memory);
 
         // Conta i ticket rimasti in coda alla fine della giornata
         count_remaining_tickets(shared_memory);
@@ -1189,15 +627,24 @@ int main(int argc, char *argv[])
         print_service_timing_statistics_table(shared_memory, day + 1);
 
         // Resetta lo stato per il giorno successivo
-        reset_daily_state(shared_memory, semid);
+        reset_daily_state(shared_memory);
 
-        // Notifica a tutti i processi la fine della giornata
-        notify_all_processes(shared_memory, SIGUSR2);
-        
         printf("Giorno %d, simulazione finita.\n", day + 1);
-        
-        // Attesa di qualche secondo prima del giorno successivo
-        sleep(3);
+    }
+
+    if (virtual_time) {
+        struct timespec run_end;
+        clock_gettime(CLOCK_MONOTONIC, &run_end);
+        double elapsed_ms = (run_end.tv_sec - run_start.tv_sec) * 1000.0 +
+                            (run_end.tv_nsec - run_start.tv_nsec) / 1000000.0;
+        printf("Simulazione in tempo virtuale di %d giorni completata in %.3f ms.\n", SIM_DURATION, elapsed_ms);
+    }
+
+    if (!virtual_time) {
+        printf("Tempi di sincronizzazione: avvio dei processi %.1f ms, cambio di giornata medio %.1f ms (massimo %.1f ms)\n",
+               startup_ns / 1000000.0,
+               SIM_DURATION > 1 ? rollover_total_ns / 1000000.0 / (SIM_DURATION - 1) : 0.0,
+               rollover_max_ns / 1000000.0);
     }
 
     printf("Simulazione finita; pulizia...\n");
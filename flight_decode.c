@@ -0,0 +1,81 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+
+// Decodifica il file del registratore di volo salvato dal direttore
+// (flight_recorder.h). Uso: ./flight_decode [file] [ultimi eventi]
+// Stampa un evento per riga, dal più vecchio, con il tempo in millisecondi
+// rispetto al primo evento salvato e rispetto al salvataggio.
+
+// Nome del servizio dell'evento, "-" se non ne riguarda uno
+const char *service_name(int service)
+{
+    return service >= 0 && service < SERVICE_COUNT ? SERVICE_NAMES[service] : "-";
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = argc > 1 ? argv[1] : FLIGHT_RECORDER_FILE;
+    long tail = argc > 2 ? atol(argv[2]) : 0;
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    FlightDumpHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, FLIGHT_DUMP_MAGIC, sizeof(header.magic)) != 0) {
+        fprintf(stderr, "%s: non è un file del registratore di volo\n", path);
+        fclose(file);
+        return 1;
+    }
+    if (header.version != FLIGHT_DUMP_VERSION || header.event_size != sizeof(FlightEvent)) {
+        fprintf(stderr, "%s: versione %u con eventi da %u byte non supportata\n", path, header.version, header.event_size);
+        fclose(file);
+        return 1;
+    }
+
+    int reason = header.reason >= 0 && header.reason <= FLIGHT_DUMP_CHILD_CRASH ? header.reason : FLIGHT_DUMP_NONE;
+    printf("Registratore di volo: %s\n", path);
+    printf("Motivo del salvataggio: %s", FLIGHT_DUMP_REASONS[reason]);
+    if (header.signal != 0) {
+        printf(" (segnale %d, %s)", header.signal, strsignal(header.signal));
+    }
+    printf("\n");
+    printf("Eventi: %lu salvati, %lu registrati dall'avvio, ring da %lu\n",
+           header.count, header.recorded, header.capacity);
+
+    // Con un limite si saltano gli eventi più vecchi
+    unsigned long skip = tail > 0 && (unsigned long)tail < header.count ? header.count - tail : 0;
+
+    printf("%12s %12s %8s  %-20s %-12s %8s %8s %10s\n",
+           "ms", "ms al dump", "PID", "Evento", "Servizio", "Attore", "Arg", "Arg2");
+
+    FlightEvent event;
+    long first_ns = -1;
+    unsigned long read_count = 0;
+    while (read_count < header.count && fread(&event, sizeof(event), 1, file) == 1) {
+        if (first_ns < 0) {
+            first_ns = event.timestamp_ns;
+        }
+        if (read_count++ < skip) {
+            continue;
+        }
+        const char *name = event.type < FLIGHT_EVENT_TYPES ? FLIGHT_EVENT_NAMES[event.type] : "?";
+        printf("%12.3f %12.3f %8d  %-20s %-12s %8d %8d %10d\n",
+               (event.timestamp_ns - first_ns) / 1000000.0,
+               (event.timestamp_ns - header.dump_time_ns) / 1000000.0,
+               event.pid, name, service_name(event.service), event.actor, event.arg, event.arg2);
+    }
+    fclose(file);
+
+    if (read_count < header.count) {
+        fprintf(stderr, "%s: file troncato, letti %lu eventi su %lu\n", path, read_count, header.count);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,241 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+
+// Registratore di volo: ring di dimensione fissa in memoria condivisa con
+// gli ultimi eventi della simulazione (arrivi, ticket emessi, inizio e fine
+// dei servizi, pause, sportelli presi, lasciati e spostati), scritto da tutti
+// i processi. Registrare un evento costa un fetch_add sulla posizione, una
+// lettura di CLOCK_MONOTONIC (vDSO, senza chiamata di sistema) e la scrittura
+// di 32 byte: nessun lock, nessuna attesa. Quando il ring è pieno gli eventi
+// nuovi sovrascrivono i più vecchi.
+// Ogni evento ha un numero di sequenza (posizione + 1) scritto per ultimo
+// con rilascio e azzerato prima di riscrivere lo slot: chi legge scarta gli
+// slot a metà scrittura o già sovrascritti da un giro successivo. Un
+// processo sospeso tra la presa della posizione e la scrittura per un intero
+// giro del ring può lasciare nello slot il proprio evento, più vecchio di
+// quello atteso: anche quello slot viene saltato.
+// Il direttore salva il ring in FLIGHT_RECORDER_FILE quando la simulazione
+// esplode o termina in modo anomalo; flight_decode lo stampa.
+
+_Static_assert(ATOMIC_LONG_LOCK_FREE == 2, "il registratore richiede atomici long lock-free");
+
+#define FLIGHT_RECORDER_FILE "flight_recorder.bin"
+#define FLIGHT_DUMP_MAGIC "SOFREC1"
+#define FLIGHT_DUMP_VERSION 1
+
+typedef enum {
+    FLIGHT_NONE = 0,
+    FLIGHT_DAY_OPEN,            // actor = giornata
+    FLIGHT_DAY_CLOSE,           // actor = giornata
+    FLIGHT_ARRIVAL,             // actor = utente, arg = 1 se il servizio è disponibile, 0 se torna a casa,
+                                // arg2 = minuto di arrivo (-1 con l'host degli utenti)
+    FLIGHT_TICKET_ISSUED,       // actor = utente, arg = numero del ticket, arg2 = ticket in coda
+    FLIGHT_SERVICE_START,       // actor = operatore, arg = utente, arg2 = sportello
+    FLIGHT_SERVICE_END,         // actor = operatore, arg = utente, arg2 = durata in microsecondi
+    FLIGHT_SERVICE_INTERRUPTED, // actor = operatore, arg = utente, arg2 = sportello
+    FLIGHT_BREAK,               // actor = operatore, arg = sportello lasciato
+    FLIGHT_COUNTER_STAFF,       // actor = operatore, arg = sportello
+    FLIGHT_COUNTER_RELEASE,     // actor = operatore, arg = sportello
+    FLIGHT_COUNTER_MOVE,        // actor = sportello, arg = servizio precedente, arg2 = 1 se occupato (passa dopo il cliente)
+    FLIGHT_EXPLODE,             // arg = utenti in coda, arg2 = soglia
+    FLIGHT_EVENT_TYPES
+} FlightEventType;
+
+// Motivo del salvataggio, nell'intestazione del file
+typedef enum {
+    FLIGHT_DUMP_NONE = 0,
+    FLIGHT_DUMP_EXPLODE,        // Soglia EXPLODE_THRESHOLD superata
+    FLIGHT_DUMP_SIGNAL,         // Direttore terminato da un segnale (signal = numero)
+    FLIGHT_DUMP_CHILD_CRASH     // Processo figlio terminato da un segnale (signal = numero)
+} FlightDumpReason;
+
+const char *FLIGHT_EVENT_NAMES[] = {
+    "-",
+    "APERTURA",
+    "CHIUSURA",
+    "ARRIVO",
+    "TICKET",
+    "INIZIO_SERVIZIO",
+    "FINE_SERVIZIO",
+    "SERVIZIO_INTERROTTO",
+    "PAUSA",
+    "SPORTELLO_PRESO",
+    "SPORTELLO_LASCIATO",
+    "SPORTELLO_SPOSTATO",
+    "EXPLODE"
+};
+
+const char *FLIGHT_DUMP_REASONS[] = {
+    "nessuno",
+    "esplosione",
+    "segnale al direttore",
+    "processo figlio terminato da un segnale"
+};
+
+typedef struct {
+    atomic_uint seq;            // Posizione + 1 (32 bit bassi), 0 durante la scrittura
+    unsigned short type;        // FlightEventType
+    short service;              // Servizio, -1 se l'evento non ne riguarda uno
+    long timestamp_ns;          // CLOCK_MONOTONIC
+    int pid;                    // Processo che ha registrato l'evento
+    int actor;                  // Utente, operatore, sportello o giornata (vedi il tipo)
+    int arg;
+    int arg2;
+} FlightEvent;
+
+_Static_assert(sizeof(FlightEvent) == 32, "un evento deve occupare 32 byte");
+
+// Intestazione del file salvato, seguita da count eventi dal più vecchio
+typedef struct {
+    char magic[8];              // FLIGHT_DUMP_MAGIC
+    unsigned int version;       // FLIGHT_DUMP_VERSION
+    unsigned int event_size;    // sizeof(FlightEvent)
+    unsigned long capacity;     // Eventi nel ring
+    unsigned long recorded;     // Eventi registrati dall'avvio (anche quelli sovrascritti)
+    unsigned long count;        // Eventi salvati nel file
+    int reason;                 // FlightDumpReason
+    int signal;                 // Segnale che ha causato il salvataggio, 0 se nessuno
+    long dump_time_ns;          // CLOCK_MONOTONIC al salvataggio
+} FlightDumpHeader;
+
+void flight_recorder_init(atomic_ulong *next, FlightEvent *events, unsigned long capacity);
+void flight_recorder_record(atomic_ulong *next, FlightEvent *events, unsigned long capacity,
+                            int type, int service, int actor, int arg, int arg2);
+int flight_recorder_read(FlightEvent *events, unsigned long capacity, unsigned long pos, FlightEvent *copy);
+long flight_recorder_dump(const char *path, atomic_ulong *next, FlightEvent *events, unsigned long capacity,
+                          int reason, int signum);
+
+// PID del processo, letto una volta sola: getpid() è una chiamata di sistema
+pid_t flight_pid = 0;
+
+// Implementazione delle funzioni
+
+// Svuota il ring. Da chiamare solo quando nessuno lo sta usando (creazione del segmento)
+void flight_recorder_init(atomic_ulong *next, FlightEvent *events, unsigned long capacity)
+{
+    for (unsigned long i = 0; i < capacity; i++) {
+        atomic_store_explicit(&events[i].seq, 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(next, 0, memory_order_release);
+}
+
+// Registra un evento (capacity potenza di due, 0 = registratore spento)
+void flight_recorder_record(atomic_ulong *next, FlightEvent *events, unsigned long capacity,
+                            int type, int service, int actor, int arg, int arg2)
+{
+    if (capacity == 0) {
+        return;
+    }
+    if (flight_pid == 0) {
+        flight_pid = getpid();
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    unsigned long pos = atomic_fetch_add_explicit(next, 1, memory_order_relaxed);
+    FlightEvent *event = &events[pos & (capacity - 1)];
+
+    // Slot non valido finché i campi non sono completi
+    atomic_store_explicit(&event->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    event->type = (unsigned short)type;
+    event->service = (short)service;
+    event->timestamp_ns = now.tv_sec * 1000000000L + now.tv_nsec;
+    event->pid = flight_pid;
+    event->actor = actor;
+    event->arg = arg;
+    event->arg2 = arg2;
+    atomic_store_explicit(&event->seq, (unsigned int)(pos + 1), memory_order_release);
+}
+
+// Copia lo slot della posizione pos se contiene proprio quell'evento, completo
+int flight_recorder_read(FlightEvent *events, unsigned long capacity, unsigned long pos, FlightEvent *copy)
+{
+    FlightEvent *event = &events[pos & (capacity - 1)];
+    unsigned int expected = (unsigned int)(pos + 1);
+
+    if (atomic_load_explicit(&event->seq, memory_order_acquire) != expected) {
+        return 0;
+    }
+    copy->type = event->type;
+    copy->service = event->service;
+    copy->timestamp_ns = event->timestamp_ns;
+    copy->pid = event->pid;
+    copy->actor = event->actor;
+    copy->arg = event->arg;
+    copy->arg2 = event->arg2;
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&event->seq, memory_order_relaxed) != expected) {
+        return 0; // Riscritto durante la copia
+    }
+    atomic_store_explicit(&copy->seq, expected, memory_order_relaxed);
+    return 1;
+}
+
+// Salva nel file path gli eventi ancora nel ring, dal più vecchio, con
+// un'intestazione FlightDumpHeader. Usa solo open/write, quindi si può
+// chiamare anche durante la pulizia dopo un segnale. Ritorna gli eventi
+// salvati o -1 in caso di errore (errno impostato)
+long flight_recorder_dump(const char *path, atomic_ulong *next, FlightEvent *events, unsigned long capacity,
+                          int reason, int signum)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+
+    FlightDumpHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FLIGHT_DUMP_MAGIC, sizeof(header.magic));
+    header.version = FLIGHT_DUMP_VERSION;
+    header.event_size = sizeof(FlightEvent);
+    header.capacity = capacity;
+    header.recorded = atomic_load_explicit(next, memory_order_acquire);
+    header.reason = reason;
+    header.signal = signum;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    header.dump_time_ns = now.tv_sec * 1000000000L + now.tv_nsec;
+
+    // Il conteggio va nell'intestazione: si scrive prima un segnaposto
+    int ok = write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header);
+
+    // Eventi copiati a blocchi; gli slot non validi vengono saltati
+    FlightEvent chunk[256];
+    int filled = 0;
+    unsigned long first = header.recorded > capacity ? header.recorded - capacity : 0;
+    for (unsigned long pos = first; ok && pos < header.recorded; pos++) {
+        if (flight_recorder_read(events, capacity, pos, &chunk[filled])) {
+            filled++;
+            header.count++;
+        }
+        if (filled == (int)(sizeof(chunk) / sizeof(chunk[0])) || (pos + 1 == header.recorded && filled > 0)) {
+            ssize_t size = (ssize_t)(filled * sizeof(FlightEvent));
+            ok = write(fd, chunk, size) == size;
+            filled = 0;
+        }
+    }
+
+    if (ok) {
+        ok = pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+    }
+    int saved_errno = errno;
+    close(fd);
+    if (!ok) {
+        errno = saved_errno;
+        return -1;
+    }
+    return (long)header.count;
+}
+
+#endif // FLIGHT_RECORDER_H
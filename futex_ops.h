@@ -0,0 +1,115 @@
+#ifndef FUTEX_OPS_H
+#define FUTEX_OPS_H
+
+#include <time.h>
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// Chiamate futex su parole in memoria condivisa. I futex non sono privati
+// (niente FUTEX_PRIVATE_FLAG) perché la parola è condivisa tra processi diversi.
+
+long futex_wait(atomic_uint *word, unsigned int expected, const struct timespec *timeout);
+long futex_wake(atomic_uint *word, int count);
+long futex_wait_until(atomic_uint *word, unsigned int expected, const struct timespec *deadline);
+long futex_wait_either(atomic_uint *first, unsigned int first_seen,
+                       atomic_uint *second, unsigned int second_seen,
+                       const struct timespec *timeout);
+long futex_wait_either_until(atomic_uint *first, unsigned int first_seen,
+                             atomic_uint *second, unsigned int second_seen,
+                             const struct timespec *deadline);
+
+// Implementazione delle funzioni
+
+// Dorme finché *word vale expected (timeout relativo, NULL = senza limite).
+// Ritorna subito se il valore è già cambiato; i segnali la interrompono
+long futex_wait(atomic_uint *word, unsigned int expected, const struct timespec *timeout)
+{
+    return syscall(SYS_futex, word, FUTEX_WAIT, expected, timeout, NULL, 0);
+}
+
+long futex_wake(atomic_uint *word, int count)
+{
+    return syscall(SYS_futex, word, FUTEX_WAKE, count, NULL, NULL, 0);
+}
+
+// Come futex_wait() con una scadenza assoluta su CLOCK_MONOTONIC
+// (FUTEX_WAIT_BITSET): chi si riaddormenta dopo un risveglio non deve
+// ricalcolare il tempo rimasto. Ritorna -1 con ETIMEDOUT alla scadenza
+long futex_wait_until(atomic_uint *word, unsigned int expected, const struct timespec *deadline)
+{
+    return syscall(SYS_futex, word, FUTEX_WAIT_BITSET, expected, deadline, NULL, FUTEX_BITSET_MATCH_ANY);
+}
+
+// Dorme finché entrambe le parole valgono il valore letto, cioè fino al
+// primo FUTEX_WAKE su una delle due (futex_waitv, Linux 5.16). Serve a chi
+// dorme sulla propria parola e deve svegliarsi anche al cambio di giornata
+// (day_barrier.h). Ritorna come futex_wait: -1 con EAGAIN se una parola è
+// già cambiata. Timeout relativo, NULL = senza limite
+long futex_wait_either(atomic_uint *first, unsigned int first_seen,
+                       atomic_uint *second, unsigned int second_seen,
+                       const struct timespec *timeout)
+{
+    if (timeout == NULL) {
+        return futex_wait_either_until(first, first_seen, second, second_seen, NULL);
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout->tv_sec;
+    deadline.tv_nsec += timeout->tv_nsec;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return futex_wait_either_until(first, first_seen, second, second_seen, &deadline);
+}
+
+// Come futex_wait_either() con una scadenza assoluta su CLOCK_MONOTONIC, il
+// formato nativo di futex_waitv: chi aspetta un istante preciso (la fine di
+// un servizio) non accumula deriva tra un risveglio e l'altro.
+// Senza futex_waitv dorme sulla prima parola a intervalli brevi
+long futex_wait_either_until(atomic_uint *first, unsigned int first_seen,
+                             atomic_uint *second, unsigned int second_seen,
+                             const struct timespec *deadline)
+{
+#if defined(SYS_futex_waitv) && defined(FUTEX_32)
+    static int waitv_missing = 0;
+
+    if (!waitv_missing) {
+        struct futex_waitv waiters[2] = {
+            {.val = first_seen, .uaddr = (uintptr_t)first, .flags = FUTEX_32},
+            {.val = second_seen, .uaddr = (uintptr_t)second, .flags = FUTEX_32},
+        };
+        long result = syscall(SYS_futex_waitv, waiters, 2, 0, deadline, CLOCK_MONOTONIC);
+        if (result >= 0 || errno != ENOSYS) {
+            return result;
+        }
+        waitv_missing = 1;
+    }
+#endif
+
+    struct timespec slice = {.tv_sec = 0, .tv_nsec = 10000000L}; // 10ms
+    if (atomic_load_explicit(second, memory_order_acquire) != second_seen) {
+        errno = EAGAIN;
+        return -1;
+    }
+    if (deadline != NULL) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long remaining_ns = (deadline->tv_sec - now.tv_sec) * 1000000000L + (deadline->tv_nsec - now.tv_nsec);
+        if (remaining_ns <= 0) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        if (remaining_ns < slice.tv_nsec) {
+            slice.tv_nsec = remaining_ns;
+        }
+    }
+    return futex_wait(first, first_seen, &slice);
+}
+
+#endif // FUTEX_OPS_H
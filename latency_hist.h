@@ -0,0 +1,125 @@
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <stdatomic.h>
+
+// Istogrammi log-lineari dei tempi in nanosecondi (schema di HdrHistogram):
+// ogni potenza di due è divisa in LATENCY_HIST_SUB_COUNT intervalli uguali,
+// quindi l'errore relativo di un percentile è al più 1/16 (6,25%) su tutto
+// l'intervallo, da pochi nanosecondi a decine di minuti. La dimensione è
+// fissa e l'aggiornamento è un solo incremento atomico rilassato: più
+// operatori registrano nello stesso istogramma senza lock.
+// I valori oltre 2^(LATENCY_HIST_MAX_EXPONENT + 1) ns finiscono nell'ultimo intervallo.
+
+_Static_assert(ATOMIC_INT_LOCK_FREE == 2, "gli istogrammi richiedono atomici int lock-free");
+
+#define LATENCY_HIST_SUB_BITS 4
+#define LATENCY_HIST_SUB_COUNT (1 << LATENCY_HIST_SUB_BITS)
+#define LATENCY_HIST_MAX_EXPONENT 40    // 2^41 ns, circa 36 minuti reali
+#define LATENCY_HIST_BUCKETS ((LATENCY_HIST_MAX_EXPONENT - LATENCY_HIST_SUB_BITS + 2) * LATENCY_HIST_SUB_COUNT)
+
+typedef struct {
+    atomic_uint buckets[LATENCY_HIST_BUCKETS];
+} LatencyHistogram;
+
+int latency_hist_bucket(long value_ns);
+long latency_hist_bucket_value(int bucket);
+void latency_hist_record(LatencyHistogram *hist, long value_ns);
+void latency_hist_reset(LatencyHistogram *hist);
+void latency_hist_merge(LatencyHistogram *into, LatencyHistogram *from);
+long latency_hist_count(LatencyHistogram *hist);
+long latency_hist_percentile(LatencyHistogram *hist, double percentile);
+
+// Implementazione delle funzioni
+
+// Intervallo del valore: i primi LATENCY_HIST_SUB_COUNT valori hanno un
+// intervallo ciascuno, poi l'esponente sceglie la potenza di due e i
+// LATENCY_HIST_SUB_BITS bit successivi al più significativo l'intervallo
+int latency_hist_bucket(long value_ns)
+{
+    if (value_ns < LATENCY_HIST_SUB_COUNT) {
+        return value_ns > 0 ? (int)value_ns : 0;
+    }
+
+    int exponent = 63 - __builtin_clzl((unsigned long)value_ns);
+    if (exponent > LATENCY_HIST_MAX_EXPONENT) {
+        return LATENCY_HIST_BUCKETS - 1;
+    }
+    int shift = exponent - LATENCY_HIST_SUB_BITS;
+    return (exponent - LATENCY_HIST_SUB_BITS + 1) * LATENCY_HIST_SUB_COUNT +
+           (int)((value_ns >> shift) & (LATENCY_HIST_SUB_COUNT - 1));
+}
+
+// Valore rappresentativo dell'intervallo (il punto medio)
+long latency_hist_bucket_value(int bucket)
+{
+    if (bucket < LATENCY_HIST_SUB_COUNT) {
+        return bucket;
+    }
+
+    int shift = bucket / LATENCY_HIST_SUB_COUNT - 1;
+    long lower = (long)(LATENCY_HIST_SUB_COUNT + bucket % LATENCY_HIST_SUB_COUNT) << shift;
+    return lower + ((1L << shift) >> 1);
+}
+
+void latency_hist_record(LatencyHistogram *hist, long value_ns)
+{
+    atomic_fetch_add_explicit(&hist->buckets[latency_hist_bucket(value_ns)], 1, memory_order_relaxed);
+}
+
+// Da chiamare solo quando nessuno sta registrando (cambio di giornata)
+void latency_hist_reset(LatencyHistogram *hist)
+{
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        atomic_store_explicit(&hist->buckets[i], 0, memory_order_relaxed);
+    }
+}
+
+// Somma from in into (unione della giornata nei totali della simulazione)
+void latency_hist_merge(LatencyHistogram *into, LatencyHistogram *from)
+{
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        unsigned int count = atomic_load_explicit(&from->buckets[i], memory_order_relaxed);
+        if (count > 0) {
+            atomic_fetch_add_explicit(&into->buckets[i], count, memory_order_relaxed);
+        }
+    }
+}
+
+long latency_hist_count(LatencyHistogram *hist)
+{
+    long total = 0;
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        total += atomic_load_explicit(&hist->buckets[i], memory_order_relaxed);
+    }
+    return total;
+}
+
+// Valore sotto cui cade la percentuale percentile (0-100) dei campioni
+// (rango più vicino per eccesso), -1 se l'istogramma è vuoto
+long latency_hist_percentile(LatencyHistogram *hist, double percentile)
+{
+    long total = latency_hist_count(hist);
+    if (total == 0) {
+        return -1;
+    }
+
+    double exact_rank = percentile / 100.0 * total;
+    long rank = (long)exact_rank;
+    if (rank < exact_rank) {
+        rank++;
+    }
+    if (rank < 1) {
+        rank = 1;
+    }
+    long seen = 0;
+    for (int i = 0; i < LATENCY_HIST_BUCKETS; i++) {
+        seen += atomic_load_explicit(&hist->buckets[i], memory_order_relaxed);
+        if (seen >= rank) {
+            return latency_hist_bucket_value(i);
+        }
+    }
+    return latency_hist_bucket_value(LATENCY_HIST_BUCKETS - 1);
+}
+
+#endif // LATENCY_HIST_H
@@ -0,0 +1,225 @@
+#ifndef NOTIFY_H
+#define NOTIFY_H
+
+#include <errno.h>
+#include <stdatomic.h>
+#include "futex_ops.h"
+#include "config.h"
+#include "shm_layout.h"
+#include "day_barrier.h"
+
+// Risvegli mirati degli operatori. Ogni operatore ha una parola futex in
+// memoria condivisa usata come "eventcount": chi vuole svegliarlo la
+// incrementa e chiama FUTEX_WAKE, l'operatore dorme con FUTEX_WAIT sul valore
+// letto prima di ricontrollare la coda, quindi un risveglio arrivato nel
+// frattempo non va perso. Per ogni servizio c'è una pila lock-free degli
+// operatori inattivi: il processo ticket, per ogni ticket accodato, sveglia
+// un solo operatore invece di mandare SIGUSR1 a tutti quelli del servizio.
+// Un operatore con più competenze (OPERATOR_SKILLS) che resta senza ticket
+// del proprio servizio ruba dalla coda compatibile più lunga, se supera
+// STEAL_THRESHOLD; quando gli operatori del servizio sono tutti occupati il
+// processo ticket sveglia anche gli inattivi che possono rubare.
+
+#define IDLE_NONE 0     // Pila vuota / fine della lista
+
+void idle_operators_init(SharedMemory *shm);
+unsigned int operator_prepare_wait(SharedMemory *shm, int op_id, int service);
+void operator_wait(SharedMemory *shm, int op_id, int service, unsigned int seen, unsigned int day);
+void operator_wakeup(SharedMemory *shm, int op_id);
+int wake_idle_operator(SharedMemory *shm, int service);
+int wake_idle_operators(SharedMemory *shm, int service, int count);
+int steal_candidate_service(SharedMemory *shm, int op_id);
+int wake_idle_stealers(SharedMemory *shm, int service, int count);
+
+// Implementazione delle funzioni
+
+// Svuota le pile degli operatori inattivi (a inizio e fine giornata)
+void idle_operators_init(SharedMemory *shm)
+{
+    for (int service = 0; service < SERVICE_COUNT; service++) {
+        atomic_store_explicit(&shm->idle_operators[service].top, IDLE_NONE, memory_order_relaxed);
+    }
+    for (int i = 0; i < shm->worker_capacity; i++) {
+        atomic_store_explicit(&SHM_OPERATORS(shm)[i].idle_listed, 0, memory_order_relaxed);
+        atomic_store_explicit(&SHM_OPERATORS(shm)[i].idle_next, IDLE_NONE, memory_order_relaxed);
+        atomic_store_explicit(&SHM_OPERATORS(shm)[i].steal_listed, 0, memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_release);
+}
+
+// La cima della pila contiene l'operatore (id + 1, 0 = vuota) nei 32 bit bassi
+// e un contatore di modifiche in quelli alti contro il problema ABA
+void idle_operator_push(SharedMemory *shm, int service, int op_id)
+{
+    Operator *op = &SHM_OPERATORS(shm)[op_id];
+    unsigned long top = atomic_load_explicit(&shm->idle_operators[service].top, memory_order_relaxed);
+    unsigned long node;
+
+    do {
+        atomic_store_explicit(&op->idle_next, (int)(top & 0xFFFFFFFFUL), memory_order_relaxed);
+        node = ((top >> 32) + 1) << 32 | (unsigned long)(op_id + 1);
+    } while (!atomic_compare_exchange_weak_explicit(&shm->idle_operators[service].top, &top, node,
+                                                    memory_order_release, memory_order_relaxed));
+}
+
+// Toglie un operatore dalla pila. Ritorna l'id o -1 se nessuno è inattivo
+int idle_operator_pop(SharedMemory *shm, int service)
+{
+    unsigned long top = atomic_load_explicit(&shm->idle_operators[service].top, memory_order_acquire);
+    unsigned long next_top;
+
+    do {
+        int first = (int)(top & 0xFFFFFFFFUL);
+        if (first == IDLE_NONE) {
+            return -1;
+        }
+        int next = atomic_load_explicit(&SHM_OPERATORS(shm)[first - 1].idle_next, memory_order_relaxed);
+        next_top = ((top >> 32) + 1) << 32 | (unsigned long)next;
+    } while (!atomic_compare_exchange_weak_explicit(&shm->idle_operators[service].top, &top, next_top,
+                                                    memory_order_acquire, memory_order_acquire));
+
+    return (int)(top & 0xFFFFFFFFUL) - 1;
+}
+
+// Prima fase dell'attesa: l'operatore si iscrive come inattivo e legge la
+// propria parola futex. Il chiamante poi ricontrolla coda e flag della
+// giornata e chiama operator_wait() solo se deve davvero dormire
+unsigned int operator_prepare_wait(SharedMemory *shm, int op_id, int service)
+{
+    Operator *op = &SHM_OPERATORS(shm)[op_id];
+    unsigned int seen = atomic_load_explicit(&op->wakeup_seq, memory_order_acquire);
+
+    if (!atomic_exchange_explicit(&op->idle_listed, 1, memory_order_acq_rel)) {
+        idle_operator_push(shm, service, op_id);
+    }
+    if (op->skills & ~(1 << service)) {
+        atomic_store_explicit(&op->steal_listed, 1, memory_order_relaxed);
+    }
+    // L'iscrizione deve essere visibile prima di rileggere la coda (e il push
+    // del ticket prima di leggere la pila, vedi wake_idle_operator)
+    atomic_thread_fence(memory_order_seq_cst);
+    return seen;
+}
+
+// Seconda fase: dorme finché qualcuno non incrementa la parola futex o la
+// giornata day non viene chiusa (day_barrier.h). Un risveglio che non trova
+// né ticket del servizio né ticket da rubare a giornata in corso è "a vuoto"
+void operator_wait(SharedMemory *shm, int op_id, int service, unsigned int seen, unsigned int day)
+{
+    Operator *op = &SHM_OPERATORS(shm)[op_id];
+
+    day_barrier_sleep(shm, day, &op->wakeup_seq, seen);
+    atomic_store_explicit(&op->steal_listed, 0, memory_order_relaxed);
+    if (atomic_load_explicit(&op->wakeup_seq, memory_order_relaxed) == seen) {
+        return; // Fine giornata o segnale, non un risveglio mandato a lui
+    }
+    if (day_barrier_is_current(shm, day) && service_queue_length(shm, service) <= 0 &&
+        steal_candidate_service(shm, op_id) < 0) {
+        atomic_fetch_add_explicit(&shm->daily_spurious_wakeups[service], 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&shm->total_spurious_wakeups[service], 1, memory_order_relaxed);
+    }
+}
+
+// Sveglia un operatore specifico (anche dal suo stesso gestore di segnale,
+// così un segnale arrivato prima di FUTEX_WAIT non viene perso)
+void operator_wakeup(SharedMemory *shm, int op_id)
+{
+    Operator *op = &SHM_OPERATORS(shm)[op_id];
+    atomic_fetch_add_explicit(&op->wakeup_seq, 1, memory_order_release);
+    futex_wake(&op->wakeup_seq, 1);
+}
+
+// Sveglia un solo operatore inattivo del servizio, da chiamare dopo aver
+// accodato un ticket. Ritorna 1 se un operatore è stato svegliato
+int wake_idle_operator(SharedMemory *shm, int service)
+{
+    return wake_idle_operators(shm, service, 1);
+}
+
+// Sveglia fino a count operatori inattivi del servizio, uno per ticket
+// accodato (notifica cumulativa dopo un lotto di richieste).
+// Ritorna il numero di operatori svegliati
+int wake_idle_operators(SharedMemory *shm, int service, int count)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+
+    int woken = 0;
+    while (woken < count) {
+        // Un operatore andato in pausa resta nella pila: lo si scarta e si
+        // passa al successivo, altrimenti il ticket resterebbe senza nessuno sveglio
+        int op_id;
+        while ((op_id = idle_operator_pop(shm, service)) >= 0) {
+            atomic_store_explicit(&SHM_OPERATORS(shm)[op_id].idle_listed, 0, memory_order_release);
+            if (SHM_OPERATORS(shm)[op_id].status == OPERATOR_WORKING) {
+                break;
+            }
+        }
+        if (op_id < 0) {
+            break; // Tutti occupati: vedranno i ticket al prossimo giro
+        }
+        operator_wakeup(shm, op_id);
+        woken++;
+    }
+
+    if (woken > 0) {
+        atomic_fetch_add_explicit(&shm->ticketing[service].daily_operator_wakeups, woken, memory_order_relaxed);
+        atomic_fetch_add_explicit(&shm->ticketing[service].total_operator_wakeups, woken, memory_order_relaxed);
+    }
+    return woken;
+}
+
+// Servizio da cui l'operatore può rubare: tra quelli che sa erogare (escluso
+// il proprio) la coda più lunga, purché abbia almeno STEAL_THRESHOLD ticket.
+// Ritorna -1 se non c'è niente da rubare
+int steal_candidate_service(SharedMemory *shm, int op_id)
+{
+    Operator *op = &SHM_OPERATORS(shm)[op_id];
+    int best_service = -1;
+    int best_length = STEAL_THRESHOLD - 1;
+
+    for (int service = 0; service < SERVICE_COUNT; service++) {
+        if (service == (int)op->current_service || !(op->skills & (1 << service))) {
+            continue;
+        }
+        int length = service_queue_length(shm, service);
+        if (length > best_length) {
+            best_service = service;
+            best_length = length;
+        }
+    }
+    return best_service;
+}
+
+// Sveglia fino a count operatori inattivi di altri servizi che sanno erogare
+// il servizio, da chiamare quando wake_idle_operators() non ha trovato
+// abbastanza operatori del servizio. Scorre gli operatori solo in questo caso
+// e solo se la coda è abbastanza lunga da essere rubata.
+// Ritorna il numero di operatori svegliati
+int wake_idle_stealers(SharedMemory *shm, int service, int count)
+{
+    if (OPERATOR_SKILLS <= 1 || service_queue_length(shm, service) < STEAL_THRESHOLD) {
+        return 0;
+    }
+    atomic_thread_fence(memory_order_seq_cst);
+
+    int woken = 0;
+    for (int op_id = 0; op_id < NOF_WORKERS && woken < count; op_id++) {
+        Operator *op = &SHM_OPERATORS(shm)[op_id];
+        if (!(op->skills & (1 << service)) || op->status != OPERATOR_WORKING ||
+            !atomic_load_explicit(&op->steal_listed, memory_order_relaxed)) {
+            continue;
+        }
+        if (atomic_exchange_explicit(&op->steal_listed, 0, memory_order_acq_rel)) {
+            operator_wakeup(shm, op_id);
+            woken++;
+        }
+    }
+
+    if (woken > 0) {
+        atomic_fetch_add_explicit(&shm->ticketing[service].daily_operator_wakeups, woken, memory_order_relaxed);
+        atomic_fetch_add_explicit(&shm->ticketing[service].total_operator_wakeups, woken, memory_order_relaxed);
+    }
+    return woken;
+}
+
+#endif // NOTIFY_H
@@ -0,0 +1,743 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <string.h>
+#include <errno.h>
+#include "config.h"
+#include "shm_layout.h"
+#include "sim_model.h"
+#include "statistics.h"
+
+// Variante multi-thread del progetto: direttore, ticket, operatori e utenti
+// sono thread dello stesso processo. Il modello e le statistiche sono gli
+// stessi della versione a processi, ma al posto di memoria condivisa SysV,
+// semafori, coda di messaggi e segnali si usano memoria privata, mutex e
+// variabili di condizione. Serve a misurare quanto della latenza dipende
+// dallo strato IPC e a provare configurazioni con molti utenti.
+
+#define MT_THREAD_STACK_SIZE (128 * 1024)  // Stack ridotto: gli utenti possono essere migliaia
+#define MT_CHECK_INTERVAL_MS 100            // Controllo di esplosione del direttore
+
+typedef struct {
+    pthread_t thread;
+    int id;
+    pthread_cond_t ticket_cond;   // Sveglia l'utente quando il ticket è pronto
+} UserThread;
+
+typedef struct {
+    pthread_t thread;
+    int id;
+    ServiceType service;          // Servizio assegnato all'operatore (FISSO)
+} OperatorThread;
+
+SharedMemory *shared_memory = NULL;
+
+// Controllo della giornata (sostituisce SIGUSR1/SIGUSR2 e SEM_DAY_START)
+pthread_mutex_t day_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t day_cond = PTHREAD_COND_INITIALIZER;       // Inizio/fine giornata
+pthread_cond_t day_done_cond = PTHREAD_COND_INITIALIZER;  // Tutti i thread hanno chiuso la giornata
+int day_generation = 0;         // Incrementato a ogni inizio giornata
+int threads_done = 0;           // Thread che hanno chiuso la giornata corrente
+int terminating = 0;            // Fine simulazione
+struct timespec day_start;      // Inizio della giornata corrente (CLOCK_MONOTONIC)
+
+// Statistiche e sportelli (stats_lock e counters_lock dei processi, shm_sync.h)
+pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t counters_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t counters_cond = PTHREAD_COND_INITIALIZER;  // Uno sportello si è liberato
+
+// Richieste di ticket (SEM_QUEUE + coda di messaggi): indici in ticket_requests
+pthread_mutex_t request_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t request_cond = PTHREAD_COND_INITIALIZER;
+int *request_ring = NULL;      // Una posizione per ogni slot del pool, più una per distinguere piena da vuota
+int request_ring_size = 0;
+int request_ring_head = 0;
+int request_ring_tail = 0;
+
+// Le code dei servizi sono i ring lock-free in memoria condivisa; mutex e
+// condizione servono solo a far dormire gli operatori quando la coda è vuota
+pthread_mutex_t service_lock[SERVICE_COUNT];
+pthread_cond_t service_cond[SERVICE_COUNT];
+int idle_operators[SERVICE_COUNT];     // Operatori in attesa sulla condizione (sotto service_lock)
+
+UserThread *users = NULL;
+OperatorThread *operators = NULL;
+pthread_t ticket_thread;
+int total_threads = 0;
+
+// -----------------------------------------------------------------------------
+// Sincronizzazione della giornata
+// -----------------------------------------------------------------------------
+
+// Istante assoluto a offset_ns dall'inizio della giornata
+struct timespec day_deadline(long offset_ns)
+{
+    struct timespec deadline;
+    deadline.tv_sec = day_start.tv_sec + offset_ns / 1000000000L;
+    deadline.tv_nsec = day_start.tv_nsec + offset_ns % 1000000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return deadline;
+}
+
+// Giornata in corso? Il flag viene letto sotto mutex diversi (code, sportelli,
+// richieste), quindi la lettura è atomica invece che protetta da day_lock
+int day_running()
+{
+    return __atomic_load_n(&shared_memory->day_in_progress, __ATOMIC_ACQUIRE) &&
+           !__atomic_load_n(&terminating, __ATOMIC_ACQUIRE);
+}
+
+// Attende l'inizio di una nuova giornata. Ritorna 0 a fine simulazione
+int wait_for_day_start(int *seen_generation)
+{
+    pthread_mutex_lock(&day_lock);
+    while (!terminating && day_generation == *seen_generation) {
+        pthread_cond_wait(&day_cond, &day_lock);
+    }
+    *seen_generation = day_generation;
+    int running = !terminating;
+    pthread_mutex_unlock(&day_lock);
+    return running;
+}
+
+// Attende fino alla scadenza o alla fine della giornata.
+// Ritorna 1 se la scadenza è arrivata con la giornata ancora in corso
+int wait_until_or_day_end(const struct timespec *deadline)
+{
+    pthread_mutex_lock(&day_lock);
+    while (day_running()) {
+        if (pthread_cond_timedwait(&day_cond, &day_lock, deadline) == ETIMEDOUT) {
+            break;
+        }
+    }
+    int reached = day_running();
+    pthread_mutex_unlock(&day_lock);
+    return reached;
+}
+
+// Attende la fine della giornata
+void wait_for_day_end()
+{
+    pthread_mutex_lock(&day_lock);
+    while (day_running()) {
+        pthread_cond_wait(&day_cond, &day_lock);
+    }
+    pthread_mutex_unlock(&day_lock);
+}
+
+// Segnala al direttore che il thread ha chiuso la giornata
+void mark_day_done()
+{
+    pthread_mutex_lock(&day_lock);
+    threads_done++;
+    if (threads_done == total_threads) {
+        pthread_cond_signal(&day_done_cond);
+    }
+    pthread_mutex_unlock(&day_lock);
+}
+
+// Termina la giornata (o la simulazione) e sveglia tutti i thread in attesa.
+// Ogni mutex viene acquisito prima del broadcast, così nessun thread può
+// perdere la sveglia tra il controllo della condizione e l'attesa
+void end_day(int stop_simulation)
+{
+    pthread_mutex_lock(&day_lock);
+    __atomic_store_n(&shared_memory->day_in_progress, 0, __ATOMIC_RELEASE);
+    if (stop_simulation) {
+        __atomic_store_n(&terminating, 1, __ATOMIC_RELEASE);
+    }
+    pthread_cond_broadcast(&day_cond);
+    pthread_mutex_unlock(&day_lock);
+
+    pthread_mutex_lock(&request_lock);
+    pthread_cond_broadcast(&request_cond);
+    for (int i = 0; i < NOF_USERS; i++) {
+        pthread_cond_signal(&users[i].ticket_cond);
+    }
+    pthread_mutex_unlock(&request_lock);
+
+    pthread_mutex_lock(&counters_lock);
+    pthread_cond_broadcast(&counters_cond);
+    pthread_mutex_unlock(&counters_lock);
+
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        pthread_mutex_lock(&service_lock[i]);
+        pthread_cond_broadcast(&service_cond[i]);
+        pthread_mutex_unlock(&service_lock[i]);
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Ticket
+// -----------------------------------------------------------------------------
+
+// Emette il ticket e lo accoda al servizio (come process_new_ticket_request).
+// La decisione (emissione o rifiuto) avviene sotto request_lock, lo stesso
+// mutex con cui l'utente controlla la fine giornata: o l'utente riceve il
+// ticket mentre è ancora in attesa, o la richiesta resta "senza ticket"
+void issue_ticket(int request_index)
+{
+    TicketRequest *request = &SHM_REQUESTS(shared_memory)[request_index];
+    int service_id = request->service_id;
+
+    pthread_mutex_lock(&request_lock);
+    if (!day_running()) {
+        request->status = REQUEST_REJECTED;
+        pthread_cond_signal(&users[request->user_id].ticket_cond);
+        pthread_mutex_unlock(&request_lock);
+        request_release(shared_memory, request_index);
+        return;
+    }
+
+    pthread_mutex_lock(&service_lock[service_id]);
+    if (!service_queue_push(shared_memory, service_id, request_index)) {
+        pthread_mutex_unlock(&service_lock[service_id]);
+        request->status = REQUEST_REJECTED;
+        pthread_cond_signal(&users[request->user_id].ticket_cond);
+        pthread_mutex_unlock(&request_lock);
+        request_release(shared_memory, request_index);
+        return;
+    }
+    int ticket_number = shared_memory->ticketing[service_id].next_ticket++;
+    shared_memory->ticketing[service_id].daily_issued++;
+    // Un solo operatore svegliato per ticket, e solo se qualcuno sta aspettando
+    if (idle_operators[service_id] > 0) {
+        pthread_cond_signal(&service_cond[service_id]);
+        atomic_fetch_add(&shared_memory->ticketing[service_id].daily_operator_wakeups, 1);
+        atomic_fetch_add(&shared_memory->ticketing[service_id].total_operator_wakeups, 1);
+    }
+    pthread_mutex_unlock(&service_lock[service_id]);
+
+    request->ticket_number = ticket_number;
+    snprintf(request->ticket_id, sizeof(request->ticket_id), "%c%d", SERVICE_PREFIXES[service_id], ticket_number);
+    request->status = REQUEST_COMPLETED;
+    pthread_cond_signal(&users[request->user_id].ticket_cond);
+    pthread_mutex_unlock(&request_lock);
+}
+
+void *ticket_main(void *arg __attribute__((unused)))
+{
+    int seen_generation = 0;
+
+    while (wait_for_day_start(&seen_generation)) {
+        pthread_mutex_lock(&request_lock);
+        for (;;) {
+            while (request_ring_head == request_ring_tail && day_running()) {
+                pthread_cond_wait(&request_cond, &request_lock);
+            }
+            if (request_ring_head == request_ring_tail) {
+                break; // Giornata finita e nessuna richiesta in sospeso
+            }
+            int request_index = request_ring[request_ring_head];
+            request_ring_head = (request_ring_head + 1) % request_ring_size;
+            SHM_REQUESTS(shared_memory)[request_index].status = REQUEST_PROCESSING;
+
+            pthread_mutex_unlock(&request_lock);
+            issue_ticket(request_index);
+            pthread_mutex_lock(&request_lock);
+        }
+        pthread_mutex_unlock(&request_lock);
+
+        mark_day_done();
+    }
+    return NULL;
+}
+
+// -----------------------------------------------------------------------------
+// Operatori
+// -----------------------------------------------------------------------------
+
+// Ottiene uno sportello del proprio servizio: quello già consegnato da
+// counter_handoff() o uno libero (counter_index.h), altrimenti si mette in
+// coda e attende la consegna. Ritorna l'indice dello sportello o -1 a fine giornata
+int acquire_counter(OperatorThread *op)
+{
+    Operator *info = &SHM_OPERATORS(shared_memory)[op->id];
+    int assigned_counter = -1;
+
+    pthread_mutex_lock(&counters_lock);
+    while (assigned_counter < 0 && day_running()) {
+        assigned_counter = info->counter_id;
+        if (assigned_counter < 0) {
+            assigned_counter = counter_free_pop(shared_memory, op->service);
+            if (assigned_counter >= 0) {
+                counter_staff(shared_memory, assigned_counter, info->pid);
+                info->counter_id = assigned_counter;
+            }
+        }
+        if (assigned_counter >= 0) {
+            info->status = OPERATOR_WORKING;
+        } else {
+            info->status = OPERATOR_WAITING;
+            waiting_operator_enqueue(shared_memory, op->id);
+            pthread_cond_wait(&counters_cond, &counters_lock);
+        }
+    }
+    pthread_mutex_unlock(&counters_lock);
+    return assigned_counter;
+}
+
+// Libera lo sportello. Durante la giornata lo consegna al primo operatore in
+// coda del servizio: la condizione è condivisa, gli altri in attesa, senza
+// sportello, tornano a dormire. A fine giornata resta semplicemente libero
+void release_counter(OperatorThread *op, int counter_id, int handoff)
+{
+    pthread_mutex_lock(&counters_lock);
+    SHM_OPERATORS(shared_memory)[op->id].counter_id = -1;
+    if (!handoff) {
+        counter_unstaff(shared_memory, counter_id);
+    } else if (counter_handoff(shared_memory, counter_id) >= 0) {
+        pthread_cond_broadcast(&counters_cond);
+    }
+    pthread_mutex_unlock(&counters_lock);
+}
+
+// Serve il prossimo utente in coda. Ritorna 1 se servito, -1 se l'operatore
+// va in pausa, 0 a fine giornata
+int serve_next_customer(OperatorThread *op, int assigned_counter)
+{
+    int service = op->service;
+
+    pthread_mutex_lock(&service_lock[service]);
+    while (service_queue_length(shared_memory, service) <= 0 && day_running()) {
+        idle_operators[service]++;
+        pthread_cond_wait(&service_cond[service], &service_lock[service]);
+        idle_operators[service]--;
+        if (service_queue_length(shared_memory, service) <= 0 && day_running()) {
+            // Risveglio a vuoto: il ticket l'ha preso un altro operatore
+            atomic_fetch_add(&shared_memory->daily_spurious_wakeups[service], 1);
+            atomic_fetch_add(&shared_memory->total_spurious_wakeups[service], 1);
+        }
+    }
+    if (!day_running()) {
+        pthread_mutex_unlock(&service_lock[service]);
+        return 0;
+    }
+
+    // Verifica probabilità di pausa PRIMA di servire l'utente
+    if (shared_memory->total_pauses_simulation < NOF_PAUSE && (rand() % 100) < BREAK_PROBABILITY) {
+        pthread_mutex_unlock(&service_lock[service]);
+
+        int on_break = 0;
+        pthread_mutex_lock(&stats_lock);
+        if (shared_memory->total_pauses_simulation < NOF_PAUSE) {
+            SHM_OPERATORS(shared_memory)[op->id].total_pauses++;
+            shared_memory->total_pauses_simulation++;
+            on_break = 1;
+        }
+        pthread_mutex_unlock(&stats_lock);
+
+        if (on_break) {
+            SHM_OPERATORS(shared_memory)[op->id].status = OPERATOR_ON_BREAK;
+            release_counter(op, assigned_counter, 1);
+            return -1;
+        }
+        pthread_mutex_lock(&service_lock[service]);
+        if (service_queue_length(shared_memory, service) <= 0) {
+            pthread_mutex_unlock(&service_lock[service]);
+            return 1; // Un altro operatore ha preso il ticket: si riprova
+        }
+    }
+
+    // Estrae il ticket da servire dalla coda
+    int ticket_idx;
+    int popped = service_queue_pop(shared_memory, service, &ticket_idx);
+    pthread_mutex_unlock(&service_lock[service]);
+    if (!popped) {
+        return 1; // Coda vuota: si torna ad attendere
+    }
+
+    TicketRequest *ticket = &SHM_REQUESTS(shared_memory)[ticket_idx];
+    ticket->being_served = 1;
+    ticket->serving_operator_pid = SHM_OPERATORS(shared_memory)[op->id].pid;
+
+    // Calcola tempo di attesa (in nanosecondi)
+    clock_gettime(CLOCK_MONOTONIC, &ticket->service_start_time);
+    ticket->wait_time_ns = (ticket->service_start_time.tv_sec - ticket->request_time.tv_sec) * 1000000000L +
+                           (ticket->service_start_time.tv_nsec - ticket->request_time.tv_nsec);
+
+    // Simula il servizio: si interrompe solo a fine giornata
+    long service_time = calculate_random_service_time(service);
+    struct timespec service_end = ticket->service_start_time;
+    service_end.tv_sec += service_time / 1000000000L;
+    service_end.tv_nsec += service_time % 1000000000L;
+    if (service_end.tv_nsec >= 1000000000L) {
+        service_end.tv_sec++;
+        service_end.tv_nsec -= 1000000000L;
+    }
+
+    if (!wait_until_or_day_end(&service_end)) {
+        // Servizio interrotto: verrà contato da count_remaining_tickets()
+        ticket->being_served = 0;
+        ticket->serving_operator_pid = 0;
+        request_release(shared_memory, ticket_idx);
+        return 0;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long actual_service_time_ns = (now.tv_sec - ticket->service_start_time.tv_sec) * 1000000000L +
+                                  (now.tv_nsec - ticket->service_start_time.tv_nsec);
+
+    // Registro statistico del solo operatore: nessun lock
+    record_completed_service(shared_memory, op->id, service, ticket->wait_time_ns, actual_service_time_ns);
+
+    ticket->counter_id = assigned_counter;
+    ticket->served_successfully = 1;
+    ticket->being_served = 0;
+    ticket->serving_operator_pid = 0;
+    request_release(shared_memory, ticket_idx);
+    return 1;
+}
+
+void *operator_main(void *arg)
+{
+    OperatorThread *op = (OperatorThread *)arg;
+    Operator *info = &SHM_OPERATORS(shared_memory)[op->id];
+    int seen_generation = 0;
+
+    while (wait_for_day_start(&seen_generation)) {
+        // Il nuovo giorno fa rientrare l'operatore dalla pausa
+        info->status = OPERATOR_WAITING;
+
+        int assigned_counter = acquire_counter(op);
+        if (assigned_counter >= 0) {
+            int result;
+            while ((result = serve_next_customer(op, assigned_counter)) == 1) {
+            }
+            if (result == 0) {
+                release_counter(op, assigned_counter, 0);
+            }
+        }
+
+        // In pausa o a fine servizio: si attende la chiusura della giornata
+        wait_for_day_end();
+        info->status = OPERATOR_FINISHED;
+        mark_day_done();
+    }
+    return NULL;
+}
+
+// -----------------------------------------------------------------------------
+// Utenti
+// -----------------------------------------------------------------------------
+
+// Verifica disponibilità del servizio (sportello + operatore) senza lock:
+// gli sportelli presidiati sono contati da counter_index.h
+int service_available(int service_id)
+{
+    return atomic_load_explicit(&shared_memory->service_available[service_id], memory_order_acquire) > 0;
+}
+
+void add_users_home(int service_id)
+{
+    pthread_mutex_lock(&stats_lock);
+    shared_memory->daily_users_home[service_id]++;
+    shared_memory->total_users_home++;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+void add_users_not_arrived()
+{
+    pthread_mutex_lock(&stats_lock);
+    // Non sappiamo quale servizio avrebbe scelto, quindi incrementiamo un servizio casuale
+    int random_service = rand() % SERVICE_COUNT;
+    shared_memory->daily_users_not_arrived[random_service]++;
+    shared_memory->total_users_not_arrived++;
+    shared_memory->total_users_not_arrived_per_service[random_service]++;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+// Crea la richiesta e la passa al thread ticket. Ritorna l'indice o -1
+int submit_request(UserThread *user, int service_id)
+{
+    // Lo slot arriva già azzerato dal pool, con i riferimenti di utente e sistema
+    int request_index = request_alloc(shared_memory, REQUEST_REFS_USER_AND_SYSTEM);
+    if (request_index < 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&request_lock);
+    TicketRequest *request = &SHM_REQUESTS(shared_memory)[request_index];
+    request->user_id = user->id;
+    request->service_id = service_id;
+    request->status = REQUEST_PENDING;
+    clock_gettime(CLOCK_MONOTONIC, &request->request_time);
+
+    request_ring[request_ring_tail] = request_index;
+    request_ring_tail = (request_ring_tail + 1) % request_ring_size;
+    pthread_cond_signal(&request_cond);
+    pthread_mutex_unlock(&request_lock);
+    return request_index;
+}
+
+// Attende il ticket; a fine giornata una richiesta ancora aperta conta come "senza ticket"
+void wait_for_ticket(UserThread *user, int request_index, int service_id)
+{
+    TicketRequest *request = &SHM_REQUESTS(shared_memory)[request_index];
+
+    pthread_mutex_lock(&request_lock);
+    while ((request->status == REQUEST_PENDING || request->status == REQUEST_PROCESSING) &&
+           day_running()) {
+        pthread_cond_wait(&user->ticket_cond, &request_lock);
+    }
+    // Anche una richiesta rifiutata perché la giornata è finita resta senza ticket
+    int no_ticket = request->status != REQUEST_COMPLETED;
+    pthread_mutex_unlock(&request_lock);
+
+    if (no_ticket && !__atomic_load_n(&terminating, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&stats_lock);
+        shared_memory->daily_users_no_ticket[service_id]++;
+        shared_memory->total_users_no_ticket++;
+        pthread_mutex_unlock(&stats_lock);
+    }
+    request_release(shared_memory, request_index);
+}
+
+void *user_main(void *arg)
+{
+    UserThread *user = (UserThread *)arg;
+    int personal_probability = calculate_personal_probability();
+    int seen_generation = 0;
+
+    while (wait_for_day_start(&seen_generation)) {
+        int service_id = determine_arrival_and_service(personal_probability);
+
+        if (service_id < 0) {
+            // L'utente ha deciso di non presentarsi all'ufficio postale
+            add_users_not_arrived();
+        } else {
+            struct timespec arrival = day_deadline(minutes_to_simulation_nanoseconds(determine_arrival_time()));
+
+            if (!wait_until_or_day_end(&arrival) || !service_available(service_id)) {
+                // Giornata finita prima dell'arrivo o servizio non disponibile
+                add_users_home(service_id);
+            } else {
+                int request_index = submit_request(user, service_id);
+                if (request_index < 0) {
+                    add_users_home(service_id);
+                } else {
+                    wait_for_ticket(user, request_index, service_id);
+                }
+            }
+        }
+
+        wait_for_day_end();
+        mark_day_done();
+    }
+    return NULL;
+}
+
+// -----------------------------------------------------------------------------
+// Direttore
+// -----------------------------------------------------------------------------
+
+void start_threads()
+{
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, MT_THREAD_STACK_SIZE);
+
+    if (pthread_create(&ticket_thread, &attr, ticket_main, NULL) != 0) {
+        perror("pthread_create failed for ticket");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < NOF_WORKERS; i++) {
+        operators[i].id = i;
+        operators[i].service = rand() % SERVICE_COUNT;
+
+        // PID virtuale (indice + 1): tutti i thread condividono il PID del processo
+        SHM_OPERATORS(shared_memory)[i].pid = i + 1;
+        SHM_OPERATORS(shared_memory)[i].current_service = operators[i].service;
+        SHM_OPERATORS(shared_memory)[i].active = 1;
+        SHM_OPERATORS(shared_memory)[i].status = OPERATOR_WAITING;
+        SHM_OPERATORS(shared_memory)[i].counter_id = -1;
+
+        if (pthread_create(&operators[i].thread, &attr, operator_main, &operators[i]) != 0) {
+            perror("pthread_create failed for operatore");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (int i = 0; i < NOF_USERS; i++) {
+        users[i].id = i;
+        pthread_cond_init(&users[i].ticket_cond, NULL);
+        if (pthread_create(&users[i].thread, &attr, user_main, &users[i]) != 0) {
+            perror("pthread_create failed for utente");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    pthread_attr_destroy(&attr);
+}
+
+void join_threads()
+{
+    pthread_join(ticket_thread, NULL);
+    for (int i = 0; i < NOF_WORKERS; i++) {
+        pthread_join(operators[i].thread, NULL);
+    }
+    for (int i = 0; i < NOF_USERS; i++) {
+        pthread_join(users[i].thread, NULL);
+        pthread_cond_destroy(&users[i].ticket_cond);
+    }
+}
+
+// Apre la giornata: reset di richieste e code, poi sveglia tutti i thread
+void start_day()
+{
+    request_ring_head = 0;
+    request_ring_tail = 0;
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        shared_memory->ticketing[i].next_ticket = 1;
+    }
+
+    pthread_mutex_lock(&day_lock);
+    threads_done = 0;
+    clock_gettime(CLOCK_MONOTONIC, &day_start);
+    __atomic_store_n(&shared_memory->day_in_progress, 1, __ATOMIC_RELEASE);
+    day_generation++;
+    pthread_cond_broadcast(&day_cond);
+    pthread_mutex_unlock(&day_lock);
+}
+
+// Attende che tutti i thread abbiano chiuso la giornata
+void wait_day_closed()
+{
+    pthread_mutex_lock(&day_lock);
+    while (threads_done < total_threads) {
+        pthread_cond_wait(&day_done_cond, &day_lock);
+    }
+    pthread_mutex_unlock(&day_lock);
+}
+
+void shutdown_simulation()
+{
+    end_day(1);
+    join_threads();
+    free(users);
+    free(operators);
+    free(request_ring);
+    free(shared_memory);
+}
+
+int main(int argc, char *argv[])
+{
+    const char* config_file = "timeout.conf"; // Default
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "explode") == 0) {
+            config_file = "explode.conf";
+        } else if (strcmp(argv[i], "timeout") == 0) {
+            config_file = "timeout.conf";
+        } else {
+            printf("Uso: %s [explode|timeout]\n", argv[0]);
+            printf("Default: timeout\n");
+        }
+    }
+
+    // Carica la configurazione
+    if (!read_config(config_file)) {
+        printf("Errore nel caricamento della configurazione, uso valori di default\n");
+    }
+
+    printf("=== CONFIGURAZIONE ATTIVA (multi-thread) ===\n");
+    printf("Operatori: %d, Utenti: %d, Sportelli: %d\n", NOF_WORKERS, NOF_USERS, NOF_WORKER_SEATS);
+    printf("Soglia esplosione: %d, Probabilità servizio: %d-%d%%\n", EXPLODE_THRESHOLD, P_SERV_MIN, P_SERV_MAX);
+    printf("=============================\n\n");
+
+    struct timespec run_start;
+    clock_gettime(CLOCK_MONOTONIC, &run_start);
+    srand(time(NULL));
+
+    shared_memory = shm_alloc_private();
+    users = calloc(NOF_USERS, sizeof(UserThread));
+    operators = calloc(NOF_WORKERS, sizeof(OperatorThread));
+    if (shared_memory == NULL || users == NULL || operators == NULL) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    request_ring_size = shared_memory->request_capacity + 1;
+    request_ring = calloc(request_ring_size, sizeof(int));
+    if (request_ring == NULL) {
+        perror("calloc");
+        exit(EXIT_FAILURE);
+    }
+    initialize_statistics(shared_memory);
+
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        pthread_mutex_init(&service_lock[i], NULL);
+        pthread_cond_init(&service_cond[i], NULL);
+    }
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&day_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    total_threads = 1 + NOF_WORKERS + NOF_USERS;
+    start_threads();
+
+    for (int day = 0; day < SIM_DURATION; day++)
+    {
+        shared_memory->simulation_day = day + 1;
+        printf("Day %d simulation started.\n", day + 1);
+
+        initialize_counters_for_day(shared_memory);
+        start_day();
+
+        printf("Simulazione giornata lavorativa %d (durata: %d secondi)...\n", day + 1, DAY_SIMULATION_TIME);
+
+        // Controllo periodico della soglia di esplosione
+        const long total_time_ms = DAY_SIMULATION_TIME * 1000L;
+        for (long elapsed_ms = MT_CHECK_INTERVAL_MS; elapsed_ms <= total_time_ms; elapsed_ms += MT_CHECK_INTERVAL_MS) {
+            struct timespec check_time = day_deadline(elapsed_ms * 1000000L);
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &check_time, NULL) == EINTR) {
+            }
+
+            if (elapsed_ms % 1000 == 0) {
+                printf("Giorno %d: %ld secondi passati\n", day + 1, elapsed_ms / 1000);
+            }
+
+            int total_waiting_users = count_waiting_users(shared_memory);
+            if (total_waiting_users > EXPLODE_THRESHOLD) {
+                printf("\n\n[EXPLODE] Il numero totale di utenti in coda (%d) ha superato la soglia di %d.\nLa simulazione termina per congestione eccessiva.\n\n", total_waiting_users, EXPLODE_THRESHOLD);
+                shutdown_simulation();
+                exit(EXIT_SUCCESS);
+            }
+        }
+
+        printf("Giorno %d Completato dopo %d secondi.\n", day + 1, DAY_SIMULATION_TIME);
+
+        // Fine giornata: nessuna attesa fissa, si aspetta che ogni thread abbia chiuso
+        end_day(0);
+        wait_day_closed();
+
+        merge_operator_stats(shared_memory);
+        count_remaining_tickets(shared_memory);
+        clear_all_queues_at_day_end(shared_memory);
+        collect_daily_statistics(shared_memory, day);
+        print_daily_summary(shared_memory);
+        print_comprehensive_statistics(shared_memory, day + 1);
+        print_service_timing_statistics_table(shared_memory, day + 1);
+        reset_daily_statistics(shared_memory);
+
+        printf("Giorno %d, simulazione finita.\n", day + 1);
+    }
+
+    shutdown_simulation();
+
+    struct timespec run_end;
+    clock_gettime(CLOCK_MONOTONIC, &run_end);
+    double elapsed_s = (run_end.tv_sec - run_start.tv_sec) + (run_end.tv_nsec - run_start.tv_nsec) / 1000000000.0;
+    printf("Simulazione multi-thread di %d giorni completata in %.3f s (%d thread).\n", SIM_DURATION, elapsed_s, total_threads);
+    return 0;
+}
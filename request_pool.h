@@ -0,0 +1,133 @@
+#ifndef REQUEST_POOL_H
+#define REQUEST_POOL_H
+
+#include <stddef.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "config.h"
+#include "futex_ops.h"
+
+// Pool degli slot delle richieste di ticket. Gli slot liberi formano una pila
+// lock-free (stesso schema della pila degli operatori inattivi, notify.h):
+// una richiesta prende uno slot all'arrivo dell'utente e lo restituisce
+// quando nessuno la usa più. Una giornata può quindi avere quante richieste
+// vuole, purché al più request_capacity siano vive nello stesso momento.
+// Ogni slot ha un contatore di riferimenti: l'utente finché attende l'esito e
+// il "sistema" (processo ticket, coda del servizio, operatore); l'ultimo che
+// lo rilascia lo rimette nella pila.
+// La generazione di uno slot è la giornata (day_epoch) in cui è stato
+// assegnato: il cambio di giornata incrementa solo day_epoch e una richiesta
+// rimasta da una giornata precedente viene riconosciuta da chi la incontra,
+// senza scorrere né azzerare tutti gli slot.
+
+#define REQUEST_REFS_SYSTEM 1           // Solo il sistema (tempo virtuale)
+#define REQUEST_REFS_USER_AND_SYSTEM 2  // Utente in attesa + sistema
+
+void request_pool_init(SharedMemory *shm);
+int request_alloc(SharedMemory *shm, int refs);
+void request_release(SharedMemory *shm, int request_index);
+int request_is_stale(SharedMemory *shm, int request_index);
+void request_pool_new_day(SharedMemory *shm);
+int request_change_status(TicketRequest *request, RequestStatus expected, RequestStatus desired);
+void request_publish_outcome(TicketRequest *request);
+void request_wake_user(TicketRequest *request);
+
+// Implementazione delle funzioni
+
+// Mette tutti gli slot nella pila (solo alla creazione del segmento)
+void request_pool_init(SharedMemory *shm)
+{
+    for (int i = 0; i < shm->request_capacity; i++) {
+        TicketRequest *request = &SHM_REQUESTS(shm)[i];
+        atomic_store_explicit(&request->refs, 0, memory_order_relaxed);
+        atomic_store_explicit(&request->next_free, i + 1 < shm->request_capacity ? i + 2 : 0, memory_order_relaxed);
+    }
+    // La cima contiene lo slot (indice + 1, 0 = pila vuota) nei 32 bit bassi e
+    // un contatore di modifiche in quelli alti contro il problema ABA
+    atomic_store_explicit(&shm->free_requests, shm->request_capacity > 0 ? 1UL : 0UL, memory_order_relaxed);
+    atomic_store_explicit(&shm->day_epoch, 1, memory_order_release);
+}
+
+// Prende uno slot libero e lo prepara per una nuova richiesta della giornata
+// corrente con refs riferimenti. Ritorna l'indice o -1 se il pool è esaurito
+int request_alloc(SharedMemory *shm, int refs)
+{
+    unsigned long top = atomic_load_explicit(&shm->free_requests, memory_order_acquire);
+    unsigned long next_top;
+
+    do {
+        int first = (int)(top & 0xFFFFFFFFUL);
+        if (first == 0) {
+            return -1;
+        }
+        int next = atomic_load_explicit(&SHM_REQUESTS(shm)[first - 1].next_free, memory_order_relaxed);
+        next_top = ((top >> 32) + 1) << 32 | (unsigned long)next;
+    } while (!atomic_compare_exchange_weak_explicit(&shm->free_requests, &top, next_top,
+                                                    memory_order_acquire, memory_order_acquire));
+
+    int request_index = (int)(top & 0xFFFFFFFFUL) - 1;
+    TicketRequest *request = &SHM_REQUESTS(shm)[request_index];
+
+    // Lo slot può contenere una richiesta vecchia: si azzerano i dati ma non
+    // i campi del pool, che altri possono leggere mentre scorrono la pila
+    memset(request, 0, offsetof(TicketRequest, refs));
+    request->generation = atomic_load_explicit(&shm->day_epoch, memory_order_acquire);
+    atomic_store_explicit(&request->refs, refs, memory_order_release);
+    return request_index;
+}
+
+// Rilascia un riferimento. L'ultimo rimette lo slot nella pila
+void request_release(SharedMemory *shm, int request_index)
+{
+    TicketRequest *request = &SHM_REQUESTS(shm)[request_index];
+    if (atomic_fetch_sub_explicit(&request->refs, 1, memory_order_acq_rel) != 1) {
+        return;
+    }
+
+    unsigned long top = atomic_load_explicit(&shm->free_requests, memory_order_relaxed);
+    unsigned long node;
+    do {
+        atomic_store_explicit(&request->next_free, (int)(top & 0xFFFFFFFFUL), memory_order_relaxed);
+        node = ((top >> 32) + 1) << 32 | (unsigned long)(request_index + 1);
+    } while (!atomic_compare_exchange_weak_explicit(&shm->free_requests, &top, node,
+                                                    memory_order_release, memory_order_relaxed));
+}
+
+// 1 se la richiesta appartiene a una giornata precedente
+int request_is_stale(SharedMemory *shm, int request_index)
+{
+    return SHM_REQUESTS(shm)[request_index].generation !=
+           atomic_load_explicit(&shm->day_epoch, memory_order_acquire);
+}
+
+// Cambio di giornata in O(1): le richieste ancora in giro diventano vecchie
+void request_pool_new_day(SharedMemory *shm)
+{
+    atomic_fetch_add_explicit(&shm->day_epoch, 1, memory_order_acq_rel);
+}
+
+// Cambia lo stato della richiesta solo se vale ancora expected. Ritorna 1 se
+// il cambio è avvenuto: serve quando processo ticket e utente possono
+// decidere insieme la sorte della stessa richiesta
+int request_change_status(TicketRequest *request, RequestStatus expected, RequestStatus desired)
+{
+    return __atomic_compare_exchange_n(&request->status, &expected, desired, 0,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+// Rende visibile all'utente l'esito appena scritto in status. Va chiamata
+// mentre il sistema tiene ancora il suo riferimento (prima di accodare il
+// ticket), così lo slot non può essere già passato a un'altra richiesta
+void request_publish_outcome(TicketRequest *request)
+{
+    atomic_fetch_add_explicit(&request->outcome_seq, 1, memory_order_release);
+}
+
+// Sveglia l'utente che dorme sull'esito. Se nel frattempo lo slot è stato
+// riassegnato, il nuovo proprietario riceve al più un risveglio a vuoto
+void request_wake_user(TicketRequest *request)
+{
+    futex_wake(&request->outcome_seq, 1);
+}
+
+#endif // REQUEST_POOL_H
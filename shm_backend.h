@@ -0,0 +1,288 @@
+#ifndef SHM_BACKEND_H
+#define SHM_BACKEND_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include "config.h"
+#include "shm_layout.h"
+
+// Creazione e collegamento del segmento di memoria condivisa, con due
+// backend scelti all'avvio dalla configurazione (SHM_BACKEND):
+//   0 = SysV (shmget/shmat con SHM_KEY, il comportamento storico)
+//   1 = POSIX (shm_open/mmap con SHM_POSIX_NAME)
+// Con il backend POSIX e SHM_HUGEPAGES=1 il segmento è un file su hugetlbfs
+// (SHM_HUGETLB_DIR, pagine da 2 MB riservate dal kernel); se il mount o le
+// pagine mancano si ripiega su shm_open con le transparent huge pages
+// (madvise). Il direttore passa ai figli il file scelto in SO_SHM_PATH.
+// Con SHM_PREFAULT=1 ogni processo mappa subito tutte le pagine
+// (MAP_POPULATE, o un accesso per pagina con SysV) e con SHM_MLOCK=1 le
+// blocca in RAM: durante la giornata nessun processo prende page fault o
+// miss del TLB al primo accesso a una regione del segmento.
+
+#define SHM_POSIX_NAME "/so_finale_shm"
+#define SHM_HUGETLB_DIR "/dev/hugepages"
+#define SHM_HUGETLB_MAGIC 0x958458f6 // f_type di hugetlbfs (statfs)
+#define SHM_PATH_ENV "SO_SHM_PATH"
+
+SharedMemory *shm_segment_create(size_t size);
+SharedMemory *shm_segment_attach(const char *who);
+void shm_segment_detach(SharedMemory *shm);
+void shm_segment_remove(void);
+void shm_segment_describe(void);
+
+// Stato del segmento in questo processo
+int shm_segment_id = -1;         // ID SysV (-1 con il backend POSIX)
+size_t shm_mapped_size = 0;      // Lunghezza della mappatura POSIX
+char shm_segment_path[256] = ""; // File su hugetlbfs, vuoto se shm_open
+int shm_huge_pages = 0;          // 1 = hugetlbfs, 2 = transparent huge pages
+
+// Implementazione delle funzioni
+
+// Porta in memoria tutte le pagine del segmento e, se richiesto, le blocca
+void shm_segment_prepare(void *addr, size_t size, int populated, const char *who)
+{
+    if (SHM_PREFAULT && !populated) {
+        // SysV non ha MAP_POPULATE: una lettura per pagina le mappa tutte
+        long page = sysconf(_SC_PAGESIZE);
+        volatile const char *bytes = addr;
+        for (size_t offset = 0; offset < size; offset += page) {
+            (void)bytes[offset];
+        }
+    }
+    if (SHM_MLOCK && mlock(addr, size) < 0) {
+        fprintf(stderr, "%s: mlock della memoria condivisa fallito (%s), continuo senza\n", who, strerror(errno));
+    }
+}
+
+// Segmento SysV come prima di SHM_BACKEND
+SharedMemory *shm_sysv_create(size_t size)
+{
+    shm_segment_id = shmget(SHM_KEY, size, IPC_CREAT | 0666);
+    if (shm_segment_id < 0 && errno == EINVAL) {
+        // Segmento rimasto da un'esecuzione precedente con un'altra dimensione
+        int old_shmid = shmget(SHM_KEY, 0, 0666);
+        if (old_shmid >= 0) {
+            shmctl(old_shmid, IPC_RMID, NULL);
+        }
+        shm_segment_id = shmget(SHM_KEY, size, IPC_CREAT | 0666);
+    }
+    if (shm_segment_id < 0) {
+        perror("shmget");
+        return NULL;
+    }
+
+    SharedMemory *shm = shmat(shm_segment_id, NULL, 0);
+    if (shm == (void *)-1) {
+        perror("shmat");
+        shmctl(shm_segment_id, IPC_RMID, NULL);
+        shm_segment_id = -1;
+        return NULL;
+    }
+    return shm;
+}
+
+// Apre il file del segmento POSIX: su hugetlbfs se richiesto e possibile,
+// altrimenti con shm_open. Aggiorna shm_segment_path e shm_mapped_size
+int shm_posix_open(size_t size)
+{
+    if (SHM_HUGEPAGES) {
+        struct statfs fs;
+        if (statfs(SHM_HUGETLB_DIR, &fs) == 0 && (unsigned long)fs.f_type == SHM_HUGETLB_MAGIC) {
+            snprintf(shm_segment_path, sizeof(shm_segment_path), "%s%s", SHM_HUGETLB_DIR, SHM_POSIX_NAME);
+            unlink(shm_segment_path);
+            int fd = open(shm_segment_path, O_CREAT | O_RDWR, 0666);
+            // La lunghezza va arrotondata alla dimensione della pagina huge (f_bsize)
+            size_t huge_size = (size + fs.f_bsize - 1) & ~((size_t)fs.f_bsize - 1);
+            if (fd >= 0 && ftruncate(fd, huge_size) == 0) {
+                shm_mapped_size = huge_size;
+                shm_huge_pages = 1;
+                return fd;
+            }
+            if (fd >= 0) {
+                close(fd);
+                unlink(shm_segment_path);
+            }
+        }
+        shm_segment_path[0] = '\0';
+    }
+
+    shm_unlink(SHM_POSIX_NAME); // Segmento rimasto da un'esecuzione precedente
+    int fd = shm_open(SHM_POSIX_NAME, O_CREAT | O_RDWR, 0666);
+    if (fd < 0) {
+        perror("shm_open");
+        return -1;
+    }
+    if (ftruncate(fd, size) < 0) {
+        perror("ftruncate");
+        close(fd);
+        shm_unlink(SHM_POSIX_NAME);
+        return -1;
+    }
+    shm_mapped_size = size;
+    shm_huge_pages = 0;
+    return fd;
+}
+
+// Mappa il file del segmento. Con hugetlbfs la prenotazione delle pagine
+// huge avviene qui: se non ce ne sono abbastanza mmap fallisce
+SharedMemory *shm_posix_map(int fd, const char *who)
+{
+    int flags = MAP_SHARED | (SHM_PREFAULT ? MAP_POPULATE : 0);
+    SharedMemory *shm = mmap(NULL, shm_mapped_size, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (shm == MAP_FAILED) {
+        fprintf(stderr, "%s: mmap della memoria condivisa fallita: %s\n", who, strerror(errno));
+        return NULL;
+    }
+#ifdef MADV_HUGEPAGE
+    if (SHM_HUGEPAGES && shm_segment_path[0] == '\0' && madvise(shm, shm_mapped_size, MADV_HUGEPAGE) == 0) {
+        shm_huge_pages = 2;
+    }
+#endif
+    return shm;
+}
+
+// Crea il segmento nel direttore (vuoto, da inizializzare). Ritorna NULL
+// in caso di errore, già segnalato
+SharedMemory *shm_segment_create(size_t size)
+{
+    SharedMemory *shm;
+
+    if (SHM_BACKEND == 0) {
+        shm = shm_sysv_create(size);
+        if (shm != NULL) {
+            shm_segment_prepare(shm, size, 0, "Direttore");
+        }
+        return shm;
+    }
+
+    int fd = shm_posix_open(size);
+    if (fd < 0) {
+        return NULL;
+    }
+    shm = shm_posix_map(fd, "Direttore");
+    if (shm == NULL && shm_segment_path[0] != '\0') {
+        // Pagine huge non disponibili: si ripiega su shm_open
+        close(fd);
+        unlink(shm_segment_path);
+        shm_segment_path[0] = '\0';
+        fd = shm_posix_open(size);
+        shm = fd >= 0 ? shm_posix_map(fd, "Direttore") : NULL;
+    }
+    if (fd >= 0) {
+        close(fd); // La mappatura resta valida senza il descrittore
+    }
+    if (shm == NULL) {
+        shm_segment_remove();
+        return NULL;
+    }
+
+    // I figli aprono lo stesso file del direttore
+    if (shm_segment_path[0] != '\0') {
+        setenv(SHM_PATH_ENV, shm_segment_path, 1);
+    } else {
+        unsetenv(SHM_PATH_ENV);
+    }
+    shm_segment_prepare(shm, shm_mapped_size, SHM_PREFAULT, "Direttore");
+    return shm;
+}
+
+// Collega un processo figlio al segmento creato dal direttore e ne verifica
+// il layout. Ritorna NULL in caso di errore, già segnalato
+SharedMemory *shm_segment_attach(const char *who)
+{
+    SharedMemory *shm;
+
+    if (SHM_BACKEND == 0) {
+        int shmid = shmget(SHM_KEY, 0, 0666);
+        if (shmid == -1) {
+            fprintf(stderr, "%s: shmget failed: %s\n", who, strerror(errno));
+            return NULL;
+        }
+        shm = shmat(shmid, NULL, 0);
+        if (shm == (void *)-1) {
+            fprintf(stderr, "%s: shmat failed: %s\n", who, strerror(errno));
+            return NULL;
+        }
+        shm_segment_id = shmid;
+    } else {
+        const char *path = getenv(SHM_PATH_ENV);
+        int fd = path != NULL ? open(path, O_RDWR) : shm_open(SHM_POSIX_NAME, O_RDWR, 0);
+        if (fd < 0) {
+            fprintf(stderr, "%s: apertura della memoria condivisa fallita: %s\n", who, strerror(errno));
+            return NULL;
+        }
+        struct stat st;
+        if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+            fprintf(stderr, "%s: memoria condivisa non ancora creata\n", who);
+            close(fd);
+            return NULL;
+        }
+        shm_mapped_size = st.st_size;
+        if (path != NULL) {
+            snprintf(shm_segment_path, sizeof(shm_segment_path), "%s", path);
+        }
+        shm = shm_posix_map(fd, who);
+        close(fd);
+        if (shm == NULL) {
+            return NULL;
+        }
+    }
+
+    if (!shm_check_layout(shm, who)) {
+        shm_segment_detach(shm);
+        return NULL;
+    }
+    shm_segment_prepare(shm, shm->total_size, SHM_BACKEND != 0 && SHM_PREFAULT, who);
+    return shm;
+}
+
+// Stacca il segmento da questo processo
+void shm_segment_detach(SharedMemory *shm)
+{
+    if (SHM_BACKEND == 0) {
+        shmdt(shm);
+    } else {
+        munmap(shm, shm_mapped_size);
+    }
+}
+
+// Rimuove il segmento (direttore, a fine simulazione o dopo un errore).
+// I processi ancora collegati continuano a usarlo fino al distacco
+void shm_segment_remove(void)
+{
+    if (SHM_BACKEND == 0) {
+        if (shm_segment_id != -1) {
+            shmctl(shm_segment_id, IPC_RMID, NULL);
+            shm_segment_id = -1;
+        }
+    } else if (shm_segment_path[0] != '\0') {
+        unlink(shm_segment_path);
+        shm_segment_path[0] = '\0';
+    } else {
+        shm_unlink(SHM_POSIX_NAME);
+    }
+}
+
+// Riassunto del backend in uso (stampato dal direttore all'avvio)
+void shm_segment_describe(void)
+{
+    const char *pages = shm_huge_pages == 1 ? ", pagine huge (hugetlbfs)" :
+                        shm_huge_pages == 2 ? ", transparent huge pages (madvise)" :
+                        SHM_HUGEPAGES ? ", pagine huge non disponibili" : "";
+    printf("Memoria condivisa: %s%s%s%s\n",
+           SHM_BACKEND == 0 ? "SysV (shmget)" : "POSIX (shm_open/mmap)",
+           SHM_BACKEND == 0 ? "" : pages,
+           SHM_PREFAULT ? ", prefault" : "",
+           SHM_MLOCK ? ", mlock" : "");
+}
+
+#endif // SHM_BACKEND_H
@@ -0,0 +1,196 @@
+#ifndef SHM_LAYOUT_H
+#define SHM_LAYOUT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "config.h"
+#include "request_pool.h"
+
+// Layout del segmento di memoria condivisa calcolato dalla configurazione
+// caricata. Dopo l'intestazione (SharedMemory) seguono le regioni, ognuna
+// allineata a SHM_REGION_ALIGN byte:
+//   PID utenti | PID operatori | sportelli | operatori | richieste | code |
+//   code di invio | giorni | registri statistici degli operatori |
+//   registratore di volo
+// Sportelli, operatori e registri statistici sono allineati alla linea di
+// cache (CACHE_LINE_SIZE): ogni elemento è scritto da un processo diverso.
+// Una configurazione piccola occupa pochi KB, una grande non viene troncata.
+
+#define SHM_REGION_ALIGN 16
+
+size_t shm_compute_layout(SharedMemory *layout);
+SharedMemory *shm_alloc_private();
+int shm_check_layout(SharedMemory *shm, const char *who);
+void service_queues_init(SharedMemory *shm);
+void service_queues_drain(SharedMemory *shm);
+int service_queue_push(SharedMemory *shm, int service, int request_index);
+int service_queue_pop(SharedMemory *shm, int service, int *request_index);
+int service_queue_length(SharedMemory *shm, int service);
+int count_waiting_users(SharedMemory *shm);
+void flight_record(SharedMemory *shm, int type, int service, int actor, int arg, int arg2);
+
+// Implementazione delle funzioni
+
+// Riserva una regione di count elementi allineata ad align byte (potenza di
+// due) e ne restituisce l'offset
+size_t shm_reserve_aligned(size_t *cursor, size_t count, size_t element_size, size_t align)
+{
+    size_t offset = (*cursor + align - 1) & ~(align - 1);
+    *cursor = offset + count * element_size;
+    return offset;
+}
+
+// Riserva una regione di count elementi e ne restituisce l'offset
+size_t shm_reserve(size_t *cursor, size_t count, size_t element_size)
+{
+    return shm_reserve_aligned(cursor, count, element_size, SHM_REGION_ALIGN);
+}
+
+// Compila capacità e offset dell'intestazione e restituisce la dimensione
+// totale del segmento. Può lavorare su un'intestazione temporanea (per sapere
+// quanta memoria chiedere) o direttamente su quella del segmento
+size_t shm_compute_layout(SharedMemory *layout)
+{
+    // Con l'host degli utenti non esiste un processo (e un PID) per utente
+    layout->user_capacity = USER_HOST ? 0 : NOF_USERS;
+    layout->worker_capacity = NOF_WORKERS;
+    layout->counter_capacity = NOF_WORKER_SEATS;
+    // Slot delle richieste vive nello stesso momento: ogni utente ne ha al
+    // massimo una, che può finire in una qualunque coda di servizio
+    layout->request_capacity = NOF_USERS > 0 ? NOF_USERS : 1;
+    // Le code dei servizi sono ring lock-free: capacità arrotondata alla
+    // potenza di due successiva
+    layout->queue_capacity = 1;
+    while (layout->queue_capacity < layout->request_capacity) {
+        layout->queue_capacity <<= 1;
+    }
+    layout->day_capacity = SIM_DURATION > 0 ? SIM_DURATION : 1;
+    // Un worker ticket senza servizi non avrebbe niente da fare
+    layout->ticket_worker_count = NOF_TICKET_WORKERS < SERVICE_COUNT ? NOF_TICKET_WORKERS : SERVICE_COUNT;
+    // Anche il registratore di volo è un ring con capacità potenza di due
+    layout->flight_capacity = 0;
+    if (FLIGHT_RECORDER_EVENTS > 0) {
+        layout->flight_capacity = 1;
+        while (layout->flight_capacity < (unsigned long)FLIGHT_RECORDER_EVENTS) {
+            layout->flight_capacity <<= 1;
+        }
+    }
+
+    size_t cursor = sizeof(SharedMemory);
+    layout->user_pids_offset = shm_reserve(&cursor, layout->user_capacity, sizeof(pid_t));
+    layout->operator_pids_offset = shm_reserve(&cursor, layout->worker_capacity, sizeof(pid_t));
+    layout->counters_offset = shm_reserve_aligned(&cursor, layout->counter_capacity, sizeof(Counter), CACHE_LINE_SIZE);
+    layout->operators_offset = shm_reserve_aligned(&cursor, layout->worker_capacity, sizeof(Operator), CACHE_LINE_SIZE);
+    layout->ticket_requests_offset = shm_reserve(&cursor, layout->request_capacity, sizeof(TicketRequest));
+    layout->service_queues_offset = shm_reserve(&cursor, (size_t)SERVICE_COUNT * layout->queue_capacity, sizeof(RingCell));
+    layout->submit_queues_offset = shm_reserve(&cursor, (size_t)layout->ticket_worker_count * layout->queue_capacity, sizeof(RingCell));
+    layout->day_stats_offset = shm_reserve(&cursor, layout->day_capacity, sizeof(DailyStatistics));
+    layout->stats_shards_offset = shm_reserve_aligned(&cursor, layout->worker_capacity, sizeof(OperatorStatsShard), CACHE_LINE_SIZE);
+    layout->flight_events_offset = shm_reserve_aligned(&cursor, layout->flight_capacity, sizeof(FlightEvent), CACHE_LINE_SIZE);
+
+    layout->total_size = cursor;
+    layout->magic = SHM_MAGIC;
+    return cursor;
+}
+
+// Segmento in memoria privata (tempo virtuale e variante multi-thread)
+SharedMemory *shm_alloc_private()
+{
+    SharedMemory layout;
+    size_t size = shm_compute_layout(&layout);
+
+    // Allineata alla linea di cache come il segmento attaccato con shmat()
+    SharedMemory *shm = aligned_alloc(CACHE_LINE_SIZE, (size + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1));
+    if (shm != NULL) {
+        memset(shm, 0, size);
+        shm_compute_layout(shm);
+        service_queues_init(shm);
+        request_pool_init(shm);
+    }
+    return shm;
+}
+
+// Verifica che il segmento attaccato da un processo figlio sia stato
+// inizializzato dal direttore con la stessa configurazione
+int shm_check_layout(SharedMemory *shm, const char *who)
+{
+    SharedMemory expected;
+    shm_compute_layout(&expected);
+
+    if (shm->magic != SHM_MAGIC || shm->total_size != expected.total_size) {
+        fprintf(stderr, "%s: layout della memoria condivisa non valido (configurazione diversa dal direttore?)\n", who);
+        return 0;
+    }
+    return 1;
+}
+
+// Svuota le code di tutti i servizi e le code di invio delle richieste
+// (nessun processo deve usarle nel frattempo)
+void service_queues_init(SharedMemory *shm)
+{
+    for (int service = 0; service < SERVICE_COUNT; service++) {
+        ring_init(SHM_SERVICE_RING(shm, service), SHM_SERVICE_CELLS(shm, service), shm->queue_capacity);
+    }
+    for (int worker = 0; worker < shm->ticket_worker_count; worker++) {
+        submit_queue_init(&shm->ticket_workers[worker].submit_queue, SHM_SUBMIT_CELLS(shm, worker), shm->queue_capacity);
+    }
+}
+
+// Svuota le code a fine giornata senza reinizializzarle: le richieste rimaste
+// vengono estratte e il sistema ne rilascia gli slot. Costa quanto i ticket
+// rimasti, non quanto la capacità delle code. Le code dei servizi tollerano
+// operatori ancora attivi; le code di invio hanno un solo consumatore, quindi
+// i processi ticket devono essere già usciti dal ciclo della giornata
+void service_queues_drain(SharedMemory *shm)
+{
+    int request_index;
+    for (int service = 0; service < SERVICE_COUNT; service++) {
+        while (service_queue_pop(shm, service, &request_index)) {
+            request_release(shm, request_index);
+        }
+    }
+    for (int worker = 0; worker < shm->ticket_worker_count; worker++) {
+        TicketWorker *ticket_worker = &shm->ticket_workers[worker];
+        while (submit_queue_drain(&ticket_worker->submit_queue, SHM_SUBMIT_CELLS(shm, worker), &request_index, 1)) {
+            request_release(shm, request_index);
+        }
+    }
+}
+
+// Accoda una richiesta al servizio. Ritorna 1 se accodata, 0 se la coda è piena
+int service_queue_push(SharedMemory *shm, int service, int request_index)
+{
+    return ring_push(SHM_SERVICE_RING(shm, service), SHM_SERVICE_CELLS(shm, service), request_index);
+}
+
+// Estrae la prossima richiesta del servizio. Ritorna 0 se la coda è vuota
+int service_queue_pop(SharedMemory *shm, int service, int *request_index)
+{
+    return ring_pop(SHM_SERVICE_RING(shm, service), SHM_SERVICE_CELLS(shm, service), request_index);
+}
+
+// Ticket in attesa per il servizio
+int service_queue_length(SharedMemory *shm, int service)
+{
+    return ring_count(SHM_SERVICE_RING(shm, service));
+}
+
+// Numero totale di utenti in coda su tutti i servizi (soglia di esplosione)
+int count_waiting_users(SharedMemory *shm)
+{
+    int total_waiting_users = 0;
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        total_waiting_users += service_queue_length(shm, i);
+    }
+    return total_waiting_users;
+}
+
+// Registra un evento nel registratore di volo (flight_recorder.h)
+void flight_record(SharedMemory *shm, int type, int service, int actor, int arg, int arg2)
+{
+    flight_recorder_record(&shm->flight_next, SHM_FLIGHT_EVENTS(shm), shm->flight_capacity,
+                           type, service, actor, arg, arg2);
+}
+
+#endif // SHM_LAYOUT_H
@@ -0,0 +1,61 @@
+#ifndef SHM_SYNC_H
+#define SHM_SYNC_H
+
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// Lock in memoria condivisa: mutex pthread PTHREAD_PROCESS_SHARED e robusti,
+// al posto dei semafori SysV usati come mutex (SEM_MUTEX, SEM_COUNTERS).
+// Senza contesa lock e unlock sono un'operazione atomica in user space, e
+// solo chi deve aspettare entra nel kernel (futex). Se il processo che tiene
+// il lock termina, il primo che lo prende riceve EOWNERDEAD: il lock viene
+// dichiarato di nuovo consistente e la simulazione prosegue, invece di
+// restare bloccata come con un semaforo preso senza SEM_UNDO.
+
+int shm_mutex_init(pthread_mutex_t *mutex);
+void shm_mutex_lock(pthread_mutex_t *mutex, const char *name);
+void shm_mutex_unlock(pthread_mutex_t *mutex);
+
+// Implementazione delle funzioni
+
+// Inizializza un mutex condiviso tra processi e robusto. Va chiamata una
+// sola volta, da chi crea il segmento, prima che gli altri processi lo usino
+int shm_mutex_init(pthread_mutex_t *mutex)
+{
+    pthread_mutexattr_t attr;
+    int result = pthread_mutexattr_init(&attr);
+    if (result == 0) {
+        result = pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    }
+    if (result == 0) {
+        result = pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    }
+    if (result == 0) {
+        result = pthread_mutex_init(mutex, &attr);
+    }
+    pthread_mutexattr_destroy(&attr);
+    return result;
+}
+
+// Prende il lock. Se il proprietario precedente è morto tenendolo, i dati
+// protetti possono essere a metà aggiornamento: lo si segnala e si prosegue
+void shm_mutex_lock(pthread_mutex_t *mutex, const char *name)
+{
+    int result = pthread_mutex_lock(mutex);
+    if (result == EOWNERDEAD) {
+        fprintf(stderr, "[%d] Lock %s recuperato da un processo terminato\n", getpid(), name);
+        pthread_mutex_consistent(mutex);
+    } else if (result != 0) {
+        fprintf(stderr, "[%d] Lock %s: %s\n", getpid(), name, strerror(result));
+    }
+}
+
+void shm_mutex_unlock(pthread_mutex_t *mutex)
+{
+    pthread_mutex_unlock(mutex);
+}
+
+#endif // SHM_SYNC_H
@@ -0,0 +1,98 @@
+#ifndef SIM_MODEL_H
+#define SIM_MODEL_H
+
+#include <stdlib.h>
+#include "config.h"
+
+// Funzioni del modello di simulazione condivise tra i processi reali
+// (utente, operatore) e il motore a tempo virtuale del direttore.
+// Tutte usano rand(): il chiamante si occupa del seed.
+
+int determine_arrival_and_service(int personal_probability);
+int calculate_personal_probability();
+int determine_arrival_time();
+long minutes_to_simulation_nanoseconds(int minutes);
+long calculate_random_service_time(ServiceType service);
+int assign_operator_skills(ServiceType primary);
+
+// Implementazione delle funzioni
+
+// Determina se l'utente arriva (e se arriva il servizio scelto)
+int determine_arrival_and_service(int personal_probability)
+{
+    // Lancia un dado da 1 a 100 per decidere se l'utente arriva
+    int arrival_roll = (rand() % 100) + 1;
+
+    // Se il tiro è maggiore della probabilità personale, l'utente non arriva
+    if (arrival_roll > personal_probability)
+    {
+        return -1; // -1 indica che l'utente non si presenta
+    }
+
+    // Se l'utente arriva, determina quale servizio desidera
+    int chosen_service = rand() % SERVICE_COUNT;
+    return chosen_service;
+}
+
+// Calcola la probabilità di arrivo personale per l'utente
+int calculate_personal_probability()
+{
+    if (P_SERV_MAX > 0 && P_SERV_MIN <= P_SERV_MAX)
+    {
+        return P_SERV_MIN + (rand() % (P_SERV_MAX - P_SERV_MIN + 1));
+    }
+    return 0;
+}
+
+// Calcola l'orario di arrivo in minuti (tra 0 e 479)
+int determine_arrival_time()
+{
+    //return 1;
+    return 1 + (rand() % (OFFICE_CLOSE_TIME - 1));
+}
+
+// Converti minuti simulati in nanosecondi per timer preciso
+long minutes_to_simulation_nanoseconds(int minutes)
+{
+    double seconds = ((double)minutes / WORK_DAY_MINUTES) * DAY_SIMULATION_TIME;
+    return (long)(seconds * 1000000000L); // Converti in nanosecondi
+}
+
+// Calcola tempo di servizio con variazione casuale ±50%
+long calculate_random_service_time(ServiceType service)
+{
+    // Cicla rand per migliorare casualità
+    for (int i = 0; i < 3; i++) {
+        rand();
+    }
+
+    long base_time = SERVICE_TIMES[service];
+
+    // Calcola una variazione casuale tra -50% e +50%
+    int rand_val = rand() % 101;
+    double variation = (rand_val - 50) / 100.0; // Da -0.5 a +0.5
+
+    long adjusted_time = base_time * (1.0 + variation);
+
+    return adjusted_time;
+}
+
+// Sceglie i servizi che un operatore sa erogare: il proprio più altri
+// OPERATOR_SKILLS - 1 servizi casuali distinti. Ritorna la maschera di bit
+int assign_operator_skills(ServiceType primary)
+{
+    int wanted = OPERATOR_SKILLS < SERVICE_COUNT ? OPERATOR_SKILLS : SERVICE_COUNT;
+    int skills = 1 << primary;
+    int count = 1;
+
+    while (count < wanted) {
+        int service = rand() % SERVICE_COUNT;
+        if (!(skills & (1 << service))) {
+            skills |= 1 << service;
+            count++;
+        }
+    }
+    return skills;
+}
+
+#endif // SIM_MODEL_H
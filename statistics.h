@@ -0,0 +1,864 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include "config.h"
+#include "shm_layout.h"
+#include "notify.h"
+#include "counter_index.h"
+#include "stats_shard.h"
+
+// Statistiche della simulazione: raccolta di fine giornata, reset e stampa
+// delle tabelle. Condivise dal direttore (processi reali e tempo virtuale) e
+// dalla variante multi-thread postoffice_mt, che lavorano tutte sulla stessa
+// struttura SharedMemory.
+
+void initialize_statistics(SharedMemory *shm);
+void initialize_counters_for_day(SharedMemory *shm_ptr);
+void count_remaining_tickets(SharedMemory *shm);
+void clear_all_queues_at_day_end(SharedMemory *shm);
+void collect_daily_statistics(SharedMemory *shm, int day_index);
+void reset_daily_statistics(SharedMemory *shm);
+double nanoseconds_to_simulated_minutes(long nanoseconds);
+void print_percentile_cells(LatencyHistogram *hist, const char *format, double unit_ns);
+void print_daily_summary(SharedMemory *shm_ptr);
+void print_service_timing_statistics_table(SharedMemory *shm, int days_completed);
+void print_comprehensive_statistics(SharedMemory *shm, int days_completed);
+
+// Implementazione delle funzioni
+
+// Inizializza gli sportelli con servizi casuali all'inizio di ogni giornata
+void initialize_counters_for_day(SharedMemory *shm_ptr)
+{
+    // Generatore di numeri casuali
+    srand(time(NULL) ^ shm_ptr->simulation_day);
+    
+    for (int counter_idx = 0; counter_idx < NOF_WORKER_SEATS; counter_idx++) {
+        // Genera un servizio casuale
+        int random_service = rand() % SERVICE_COUNT;
+        
+        // Inizializza lo sportello
+        SHM_COUNTERS(shm_ptr)[counter_idx].active = 1;
+        SHM_COUNTERS(shm_ptr)[counter_idx].current_service = random_service;
+        SHM_COUNTERS(shm_ptr)[counter_idx].operator_pid = 0;
+        SHM_COUNTERS(shm_ptr)[counter_idx].total_served = 0;
+        SHM_COUNTERS(shm_ptr)[counter_idx].handover_to = 0;
+        
+        // DEBUG: stampa l'inizializzazione dello sportello
+        //printf("Sportello %d: Servizio %s (%d)\n", counter_idx, SERVICE_NAMES[random_service], random_service);
+    }
+
+    // Tutti gli sportelli partono liberi, nessun operatore in coda
+    counter_index_reset(shm_ptr);
+}
+
+// Funzione per contare i ticket rimasti in coda alla fine della giornata:
+// ticket emessi nella giornata ma non serviti con successo (ancora in coda o
+// con il servizio interrotto). Usa i contatori per servizio invece di
+// scorrere tutti gli slot delle richieste
+void count_remaining_tickets(SharedMemory *shm) {
+    for (int service = 0; service < SERVICE_COUNT; service++) {
+        int not_served = shm->ticketing[service].daily_issued - shm->daily_tickets_served[service];
+        if (not_served > 0) {
+            shm->daily_users_timeout[service] += not_served;
+            shm->total_users_timeout += not_served;
+
+            // DEBUG: stampa conteggio
+            //printf("[CONTEGGIO] %d ticket di %s non serviti entro fine giornata - contati come interrotti\n", not_served, SERVICE_NAMES[service]);
+        }
+    }
+}
+
+// Funzione per svuotare tutte le code alla fine della giornata.
+// Le richieste rimaste diventano vecchie con il cambio di day_epoch
+void clear_all_queues_at_day_end(SharedMemory *shm) {
+    //printf("[RESET] Svuotamento di tutte le code alla fine della giornata %d\n", shm->simulation_day);
+    
+    // Svuota tutte le code dei servizi
+    for (int service = 0; service < SERVICE_COUNT; service++) {
+        if (service_queue_length(shm, service) > 0) {
+            // DEBUG: stampa quanti e quali ticket vengono scartati
+            //printf("[RESET] Servizio %s: %d ticket non serviti scartati\n", SERVICE_NAMES[service], service_queue_length(shm, service));
+        }
+    }
+
+    // Svuota le code rilasciando gli slot delle richieste, poi reset degli
+    // operatori inattivi e nuova generazione delle richieste
+    service_queues_drain(shm);
+    idle_operators_init(shm);
+    request_pool_new_day(shm);
+    
+}
+
+// Celle p50, p95 e p99 di una distribuzione dei tempi (latency_hist.h),
+// convertite in unit_ns nanosecondi per unità ("N/A" se è vuota)
+void print_percentile_cells(LatencyHistogram *hist, const char *format, double unit_ns)
+{
+    static const double percentiles[] = {50.0, 95.0, 99.0};
+
+    for (int p = 0; p < 3; p++) {
+        char cell[16] = "N/A";
+        long value_ns = latency_hist_percentile(hist, percentiles[p]);
+        if (value_ns >= 0) {
+            snprintf(cell, sizeof(cell), format, value_ns / unit_ns);
+        }
+        printf(" %8s |", cell);
+    }
+}
+
+// Funzione per stampare il riepilogo giornaliero unificato
+void print_daily_summary(SharedMemory *shm_ptr) {
+    // Calcola il numero di giorni completati
+    int days_completed = shm_ptr->simulation_day;
+    
+    // Calcola i valori SOLO del giorno corrente
+    int daily_users_served = 0;
+    int daily_services_not_provided = 0;
+    int daily_users_not_presented = 0;
+    
+    // Somma tutti i servizi del giorno corrente
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        daily_users_served += shm_ptr->daily_tickets_served[i];
+        daily_services_not_provided += shm_ptr->daily_users_home[i] + shm_ptr->daily_users_timeout[i] + shm_ptr->daily_users_no_ticket[i];
+        daily_users_not_presented += shm_ptr->daily_users_not_arrived[i];
+    }
+    
+    // Valori totali della simulazione
+    int total_services_not_provided = shm_ptr->total_services_not_provided_simulation;
+    int total_users_not_presented = shm_ptr->total_users_not_arrived;
+    
+    // Tabella unificata: Giornaliero | Totale Simulazione | Media Cumulativa
+    printf("\n+----------------------+--------------------+--------------------+--------------------+\n");
+    printf("| STATISTICHE UNIFICATE GIORNO %-3d                                         |\n", shm_ptr->simulation_day);
+    printf("+----------------------+--------------------+--------------------+--------------------+\n");
+    printf("|     Descrizione      |    Giornaliero     | Totale Simulazione |  Media Cumulativa  |\n");
+    printf("+----------------------+--------------------+--------------------+--------------------+\n");
+    
+    // Riga Utenti Serviti
+    double avg_users_served = days_completed > 0 ? (double)shm_ptr->total_users_served_simulation / days_completed : 0.0;
+    printf("| Utenti Serviti       | %-18d | %-18d | %-18.2f |\n", 
+           daily_users_served,  // SOLO del giorno corrente
+           shm_ptr->total_users_served_simulation, 
+           avg_users_served);
+    
+    // Riga Servizi Non Erogati 
+    double avg_services_not_provided = days_completed > 0 ? (double)total_services_not_provided / days_completed : 0.0;
+    printf("| Servizi Non Erogati  | %-18d | %-18d | %-18.2f |\n", 
+           daily_services_not_provided,  // SOLO del giorno corrente
+           total_services_not_provided, 
+           avg_services_not_provided);
+    
+    // Riga Utenti Non Presentati
+    double avg_users_not_presented = days_completed > 0 ? (double)total_users_not_presented / days_completed : 0.0;
+    printf("| Utenti Non Presentati| %-18d | %-18d | %-18.2f |\n", 
+           daily_users_not_presented,  // SOLO del giorno corrente
+           total_users_not_presented, 
+           avg_users_not_presented);
+    
+    printf("+----------------------+--------------------+--------------------+--------------------+\n");
+    
+    // Tabella dettagliata per servizio (solo giornaliera)
+    printf("\n+----------------------+----------------------+----------------------+----------------------+----------------------+----------------------+\n");
+    printf("| DETTAGLIO PER SERVIZIO - GIORNO %-3d                                                                               |\n", shm_ptr->simulation_day);
+    printf("+----------------------+----------------------+----------------------+----------------------+----------------------+----------------------+\n");
+    printf("|      Servizio       |  Utenti Serviti      |  Tornati a Casa      | Ticket Non Ricevuti  |  Servizio Interrotto |   Non Presentati    |\n");
+    printf("+----------------------+----------------------+----------------------+----------------------+----------------------+----------------------+\n");
+
+    int total_timeout = 0;
+    int total_no_ticket = 0;
+    int total_not_arrived = 0;
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        printf("| %-20s | %-20d | %-20d | %-20d | %-20d | %-20d |\n",
+               SERVICE_NAMES[i],
+               shm_ptr->daily_tickets_served[i],
+               shm_ptr->daily_users_home[i],
+               shm_ptr->daily_users_no_ticket[i],
+               shm_ptr->daily_users_timeout[i],
+               shm_ptr->daily_users_not_arrived[i]);
+        total_timeout += shm_ptr->daily_users_timeout[i];
+        total_no_ticket += shm_ptr->daily_users_no_ticket[i];
+        total_not_arrived += shm_ptr->daily_users_not_arrived[i];
+    }
+
+    printf("+----------------------+----------------------+----------------------+----------------------+----------------------+----------------------+\n");
+    printf("| Totale               | %-20d | %-20d | %-20d | %-20d | %-20d |\n",
+           daily_users_served,  // Usa il valore giornaliero calcolato
+           shm_ptr->total_users_home,
+           total_no_ticket,
+           total_timeout,
+           total_not_arrived);
+    printf("+----------------------+----------------------+----------------------+----------------------+----------------------+----------------------+\n");
+
+    // Percentili dei tempi della giornata, per servizio e su tutti i servizi
+    LatencyHistogram all_wait, all_service;
+    latency_hist_reset(&all_wait);
+    latency_hist_reset(&all_service);
+
+    printf("\n+----------------------+----------+----------+----------+----------+----------+----------+\n");
+    printf("| PERCENTILI TEMPI GIORNO %-3d (ms)                                                       |\n", shm_ptr->simulation_day);
+    printf("+----------------------+----------+----------+----------+----------+----------+----------+\n");
+    printf("|      Servizio        | Attesa   | Attesa   | Attesa   | Servizio | Servizio | Servizio |\n");
+    printf("|                      | p50      | p95      | p99      | p50      | p95      | p99      |\n");
+    printf("+----------------------+----------+----------+----------+----------+----------+----------+\n");
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        printf("| %-20s |", SERVICE_NAMES[i]);
+        print_percentile_cells(&shm_ptr->daily_wait_hist[i], "%.1f", 1000000.0);
+        print_percentile_cells(&shm_ptr->daily_service_hist[i], "%.1f", 1000000.0);
+        printf("\n");
+        latency_hist_merge(&all_wait, &shm_ptr->daily_wait_hist[i]);
+        latency_hist_merge(&all_service, &shm_ptr->daily_service_hist[i]);
+    }
+    printf("+----------------------+----------+----------+----------+----------+----------+----------+\n");
+    printf("| %-20s |", "Tutti i servizi");
+    print_percentile_cells(&all_wait, "%.1f", 1000000.0);
+    print_percentile_cells(&all_service, "%.1f", 1000000.0);
+    printf("\n");
+    printf("+----------------------+----------+----------+----------+----------+----------+----------+\n");
+}
+
+// Funzione per raccogliere le statistiche di fine giornata
+void collect_daily_statistics(SharedMemory *shm, int day_index) {
+    // Calcola gli utenti serviti SOLO per questo giorno
+    int daily_users_served = 0;
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        daily_users_served += shm->daily_tickets_served[i];
+    }
+    
+    // Raccoglie le statistiche aggregate della giornata
+    SHM_DAY_STATS(shm, day_index)->users_served = daily_users_served;
+    shm->total_users_served_simulation += daily_users_served;  // Aggiunge solo quelli del giorno corrente
+    
+    // Calcola servizi non erogati totali per questa giornata
+    int daily_services_not_provided = 0;
+    int daily_total_wait_count = 0;
+    long daily_total_wait_time = 0;
+    int daily_total_service_count = 0;
+    long daily_total_service_time = 0;
+    
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        // Servizi non erogati = utenti tornati a casa + timeout + no ticket
+        int service_not_provided = shm->daily_users_home[i] + shm->daily_users_timeout[i] + shm->daily_users_no_ticket[i];
+        daily_services_not_provided += service_not_provided;
+        
+        // Raccoglie statistiche per servizio per questo giorno
+        // usa una matrice 2D [servizio][giorno]
+        SHM_DAY_STATS(shm, day_index)->users_served_per_service[i] = shm->daily_tickets_served[i];
+        SHM_DAY_STATS(shm, day_index)->services_not_provided_per_service[i] = service_not_provided;
+        SHM_DAY_STATS(shm, day_index)->total_wait_time_per_service[i] = shm->total_wait_time[i];
+        SHM_DAY_STATS(shm, day_index)->wait_count_per_service[i] = shm->wait_count[i];
+        SHM_DAY_STATS(shm, day_index)->total_service_time_per_service[i] = shm->total_service_time[i];
+        SHM_DAY_STATS(shm, day_index)->service_count_per_service[i] = shm->service_count[i];
+        
+        // Accumula per le statistiche aggregate giornaliere
+        daily_total_wait_count += shm->wait_count[i];
+        daily_total_wait_time += shm->total_wait_time[i];
+        daily_total_service_count += shm->service_count[i];
+        daily_total_service_time += shm->total_service_time[i];
+    }
+    
+    SHM_DAY_STATS(shm, day_index)->services_not_provided = daily_services_not_provided;
+    shm->total_services_not_provided_simulation += daily_services_not_provided;
+    
+    SHM_DAY_STATS(shm, day_index)->total_wait_time = daily_total_wait_time;
+    SHM_DAY_STATS(shm, day_index)->wait_count = daily_total_wait_count;
+    SHM_DAY_STATS(shm, day_index)->total_service_time = daily_total_service_time;
+    SHM_DAY_STATS(shm, day_index)->service_count = daily_total_service_count;
+    
+    // Conta operatori attivi e pause per questo giorno
+    int daily_operators_active = 0;
+    int daily_total_pauses = 0;
+    
+    for (int i = 0; i < NOF_WORKERS; i++) {
+        // Conto le pause degli operatori attivi
+        if (SHM_OPERATORS(shm)[i].active && SHM_OPERATORS(shm)[i].total_served > 0) {
+            daily_operators_active++;
+        }
+        daily_total_pauses += SHM_OPERATORS(shm)[i].total_pauses;
+    }
+    
+    // Calcola le pause SOLO di questo giorno
+    int pauses_for_this_day_only = 0;
+    if (day_index == 0) {
+        // Primo giorno: usa il totale corrente
+        pauses_for_this_day_only = daily_total_pauses;
+    } else {
+        // Giorni successivi: calcola la differenza tra totale corrente e totale simulazione precedente
+        int previous_total = shm->total_pauses_simulation;
+        pauses_for_this_day_only = daily_total_pauses - previous_total;
+        // Assicurati che non sia mai negativo
+        if (pauses_for_this_day_only < 0) {
+            pauses_for_this_day_only = 0;
+        }
+    }
+    
+    SHM_DAY_STATS(shm, day_index)->operators_active = daily_operators_active;
+    SHM_DAY_STATS(shm, day_index)->pauses = pauses_for_this_day_only; // Solo le pause di questo giorno
+    shm->total_pauses_simulation += pauses_for_this_day_only;
+    
+    // Conta operatori attivi per servizio e aggiorna le somme totali
+    for (int service = 0; service < SERVICE_COUNT; service++) {
+        int active_operators_for_service = 0;
+        
+        // Conta gli operatori attivi per questo servizio specifico
+        for (int i = 0; i < NOF_WORKERS; i++) {
+            if (SHM_OPERATORS(shm)[i].active && 
+                (int)SHM_OPERATORS(shm)[i].current_service == service && 
+                SHM_OPERATORS(shm)[i].total_served > 0) {
+                active_operators_for_service++;
+            }
+        }
+        
+        // Somma al totale per questo servizio
+        shm->operators_active_per_service_total[service] += active_operators_for_service;
+    }
+    
+    // Calcola le medie cumulative progressive fino al giorno corrente
+    SHM_DAY_STATS(shm, day_index)->cumulative_avg_users_served = (double)shm->total_users_served_simulation / (day_index + 1);
+    SHM_DAY_STATS(shm, day_index)->cumulative_avg_services_provided = (double)shm->total_services_provided_simulation / (day_index + 1);
+    SHM_DAY_STATS(shm, day_index)->cumulative_avg_services_not_provided = (double)shm->total_services_not_provided_simulation / (day_index + 1);
+    
+}
+
+// Funzione per convertire nanosecondi in minuti simulati
+double nanoseconds_to_simulated_minutes(long nanoseconds) {
+    
+    double real_seconds = nanoseconds / 1000000000.0;
+    
+    // Converte secondi reali in minuti simulati
+    double simulated_minutes = (real_seconds / DAY_SIMULATION_TIME) * WORK_DAY_MINUTES;
+    
+    return simulated_minutes;
+}
+
+// Funzione per stampare la tabella separata dei tempi di servizio
+void print_service_timing_statistics_table(SharedMemory *shm, int days_completed) {
+    printf("\n+----------------------+----------+----------+----------+----------+----------+----------+----------+----------+----------+----------+----------+\n");
+    printf("| STATISTICHE TEMPI DI SERVIZIO                                                                                                                 |\n");
+    printf("+----------------------+----------+----------+----------+----------+----------+----------+----------+----------+----------+----------+----------+\n");
+    printf("|      Servizio        | Tempo    | Tempo    | Tempo    | Tempo    | Minimo   | Minimo   | Massimo  | Massimo  | p50      | p95      | p99      |\n");
+    printf("|                      | Serv.    | Serv.    | Serv.    | Serv.    | Giorno   | Giorno   | Giorno   | Giorno   | Simul.   | Simul.   | Simul.   |\n");
+    printf("|                      | Medio    | Medio    | Medio    | Medio    | (Sec)    | (Min)    | (Sec)    | (Min)    | (Sec)    | (Sec)    | (Sec)    |\n");
+    printf("|                      | Giorno   | Simul.   | Giorno   | Simul.   |          |          |          |          |          |          |          |\n");
+    printf("+----------------------+----------+----------+----------+----------+----------+----------+----------+----------+----------+----------+----------+\n");
+    
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        int total_service_count_service = 0;
+        long total_service_time_service = 0;
+        
+        // Calcola statistiche per tutta la simulazione
+        for (int day = 0; day < SIM_DURATION; day++) {
+            total_service_time_service += SHM_DAY_STATS(shm, day)->total_service_time_per_service[i];
+            total_service_count_service += SHM_DAY_STATS(shm, day)->service_count_per_service[i];
+        }
+        
+        // Calcola la media del tempo di servizio per l'ultimo giorno
+        double avg_service_time_daily = 0;
+        int last_day = days_completed - 1;
+        if (last_day >= 0 && SHM_DAY_STATS(shm, last_day)->service_count_per_service[i] > 0) {
+            avg_service_time_daily = (double)SHM_DAY_STATS(shm, last_day)->total_service_time_per_service[i] / 
+                                   SHM_DAY_STATS(shm, last_day)->service_count_per_service[i] / 1000000000.0;
+        }
+        
+        // Calcola la media del tempo di servizio per tutta la simulazione
+        double avg_service_time_simulation = 0;
+        if (total_service_count_service > 0) {
+            avg_service_time_simulation = (double)total_service_time_service / total_service_count_service / 1000000000.0; // Converti in secondi
+        }
+
+        double min_service_time_sec = shm->min_service_time[i] == LONG_MAX ? 0 : shm->min_service_time[i] / 1000000000.0;
+        double max_service_time_sec = shm->max_service_time[i] / 1000000000.0;
+        
+        // Calcola i tempi in minuti simulati usando la funzione di conversione
+        double avg_service_time_daily_min = 0;
+        double avg_service_time_simulation_min = 0;
+        
+        if (last_day >= 0 && SHM_DAY_STATS(shm, last_day)->service_count_per_service[i] > 0) {
+            long avg_nano_daily = SHM_DAY_STATS(shm, last_day)->total_service_time_per_service[i] / 
+                                 SHM_DAY_STATS(shm, last_day)->service_count_per_service[i];
+            avg_service_time_daily_min = nanoseconds_to_simulated_minutes(avg_nano_daily);
+        }
+        
+        if (total_service_count_service > 0) {
+            long avg_nano_simulation = total_service_time_service / total_service_count_service;
+            avg_service_time_simulation_min = nanoseconds_to_simulated_minutes(avg_nano_simulation);
+        }
+
+        double min_service_time_min = shm->min_service_time[i] == LONG_MAX ? 0 : nanoseconds_to_simulated_minutes(shm->min_service_time[i]);
+        double max_service_time_min = nanoseconds_to_simulated_minutes(shm->max_service_time[i]);
+        
+        // Buffer per formattare i valori
+        char val1[10], val2[10], val3[10], val4[10], val5[10], val6[10], val7[10], val8[10];
+        
+        snprintf(val1, sizeof(val1), avg_service_time_daily > 0 ? "%.3f" : "N/A", avg_service_time_daily);
+        snprintf(val2, sizeof(val2), avg_service_time_simulation > 0 ? "%.3f" : "N/A", avg_service_time_simulation);
+        snprintf(val3, sizeof(val3), avg_service_time_daily_min > 0 ? "%.3f" : "N/A", avg_service_time_daily_min);
+        snprintf(val4, sizeof(val4), avg_service_time_simulation_min > 0 ? "%.3f" : "N/A", avg_service_time_simulation_min);
+        snprintf(val5, sizeof(val5), min_service_time_sec > 0 ? "%.3f" : "N/A", min_service_time_sec);
+        snprintf(val6, sizeof(val6), min_service_time_min > 0 ? "%.3f" : "N/A", min_service_time_min);
+        snprintf(val7, sizeof(val7), max_service_time_sec > 0 ? "%.3f" : "N/A", max_service_time_sec);
+        snprintf(val8, sizeof(val8), max_service_time_min > 0 ? "%.3f" : "N/A", max_service_time_min);
+        
+        printf("| %-20s | %8s | %8s | %8s | %8s | %8s | %8s | %8s | %8s |",
+               SERVICE_NAMES[i], val1, val2, val3, val4, val5, val6, val7, val8);
+        print_percentile_cells(&shm->service_hist[i], "%.3f", 1000000000.0);
+        printf("\n");
+    }
+    
+    printf("+----------------------+----------+----------+----------+----------+----------+----------+----------+----------+----------+----------+----------+\n");
+}
+
+// Funzione per stampare le statistiche complete finali
+void print_comprehensive_statistics(SharedMemory *shm, int days_completed) {
+    printf("\n");
+    printf("================================================================================\n");
+    printf("                     STATISTICHE DETTAGLIATE DELLA SIMULAZIONE\n");
+    printf("================================================================================\n");
+    
+    // Calcoli preliminari
+    int total_operators_active = 0;
+    long total_wait_time_simulation = 0;
+    int total_wait_count_simulation = 0;
+    long total_service_time_simulation = 0;
+    int total_service_count_simulation = 0;
+    
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        total_wait_time_simulation += shm->total_wait_time[i];
+        total_wait_count_simulation += shm->wait_count[i];
+        total_service_time_simulation += shm->total_service_time[i];
+        total_service_count_simulation += shm->service_count[i];
+    }
+    
+    for (int i = 0; i < NOF_WORKERS; i++) {
+        if (SHM_OPERATORS(shm)[i].total_served > 0) {
+            total_operators_active++;
+        }
+    }
+    
+    double avg_operators_per_day = 0;
+    for (int day = 0; day < days_completed; day++) {
+        avg_operators_per_day += SHM_DAY_STATS(shm, day)->operators_active;
+    }
+    if (days_completed > 0) {
+        avg_operators_per_day /= days_completed;
+    }
+    
+    // TABELLA 1: RAPPORTO OPERATORI/SPORTELLI PER SERVIZIO (ultima giornata)
+    printf("\n+----------------------+--------------------+--------------------+--------------------+--------------------+--------------------+\n");
+    printf("| RAPPORTO OPERATORI/SPORTELLI PER SERVIZIO (ultima giornata)                                                               |\n");
+    printf("+----------------------+--------------------+--------------------+--------------------+--------------------+--------------------+\n");
+    printf("|      Servizio        |     Sportelli      |     Operatori      |      Rapporto      |   Op. Attivi       |   Op. Attivi       |\n");
+    printf("|                      |                    |                    |                    |   Ultimo Giorno    |   Tutti i Giorni   |\n");
+    printf("+----------------------+--------------------+--------------------+--------------------+--------------------+--------------------+\n");
+    
+    // Calcola statistiche generali degli operatori
+    int total_operators_active_last_day = 0;
+    int total_operators_active_simulation = 0;
+    int total_pauses_last_day = 0;
+    int total_pauses_simulation = 0;
+    
+    if (days_completed > 0) {
+        total_operators_active_last_day = SHM_DAY_STATS(shm, days_completed - 1)->operators_active;
+        // Le pause dell'ultimo giorno sono già calcolate correttamente come differenziali
+        total_pauses_last_day = SHM_DAY_STATS(shm, days_completed - 1)->pauses;
+    }
+    
+    // Calcola totale operatori attivi e pause in tutta la simulazione
+    for (int day = 0; day < days_completed; day++) {
+        total_operators_active_simulation += SHM_DAY_STATS(shm, day)->operators_active;
+        total_pauses_simulation += SHM_DAY_STATS(shm, day)->pauses;
+    }
+    
+    for (int service = 0; service < SERVICE_COUNT; service++) {
+        // Array per memorizzare gli sportelli e operatori per questo servizio
+        int *counters_for_service = malloc(NOF_WORKER_SEATS * sizeof(int));
+        int *operators_for_service = malloc(NOF_WORKERS * sizeof(int));
+        int counter_count = 0;
+        int operator_count = 0;
+        int active_operators_for_service_last_day = 0;
+        int active_operators_for_service_all_days = 0;
+        
+        // Trova tutti gli sportelli assegnati a questo servizio per la giornata corrente
+        for (int i = 0; i < NOF_WORKER_SEATS; i++) {
+            if (SHM_COUNTERS(shm)[i].active && (int)SHM_COUNTERS(shm)[i].current_service == service) {
+                counters_for_service[counter_count++] = i;
+            }
+        }
+        
+        // Trova tutti gli operatori che hanno questo servizio come servizio fisso
+        for (int i = 0; i < NOF_WORKERS; i++) {
+            if (SHM_OPERATORS(shm)[i].active && (int)SHM_OPERATORS(shm)[i].current_service == service) {
+                operators_for_service[operator_count++] = i;
+                // Conta quelli che hanno effettivamente servito utenti nell'ultimo giorno
+                if (SHM_OPERATORS(shm)[i].total_served > 0) {
+                    active_operators_for_service_last_day++;
+                }
+            }
+        }
+        
+        // Calcola operatori attivi per questo servizio da tutta la simulazione
+        active_operators_for_service_all_days = shm->operators_active_per_service_total[service];
+        
+        // Crea stringhe per sportelli e operatori
+        char counters_str[200] = "";
+        char operators_str[200] = "";
+        
+        // Formatta la lista degli sportelli
+        for (int i = 0; i < counter_count; i++) {
+            char temp[10];
+            snprintf(temp, sizeof(temp), "%d", counters_for_service[i]);
+            if (strlen(counters_str) + strlen(temp) < sizeof(counters_str) - 1) strncat(counters_str, temp, sizeof(counters_str) - strlen(counters_str) - 1);
+            if (i < counter_count - 1 && strlen(counters_str) + 2 < sizeof(counters_str)) strncat(counters_str, ",", sizeof(counters_str) - strlen(counters_str) - 1);
+        }
+        if (counter_count == 0) strncpy(counters_str, "Nessuno", sizeof(counters_str) - 1);
+        counters_str[sizeof(counters_str) - 1] = '\0';
+        
+        // Formatta la lista degli operatori
+        for (int i = 0; i < operator_count; i++) {
+            char temp[10];
+            snprintf(temp, sizeof(temp), "%d", operators_for_service[i]);
+            if (strlen(operators_str) + strlen(temp) < sizeof(operators_str) - 1) strncat(operators_str, temp, sizeof(operators_str) - strlen(operators_str) - 1);
+            if (i < operator_count - 1 && strlen(operators_str) + 2 < sizeof(operators_str)) strncat(operators_str, ",", sizeof(operators_str) - strlen(operators_str) - 1);
+        }
+        if (operator_count == 0) strncpy(operators_str, "Nessuno", sizeof(operators_str) - 1);
+        operators_str[sizeof(operators_str) - 1] = '\0';
+        
+        // Calcola il rapporto
+        double ratio = counter_count > 0 ? (double)operator_count / counter_count : 0.0;
+        
+        printf("| %-20s | %-18s | %-18s | %18.2f | %18d | %18d |\n",
+               SERVICE_NAMES[service], 
+               counters_str,
+               operators_str,
+               ratio,
+               active_operators_for_service_last_day,
+               active_operators_for_service_all_days);
+        
+        free(counters_for_service);
+        free(operators_for_service);
+    }
+    printf("+----------------------+--------------------+--------------------+--------------------+--------------------+--------------------+\n");
+    
+    // Riga separata per le pause totali
+    printf("| %-20s | %-18s | %-18s | %18s | %18d | %18d |\n",
+           "PAUSE TOTALI", 
+           "-",
+           "-", 
+           "-",
+           total_pauses_last_day,
+           total_pauses_simulation);
+    printf("+----------------------+--------------------+--------------------+--------------------+--------------------+--------------------+\n");
+    
+    // TABELLA 2: STATISTICHE GENERALI OPERATORI E PAUSE
+    printf("\n+--------------------------------+--------------------+--------------------+--------------------+\n");
+    printf("| STATISTICHE OPERATORI E PAUSE                                                              |\n");
+    printf("+--------------------------------+--------------------+--------------------+--------------------+\n");
+    printf("| Descrizione                    | Ultimo Giorno      | Totale Simulazione | Media al Giorno    |\n");
+    printf("+--------------------------------+--------------------+--------------------+--------------------+\n");
+    printf("| Operatori Attivi               | %-18d | %-18d | %-18.2f |\n", 
+           total_operators_active_last_day, total_operators_active_simulation,
+           days_completed > 0 ? (double)total_operators_active_simulation / days_completed : 0.0);
+    printf("| Pause Totali                   | %-18d | %-18d | %-18.2f |\n", 
+           total_pauses_last_day, total_pauses_simulation,
+           days_completed > 0 ? (double)total_pauses_simulation / days_completed : 0.0);
+    printf("| Media Pause per Operatore      | %-18.2f | %-18.2f | %-18.2f |\n", 
+           total_operators_active_last_day > 0 ? (double)total_pauses_last_day / total_operators_active_last_day : 0.0,
+           total_operators_active_simulation > 0 ? (double)total_pauses_simulation / total_operators_active_simulation : 0.0,
+           days_completed > 0 && total_operators_active_simulation > 0 ? (double)total_pauses_simulation / days_completed / (total_operators_active_simulation / days_completed) : 0.0);
+    if (REBALANCE_INTERVAL > 0) {
+        printf("| Sportelli Riassegnati          | %-18d | %-18d | %-18.2f |\n",
+               shm->daily_counter_moves, shm->total_counter_moves,
+               days_completed > 0 ? (double)shm->total_counter_moves / days_completed : 0.0);
+    }
+    printf("+--------------------------------+--------------------+--------------------+--------------------+\n");
+
+    // TABELLA 2b: RISVEGLI DEGLI OPERATORI (solo se la variante in uso li registra)
+    int total_wakeups = 0;
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        total_wakeups += shm->ticketing[i].total_operator_wakeups;
+    }
+    if (total_wakeups > 0) {
+        printf("\n+----------------------+--------------------+--------------------+--------------------+--------------------+\n");
+        printf("| RISVEGLI OPERATORI                                                                                       |\n");
+        printf("+----------------------+--------------------+--------------------+--------------------+--------------------+\n");
+        printf("|      Servizio        | Risvegli Giorno    | A Vuoto Giorno     | Risvegli Totali    | A Vuoto Totali     |\n");
+        printf("+----------------------+--------------------+--------------------+--------------------+--------------------+\n");
+        int daily_wakeups_sum = 0, daily_spurious_sum = 0, total_spurious_sum = 0;
+        for (int i = 0; i < SERVICE_COUNT; i++) {
+            printf("| %-20s | %-18d | %-18d | %-18d | %-18d |\n",
+                   SERVICE_NAMES[i],
+                   shm->ticketing[i].daily_operator_wakeups, shm->daily_spurious_wakeups[i],
+                   shm->ticketing[i].total_operator_wakeups, shm->total_spurious_wakeups[i]);
+            daily_wakeups_sum += shm->ticketing[i].daily_operator_wakeups;
+            daily_spurious_sum += shm->daily_spurious_wakeups[i];
+            total_spurious_sum += shm->total_spurious_wakeups[i];
+        }
+        printf("+----------------------+--------------------+--------------------+--------------------+--------------------+\n");
+        printf("| %-20s | %-18d | %-18d | %-18d | %-18d |\n",
+               "Totale", daily_wakeups_sum, daily_spurious_sum, total_wakeups, total_spurious_sum);
+        printf("+----------------------+--------------------+--------------------+--------------------+--------------------+\n");
+    }
+
+    // TABELLA 2c: TICKET RUBATI (solo con operatori multi-competenza)
+    // Le percentuali confrontano i rubati con i serviti dello stesso periodo:
+    // la giornata (service_count) o tutte le giornate concluse
+    if (OPERATOR_SKILLS > 1) {
+        printf("\n+----------------------+--------------------+--------------------+--------------------+--------------------+\n");
+        printf("| TICKET RUBATI DA OPERATORI DI ALTRI SERVIZI                                                              |\n");
+        printf("+----------------------+--------------------+--------------------+--------------------+--------------------+\n");
+        printf("|      Servizio        | Rubati Giorno      | %% Serviti Giorno   | Rubati Totali      | %% Serviti Totali   |\n");
+        printf("+----------------------+--------------------+--------------------+--------------------+--------------------+\n");
+        int daily_stolen_sum = 0, daily_served_sum = 0, total_stolen_sum = 0, total_served_sum = 0;
+        for (int i = 0; i < SERVICE_COUNT; i++) {
+            int served_total = 0;
+            for (int day = 0; day < days_completed; day++) {
+                served_total += SHM_DAY_STATS(shm, day)->service_count_per_service[i];
+            }
+            printf("| %-20s | %-18d | %-18.1f | %-18d | %-18.1f |\n",
+                   SERVICE_NAMES[i],
+                   shm->daily_tickets_stolen[i],
+                   shm->service_count[i] > 0 ? 100.0 * shm->daily_tickets_stolen[i] / shm->service_count[i] : 0.0,
+                   shm->total_tickets_stolen[i],
+                   served_total > 0 ? 100.0 * shm->total_tickets_stolen[i] / served_total : 0.0);
+            daily_stolen_sum += shm->daily_tickets_stolen[i];
+            daily_served_sum += shm->service_count[i];
+            total_stolen_sum += shm->total_tickets_stolen[i];
+            total_served_sum += served_total;
+        }
+        printf("+----------------------+--------------------+--------------------+--------------------+--------------------+\n");
+        printf("| %-20s | %-18d | %-18.1f | %-18d | %-18.1f |\n",
+               "Totale",
+               daily_stolen_sum, daily_served_sum > 0 ? 100.0 * daily_stolen_sum / daily_served_sum : 0.0,
+               total_stolen_sum, total_served_sum > 0 ? 100.0 * total_stolen_sum / total_served_sum : 0.0);
+        printf("+----------------------+--------------------+--------------------+--------------------+--------------------+\n");
+    }
+    
+    // TABELLA 3: STATISTICHE TEMPI DI ATTESA
+    printf("\n+----------------------+----------+----------+----------+----------+----------+----------+\n");
+    printf("| STATISTICHE TEMPI DI ATTESA (TOTALI SIMULAZIONE)                                      |\n");
+    printf("+----------------------+----------+----------+----------+----------+----------+----------+\n");
+    printf("|      Servizio        | Tempo    | Tempo    | Tempo    | Tempo    | Tempo    | Tempo    |\n");
+    printf("|                      | Min      | Min      | Max      | Max      | Medio    | Medio    |\n");
+    printf("|                      | (ms)     | (minuti) | (ms)     | (minuti) | (ms)     | (minuti) |\n");
+    printf("+----------------------+----------+----------+----------+----------+----------+----------+\n");
+    
+    long overall_min_wait = LONG_MAX;
+    long overall_max_wait = 0;
+    long total_wait_time_all = 0;
+    int total_wait_count_all = 0;
+    
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        if (shm->wait_count[i] > 0) {
+            double min_ms = shm->min_wait_time[i] / 1000000.0;
+            double max_ms = shm->max_wait_time[i] / 1000000.0;
+            double avg_ms = (shm->total_wait_time[i] / 1000000.0) / shm->wait_count[i];
+            
+            // Converti in minuti simulati
+            double min_min = nanoseconds_to_simulated_minutes(shm->min_wait_time[i]);
+            double max_min = nanoseconds_to_simulated_minutes(shm->max_wait_time[i]);
+            double avg_min = nanoseconds_to_simulated_minutes(shm->total_wait_time[i] / shm->wait_count[i]);
+            
+            printf("| %-20s | %8.1f | %8.3f | %8.1f | %8.3f | %8.1f | %8.3f |\n",
+                   SERVICE_NAMES[i],
+                   min_ms, min_min,
+                   max_ms, max_min,
+                   avg_ms, avg_min);
+            
+            total_wait_time_all += shm->total_wait_time[i];
+            total_wait_count_all += shm->wait_count[i];
+            
+            if (shm->min_wait_time[i] < overall_min_wait) {
+                overall_min_wait = shm->min_wait_time[i];
+            }
+            if (shm->max_wait_time[i] > overall_max_wait) {
+                overall_max_wait = shm->max_wait_time[i];
+            }
+        } else {
+            printf("| %-20s | %8s | %8s | %8s | %8s | %8s | %8s |\n",
+                   SERVICE_NAMES[i], "N/A", "N/A", "N/A", "N/A", "N/A", "N/A");
+        }
+    }
+    
+    printf("+----------------------+----------+----------+----------+----------+----------+----------+\n");
+    
+    // Calculate simulation-wide average for the "Media" row
+    long simulation_total_wait_time = 0;
+    int simulation_total_wait_count = 0;
+    
+    for (int day = 0; day < shm->simulation_day; day++) {
+        if (SHM_DAY_STATS(shm, day)->wait_count > 0) {
+            simulation_total_wait_time += SHM_DAY_STATS(shm, day)->total_wait_time;
+            simulation_total_wait_count += SHM_DAY_STATS(shm, day)->wait_count;
+        }
+    }
+    
+    if (simulation_total_wait_count > 0) {
+        // Media calcolata su TUTTI gli utenti serviti di tutta la simulazione
+        double simulation_avg_ms = (simulation_total_wait_time / 1000000.0) / simulation_total_wait_count;
+        double simulation_avg_min = nanoseconds_to_simulated_minutes(simulation_total_wait_time / simulation_total_wait_count);
+        
+        printf("| Media                | %8s | %8s | %8s | %8s | %8.1f | %8.3f |\n",
+               "-", "-", "-", "-", simulation_avg_ms, simulation_avg_min);
+    } else {
+        printf("| Media                | %8s | %8s | %8s | %8s | %8s | %8s |\n",
+               "N/A", "N/A", "N/A", "N/A", "N/A", "N/A");
+    }
+    printf("+----------------------+----------+----------+----------+----------+----------+----------+\n");
+
+    // TABELLA 3b: PERCENTILI DEI TEMPI DI ATTESA SULL'INTERA SIMULAZIONE.
+    // Minimo e massimo qui sopra ripartono ogni giorno, gli istogrammi della
+    // simulazione (latency_hist.h) no: stanno in una tabella a parte
+    LatencyHistogram all_wait;
+    latency_hist_reset(&all_wait);
+
+    printf("\n+----------------------+----------+----------+----------+\n");
+    printf("| PERCENTILI ATTESA SIMULAZIONE (ms)                    |\n");
+    printf("+----------------------+----------+----------+----------+\n");
+    printf("|      Servizio        | p50      | p95      | p99      |\n");
+    printf("+----------------------+----------+----------+----------+\n");
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        printf("| %-20s |", SERVICE_NAMES[i]);
+        print_percentile_cells(&shm->wait_hist[i], "%.1f", 1000000.0);
+        printf("\n");
+        latency_hist_merge(&all_wait, &shm->wait_hist[i]);
+    }
+    printf("+----------------------+----------+----------+----------+\n");
+    printf("| %-20s |", "Tutti i servizi");
+    print_percentile_cells(&all_wait, "%.1f", 1000000.0);
+    printf("\n");
+    printf("+----------------------+----------+----------+----------+\n");
+    
+    printf("\n");
+    printf("================================================================================\n");
+}
+
+// Funzione per inizializzare le variabili statistiche
+void initialize_statistics(SharedMemory *shm) {
+    // Registri statistici vuoti per tutti gli operatori
+    operator_stats_init(shm);
+
+    // Inizializza le variabili per la simulazione (attesa)
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        shm->min_wait_time[i] = LONG_MAX;
+        shm->max_wait_time[i] = 0;
+        shm->total_wait_time[i] = 0;
+        shm->wait_count[i] = 0;
+        
+        // Inizializza anche le statistiche tempi (servizio)
+        shm->min_service_time[i] = LONG_MAX;
+        shm->max_service_time[i] = 0;
+        shm->total_service_time[i] = 0;
+        shm->service_count[i] = 0;
+
+        // Distribuzioni dei tempi vuote (latency_hist.h)
+        latency_hist_reset(&shm->daily_wait_hist[i]);
+        latency_hist_reset(&shm->daily_service_hist[i]);
+        latency_hist_reset(&shm->wait_hist[i]);
+        latency_hist_reset(&shm->service_hist[i]);
+        
+        // Inizializza gli array delle statistiche giornaliere
+        for (int day = 0; day < SIM_DURATION; day++) {
+            SHM_DAY_STATS(shm, day)->users_served_per_service[i] = 0;
+            SHM_DAY_STATS(shm, day)->services_not_provided_per_service[i] = 0;
+            SHM_DAY_STATS(shm, day)->total_wait_time_per_service[i] = 0;
+            SHM_DAY_STATS(shm, day)->wait_count_per_service[i] = 0;
+            SHM_DAY_STATS(shm, day)->total_service_time_per_service[i] = 0;
+            SHM_DAY_STATS(shm, day)->service_count_per_service[i] = 0;
+        }
+    }
+    
+    // Inizializza le statistiche aggregate per la simulazione
+    shm->total_users_served_simulation = 0;
+    shm->total_services_provided_simulation = 0;
+    shm->total_services_not_provided_simulation = 0;
+    shm->total_pauses_simulation = 0;
+    shm->daily_counter_moves = 0;
+    shm->total_counter_moves = 0;
+    shm->total_users_not_arrived = 0;
+    
+    // Inizializza le somme totali degli operatori attivi per servizio
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        shm->operators_active_per_service_total[i] = 0;
+        shm->total_users_not_arrived_per_service[i] = 0;
+    }
+    
+    // Inizializza gli array delle statistiche giornaliere aggregate
+    for (int day = 0; day < SIM_DURATION; day++) {
+        SHM_DAY_STATS(shm, day)->users_served = 0;
+        SHM_DAY_STATS(shm, day)->services_not_provided = 0;
+        SHM_DAY_STATS(shm, day)->total_wait_time = 0;
+        SHM_DAY_STATS(shm, day)->wait_count = 0;
+        SHM_DAY_STATS(shm, day)->total_service_time = 0;
+        SHM_DAY_STATS(shm, day)->service_count = 0;
+        SHM_DAY_STATS(shm, day)->pauses = 0;
+        SHM_DAY_STATS(shm, day)->operators_active = 0;
+        
+        // Inizializza le medie cumulative
+        SHM_DAY_STATS(shm, day)->cumulative_avg_users_served = 0.0;
+        SHM_DAY_STATS(shm, day)->cumulative_avg_services_provided = 0.0;
+        SHM_DAY_STATS(shm, day)->cumulative_avg_services_not_provided = 0.0;
+    }
+}
+
+// Resetta contatori e statistiche giornaliere per il giorno successivo
+void reset_daily_statistics(SharedMemory *shm) {
+    // Resetta i contatori giornalieri
+    memset(shm->daily_tickets_served, 0, sizeof(int) * SERVICE_COUNT);
+    memset(shm->daily_users_home, 0, sizeof(int) * SERVICE_COUNT);
+    memset(shm->daily_users_timeout, 0, sizeof(int) * SERVICE_COUNT);
+    memset(shm->daily_users_no_ticket, 0, sizeof(int) * SERVICE_COUNT);
+    memset(shm->daily_users_not_arrived, 0, sizeof(int) * SERVICE_COUNT);
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        shm->ticketing[i].daily_issued = 0;
+        atomic_store(&shm->ticketing[i].daily_operator_wakeups, 0);
+        atomic_store(&shm->daily_spurious_wakeups[i], 0);
+        shm->daily_tickets_stolen[i] = 0;
+        latency_hist_reset(&shm->daily_wait_hist[i]);
+        latency_hist_reset(&shm->daily_service_hist[i]);
+    }
+    shm->daily_counter_moves = 0;
+    shm->total_tickets_served = 0;
+    shm->total_users_home = 0;
+    shm->total_users_timeout = 0;
+    shm->total_users_no_ticket = 0;
+    // NON resettiamo shm->total_users_not_arrived e shm->total_users_not_arrived_per_service perché sono cumulativi
+    
+    // Resetta le statistiche sui tempi di attesa
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        shm->min_wait_time[i] = LONG_MAX; // Valore massimo possibile
+        shm->max_wait_time[i] = 0;
+        shm->total_wait_time[i] = 0;
+        shm->wait_count[i] = 0;
+        
+        // Resetta anche le statistiche giornaliere sui tempi di attesa
+        shm->daily_total_wait_time[i] = 0;
+        shm->daily_wait_count[i] = 0;
+        
+        // Resetta anche le statistiche sui tempi di servizio
+        shm->min_service_time[i] = LONG_MAX;
+        shm->max_service_time[i] = 0;
+        shm->total_service_time[i] = 0;
+        shm->service_count[i] = 0;
+        
+        // Azzera anche i contatori giornalieri
+        shm->daily_users_timeout[i] = 0;
+        shm->daily_users_not_arrived[i] = 0;
+    }
+    shm->total_users_timeout = 0;
+    // NON resettiamo shm->total_users_not_arrived perché è cumulativo
+    
+    // Resetta anche le statistiche aggregate sui tempi di attesa
+    shm->daily_total_wait_time_all = 0;
+    shm->daily_wait_count_all = 0;
+    
+    // Reset anche dei numeri dei ticket per il giorno successivo (qui e non
+    // nei processi ticket, che a inizio giornata potrebbero già ricevere richieste)
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        shm->ticketing[i].next_ticket = 1;
+    }
+}
+
+#endif // STATISTICS_H
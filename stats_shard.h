@@ -0,0 +1,188 @@
+#ifndef STATS_SHARD_H
+#define STATS_SHARD_H
+
+#include <limits.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "config.h"
+#include "shm_layout.h"
+
+// Statistiche di servizio per operatore. Ogni operatore scrive i propri
+// servizi completati in un registro tutto suo (OperatorStatsShard, allineato
+// alla linea di cache), senza stats_lock: nessun altro processo ci scrive e due
+// operatori non condividono linee di cache. Il registro porta la giornata
+// (day_epoch) a cui si riferisce e viene azzerato dall'operatore stesso al
+// primo servizio di una nuova giornata. A fine giornata il direttore unisce
+// i registri della giornata nei totali della memoria condivisa
+// (merge_operator_stats()); un contatore di sequenza (seqlock) gli evita di
+// leggere un registro a metà aggiornamento.
+// Le distribuzioni dei tempi (latency_hist.h) sono invece per servizio e
+// condivise tra gli operatori: un registro per operatore costerebbe qualche
+// KB a testa, e un incremento atomico per servizio completato basta.
+
+#define STATS_SHARD_READ_RETRIES 1000
+
+void operator_stats_init(SharedMemory *shm);
+void record_completed_service(SharedMemory *shm, int op_id, int service, long wait_time_ns, long service_time_ns);
+int operator_stats_served(SharedMemory *shm, int service);
+void merge_operator_stats(SharedMemory *shm);
+
+// Implementazione delle funzioni
+
+// Azzera il registro per una nuova giornata (chiamata dal proprietario)
+void stats_shard_reset(OperatorStatsShard *shard, unsigned int epoch)
+{
+    shard->epoch = epoch;
+    memset(shard->served, 0, sizeof(shard->served));
+    memset(shard->stolen, 0, sizeof(shard->stolen));
+    memset(shard->service_time_total, 0, sizeof(shard->service_time_total));
+    memset(shard->wait_time_total, 0, sizeof(shard->wait_time_total));
+    memset(shard->service_time_max, 0, sizeof(shard->service_time_max));
+    memset(shard->wait_time_max, 0, sizeof(shard->wait_time_max));
+    for (int service = 0; service < SERVICE_COUNT; service++) {
+        shard->service_time_min[service] = LONG_MAX;
+        shard->wait_time_min[service] = LONG_MAX;
+    }
+}
+
+// Registri vuoti per la giornata corrente (all'avvio della simulazione)
+void operator_stats_init(SharedMemory *shm)
+{
+    unsigned int epoch = atomic_load_explicit(&shm->day_epoch, memory_order_relaxed);
+    for (int op_id = 0; op_id < shm->worker_capacity; op_id++) {
+        atomic_store_explicit(&SHM_STATS_SHARDS(shm)[op_id].seq, 0, memory_order_relaxed);
+        stats_shard_reset(&SHM_STATS_SHARDS(shm)[op_id], epoch);
+    }
+}
+
+// Registra un servizio completato nel registro dell'operatore. Un ticket di
+// un servizio diverso da quello dell'operatore è stato rubato (OPERATOR_SKILLS)
+void record_completed_service(SharedMemory *shm, int op_id, int service, long wait_time_ns, long service_time_ns)
+{
+    OperatorStatsShard *shard = &SHM_STATS_SHARDS(shm)[op_id];
+    unsigned int epoch = atomic_load_explicit(&shm->day_epoch, memory_order_acquire);
+    unsigned int seq = atomic_load_explicit(&shard->seq, memory_order_relaxed);
+
+    // Sequenza dispari: aggiornamento in corso
+    atomic_store_explicit(&shard->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    if (shard->epoch != epoch) {
+        stats_shard_reset(shard, epoch);
+    }
+    shard->served[service]++;
+    shard->service_time_total[service] += service_time_ns;
+    if (service_time_ns < shard->service_time_min[service]) {
+        shard->service_time_min[service] = service_time_ns;
+    }
+    if (service_time_ns > shard->service_time_max[service]) {
+        shard->service_time_max[service] = service_time_ns;
+    }
+    shard->wait_time_total[service] += wait_time_ns;
+    if (wait_time_ns < shard->wait_time_min[service]) {
+        shard->wait_time_min[service] = wait_time_ns;
+    }
+    if (wait_time_ns > shard->wait_time_max[service]) {
+        shard->wait_time_max[service] = wait_time_ns;
+    }
+    if (service != (int)SHM_OPERATORS(shm)[op_id].current_service) {
+        shard->stolen[service]++;
+    }
+
+    atomic_store_explicit(&shard->seq, seq + 2, memory_order_release);
+    SHM_OPERATORS(shm)[op_id].total_served++;
+
+    latency_hist_record(&shm->daily_wait_hist[service], wait_time_ns);
+    latency_hist_record(&shm->daily_service_hist[service], service_time_ns);
+}
+
+// Copia coerente di un registro. Se il proprietario resta a metà
+// aggiornamento (processo terminato) dopo alcuni tentativi si usa l'ultima copia
+void stats_shard_read(OperatorStatsShard *shard, OperatorStatsShard *copy)
+{
+    for (int attempt = 0; attempt < STATS_SHARD_READ_RETRIES; attempt++) {
+        unsigned int before = atomic_load_explicit(&shard->seq, memory_order_acquire);
+        memcpy(copy, shard, sizeof(*copy));
+        atomic_thread_fence(memory_order_acquire);
+        unsigned int after = atomic_load_explicit(&shard->seq, memory_order_relaxed);
+        if (before == after && (before & 1) == 0) {
+            return;
+        }
+    }
+}
+
+// Ticket del servizio serviti finora nella giornata (lettura a giornata in
+// corso, es. ribilanciamento degli sportelli: un valore approssimato basta)
+int operator_stats_served(SharedMemory *shm, int service)
+{
+    unsigned int epoch = atomic_load_explicit(&shm->day_epoch, memory_order_acquire);
+    int served = 0;
+
+    for (int op_id = 0; op_id < shm->worker_capacity; op_id++) {
+        OperatorStatsShard *shard = &SHM_STATS_SHARDS(shm)[op_id];
+        if (shard->epoch == epoch) {
+            served += shard->served[service];
+        }
+    }
+    return served;
+}
+
+// Unisce i registri della giornata nei totali giornalieri e della
+// simulazione. Va chiamata una volta a fine giornata, prima di contare i
+// ticket non serviti e prima che day_epoch avanzi
+void merge_operator_stats(SharedMemory *shm)
+{
+    unsigned int epoch = atomic_load_explicit(&shm->day_epoch, memory_order_acquire);
+    OperatorStatsShard shard;
+
+    for (int op_id = 0; op_id < shm->worker_capacity; op_id++) {
+        stats_shard_read(&SHM_STATS_SHARDS(shm)[op_id], &shard);
+        if (shard.epoch != epoch) {
+            continue; // Nessun servizio completato nella giornata
+        }
+
+        for (int service = 0; service < SERVICE_COUNT; service++) {
+            int served = shard.served[service];
+            if (served == 0) {
+                continue;
+            }
+
+            shm->daily_tickets_served[service] += served;
+            shm->total_tickets_served += served;
+            shm->total_services_provided_simulation += served;
+            shm->daily_tickets_stolen[service] += shard.stolen[service];
+            shm->total_tickets_stolen[service] += shard.stolen[service];
+
+            if (shard.service_time_min[service] < shm->min_service_time[service]) {
+                shm->min_service_time[service] = shard.service_time_min[service];
+            }
+            if (shard.service_time_max[service] > shm->max_service_time[service]) {
+                shm->max_service_time[service] = shard.service_time_max[service];
+            }
+            shm->total_service_time[service] += shard.service_time_total[service];
+            shm->service_count[service] += served;
+
+            if (shm->wait_count[service] == 0 || shard.wait_time_min[service] < shm->min_wait_time[service]) {
+                shm->min_wait_time[service] = shard.wait_time_min[service];
+            }
+            if (shard.wait_time_max[service] > shm->max_wait_time[service]) {
+                shm->max_wait_time[service] = shard.wait_time_max[service];
+            }
+            shm->total_wait_time[service] += shard.wait_time_total[service];
+            shm->wait_count[service] += served;
+            shm->daily_total_wait_time[service] += shard.wait_time_total[service];
+            shm->daily_wait_count[service] += served;
+            shm->total_wait_time_all_services += shard.wait_time_total[service];
+            shm->total_wait_count_all_services += served;
+            shm->daily_total_wait_time_all += shard.wait_time_total[service];
+            shm->daily_wait_count_all += served;
+        }
+    }
+
+    for (int service = 0; service < SERVICE_COUNT; service++) {
+        latency_hist_merge(&shm->wait_hist[service], &shm->daily_wait_hist[service]);
+        latency_hist_merge(&shm->service_hist[service], &shm->daily_service_hist[service]);
+    }
+}
+
+#endif // STATS_SHARD_H
@@ -0,0 +1,102 @@
+#ifndef SUBMIT_QUEUE_H
+#define SUBMIT_QUEUE_H
+
+#include <stdatomic.h>
+#include "ticket_ring.h"
+#include "futex_ops.h"
+
+// Coda di invio delle richieste di ticket: molti produttori (gli utenti) e un
+// solo consumatore (il processo ticket). Il dato viaggia in un ring lock-free
+// in memoria condivisa, quindi niente copia attraverso il kernel. La
+// pubblicazione è la store con rilascio della sequenza della cella: quando il
+// consumatore estrae l'indice, la richiesta scritta prima è già visibile.
+// Il consumatore dorme con FUTEX_WAIT su un eventcount e si dichiara in
+// attesa: i produttori fanno la chiamata di sistema solo in quel caso, durante
+// un picco di arrivi accodano senza entrare nel kernel.
+
+typedef struct {
+    TicketRing ring;            // Posizioni (celle in una regione separata)
+    atomic_uint wakeup_seq CACHE_ALIGNED; // Eventcount su cui dorme il consumatore
+    atomic_int consumer_waiting; // 1 mentre il consumatore sta per dormire o dorme
+} SubmitQueue;
+
+void submit_queue_init(SubmitQueue *queue, RingCell *cells, unsigned long capacity);
+int submit_queue_push(SubmitQueue *queue, RingCell *cells, int value);
+int submit_queue_drain(SubmitQueue *queue, RingCell *cells, int *values, int max);
+void submit_queue_wait(SubmitQueue *queue, volatile int *keep_waiting);
+void submit_queue_wait_either(SubmitQueue *queue, volatile int *keep_waiting,
+                              atomic_uint *other_word, unsigned int other_seen);
+void submit_queue_wakeup(SubmitQueue *queue);
+
+// Implementazione delle funzioni
+
+// Svuota la coda. Da chiamare solo quando nessuno la sta usando
+void submit_queue_init(SubmitQueue *queue, RingCell *cells, unsigned long capacity)
+{
+    ring_init(&queue->ring, cells, capacity);
+    atomic_store_explicit(&queue->consumer_waiting, 0, memory_order_release);
+}
+
+// Accoda un valore e sveglia il consumatore se sta dormendo.
+// Ritorna 1 se accodato, 0 se la coda è piena
+int submit_queue_push(SubmitQueue *queue, RingCell *cells, int value)
+{
+    if (!ring_push(&queue->ring, cells, value)) {
+        return 0;
+    }
+    // Il push deve essere visibile prima di leggere consumer_waiting (vedi
+    // submit_queue_wait): o il consumatore vede il valore, o noi vediamo lui
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&queue->consumer_waiting, memory_order_relaxed)) {
+        submit_queue_wakeup(queue);
+    }
+    return 1;
+}
+
+// Estrae senza bloccarsi fino a max valori. Ritorna quanti ne ha estratti
+int submit_queue_drain(SubmitQueue *queue, RingCell *cells, int *values, int max)
+{
+    int count = 0;
+    while (count < max && ring_pop(&queue->ring, cells, &values[count])) {
+        count++;
+    }
+    return count;
+}
+
+// Dorme finché la coda è vuota. Ritorna dopo un push, un
+// submit_queue_wakeup() o un segnale; non dorme se *keep_waiting è 0
+void submit_queue_wait(SubmitQueue *queue, volatile int *keep_waiting)
+{
+    submit_queue_wait_either(queue, keep_waiting, NULL, 0);
+}
+
+// Come submit_queue_wait(), ma si sveglia anche quando other_word smette di
+// valere other_seen (per il processo ticket: la chiusura della giornata)
+void submit_queue_wait_either(SubmitQueue *queue, volatile int *keep_waiting,
+                              atomic_uint *other_word, unsigned int other_seen)
+{
+    // La sequenza va letta prima di ricontrollare la coda: un risveglio
+    // arrivato dopo questa lettura fa fallire FUTEX_WAIT con EAGAIN
+    unsigned int seen = atomic_load_explicit(&queue->wakeup_seq, memory_order_acquire);
+    atomic_store_explicit(&queue->consumer_waiting, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if (ring_count(&queue->ring) == 0 && *keep_waiting) {
+        if (other_word == NULL) {
+            futex_wait(&queue->wakeup_seq, seen, NULL);
+        } else {
+            futex_wait_either(&queue->wakeup_seq, seen, other_word, other_seen, NULL);
+        }
+    }
+    atomic_store_explicit(&queue->consumer_waiting, 0, memory_order_relaxed);
+}
+
+// Sveglia il consumatore (anche dal suo gestore di segnale, così un segnale
+// arrivato prima di FUTEX_WAIT non viene perso)
+void submit_queue_wakeup(SubmitQueue *queue)
+{
+    atomic_fetch_add_explicit(&queue->wakeup_seq, 1, memory_order_release);
+    futex_wake(&queue->wakeup_seq, 1);
+}
+
+#endif // SUBMIT_QUEUE_H
@@ -5,385 +5,300 @@
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
-#include <sys/sem.h>
-#include <sys/msg.h>
 #include <signal.h>
 #include <time.h>
 #include <string.h>
 #include <errno.h>
 #include <sys/time.h>  // Per gettimeofday()
 #include "config.h"
+#include "shm_layout.h"
+#include "shm_backend.h"
+#include "notify.h"
+#include "day_barrier.h"
 
 // Variabili globali
 SharedMemory *shm_ptr = NULL;
-int semid = -1;
-int shmid = -1;
 volatile int running = 1;
-volatile int day_in_progress = 0;
+unsigned int current_day = 0; // Giornata in corso (day_barrier.h), 0 prima della prima
 
-// Variabile globale per la coda di messaggi
-int msgid = -1;
+// Worker del distributore gestito da questo processo (argomento da riga di
+// comando): serve solo i servizi con service % ticket_worker_count == worker_id
+int worker_id = 0;
+TicketWorker *worker = NULL;
+
+// Lotto di richieste prelevate in un giro dalla coda di invio (TICKET_BATCH_SIZE indici)
+int *batch_requests = NULL;
+int *batch_services = NULL;     // Servizio in cui è stato accodato ogni ticket (-1 = nessuno)
+pid_t *batch_pids = NULL;       // Utente da svegliare per ogni ticket accodato
 
 // Gestore segnale per la terminazione
 void termination_handler(int signum __attribute__((unused)))
 {
     running = 0;
-}
-
-// Funzione per il reset giornaliero di code, contatori e richieste
-void reset_daily_counters() {
-    if (shm_ptr != NULL && shm_ptr != (void *)-1) {
-        struct sembuf sem_op;
-        sem_op.sem_num = SEM_QUEUE;
-        sem_op.sem_op = -1; // Lock
-        sem_op.sem_flg = 0;
-        if (semop(semid, &sem_op, 1) < 0) {
-            perror("Ticket: Failed to acquire queue mutex for daily reset");
-            return;
-        }
-        shm_ptr->next_request_index = 0;
-        for (int i = 0; i < SERVICE_COUNT; i++) {
-            shm_ptr->service_queue_head[i] = 0;
-            shm_ptr->service_queue_tail[i] = 0;
-            shm_ptr->service_tickets_waiting[i] = 0;
-            shm_ptr->next_service_ticket[i] = 1;
-        }
-        // Reset solo delle richieste completate/rifiutate/undefined
-        for (int i = 0; i < MAX_REQUESTS; i++) {
-            if (shm_ptr->ticket_requests[i].status == REQUEST_COMPLETED ||
-                shm_ptr->ticket_requests[i].status == REQUEST_REJECTED ||
-                shm_ptr->ticket_requests[i].status == REQUEST_UNDEFINED) {
-                memset(&shm_ptr->ticket_requests[i], 0, sizeof(TicketRequest));
-            }
-        }
-        sem_op.sem_op = 1; // Unlock
-        if (semop(semid, &sem_op, 1) < 0) {
-            perror("Ticket: Failed to release queue mutex after daily reset");
-        }
+    if (worker != NULL) {
+        submit_queue_wakeup(&worker->submit_queue);
     }
 }
 
-// Handler per il segnale di inizio giornata
-void day_start_handler(int signum __attribute__((unused)))
-{
-    // Il reset verrà fatto nel loop principale per evitare duplicazioni
-    day_in_progress = 1;
-}
-
-// Handler per la fine della giornata
-void day_end_handler(int signum __attribute__((unused)))
+// Soglia di esplosione: gli utenti in coda crescono solo quando un ticket
+// viene accodato, quindi il controllo dopo ogni accodamento vede il
+// superamento nel momento in cui avviene. Il primo processo ticket che lo
+// vede scrive il totale in explode_waiting e sveglia il direttore
+void check_explode_threshold()
 {
-    day_in_progress = 0;
-}
-
-// Funzione per elaborare direttamente i messaggi di richiesta ticket usando request_index
-void process_new_ticket_request(TicketRequestMsg *msg)
-{
-    // CONTROLLO CRITICO: Verifica che la giornata sia ancora in corso
-    if (!shm_ptr->day_in_progress) {
-        printf("Ticket: [REJECTED] Richiesta da utente %d rifiutata - giornata terminata\n", msg->user_id);
-        
-        // Notifica l'utente che la richiesta è stata rifiutata
-        if (msg->user_pid > 0) {
-            kill(msg->user_pid, SIGUSR2);
-        }
+    int total_waiting_users = count_waiting_users(shm_ptr);
+    if (total_waiting_users <= EXPLODE_THRESHOLD) {
         return;
     }
 
-    // Salva il PID dell'utente per inviare la notifica successivamente
-    pid_t user_pid = msg->user_pid;
-    int request_index = msg->request_index;
+    unsigned int not_exploded = 0;
+    if (atomic_compare_exchange_strong_explicit(&shm_ptr->explode_waiting, &not_exploded,
+                                                (unsigned int)total_waiting_users,
+                                                memory_order_release, memory_order_relaxed)) {
+        futex_wake(&shm_ptr->explode_waiting, 1);
+    }
+}
 
+// Funzione per elaborare direttamente le richieste di ticket usando request_index.
+// Ritorna il servizio in cui è stato accodato il ticket, -1 se non è stato
+// accodato. Operatori e utente vengono avvisati da process_ticket_batch()
+int process_new_ticket_request(int request_index)
+{
     // Verifica che il request_index sia valido
-    if (request_index < 0 || request_index >= MAX_REQUESTS) {
+    if (request_index < 0 || request_index >= shm_ptr->request_capacity) {
         printf("Ticket: [ERROR] request_index %d non valido\n", request_index);
-        return;
+        return -1;
     }
 
     // Ottieni direttamente la richiesta dalla memoria condivisa usando l'indice
-    TicketRequest *request = &(shm_ptr->ticket_requests[request_index]);
-    
-    // Verifica che la richiesta esista e sia in stato PENDING
-    if (request->status != REQUEST_PENDING) {
-        printf("Ticket: [ERROR] Richiesta %d non è PENDING (status: %d)\n", 
-               request_index, request->status);
-        return;
-    }
-
-    // Aggiorna lo stato della richiesta a elaborazione in corso
-    request->status = REQUEST_PROCESSING;
+    TicketRequest *request = &(SHM_REQUESTS(shm_ptr)[request_index]);
 
-    // Acquisisce il mutex per le code dei ticket
-    struct sembuf sem_op;
-    sem_op.sem_num = SEM_QUEUE;
-    sem_op.sem_op = -1; // Lock
-    sem_op.sem_flg = 0;
+    // CONTROLLO CRITICO: Verifica che la giornata sia ancora in corso
+    if (!shm_ptr->day_in_progress) {
+        printf("Ticket: [REJECTED] Richiesta da utente %d rifiutata - giornata terminata\n", request->user_id);
 
-    if (semop(semid, &sem_op, 1) < 0)
-    {
-        perror("Ticket: Failed to acquire queue mutex");
-        request->status = REQUEST_REJECTED;
-        return;
+        // Nessuna notifica: l'utente si è già svegliato con la chiusura della giornata
+        request_release(shm_ptr, request_index);
+        return -1;
     }
 
-    // Ottiene il prossimo numero di ticket per questo servizio specifico
-    int service_id = request->service_id;
-    int ticket_number = shm_ptr->next_service_ticket[service_id]++;
-
-    // Aggiunge il ticket alla coda del servizio appropriata
-    int queue_pos = shm_ptr->service_queue_tail[service_id];
-    shm_ptr->service_queues[service_id][queue_pos] = request_index;
-
-    // Aggiorna la coda di coda (buffer circolare)
-    shm_ptr->service_queue_tail[service_id] = (queue_pos + 1) % MAX_SERVICE_QUEUE;
-
-    // Aggiorna il conteggio dei ticket per questo servizio
-    shm_ptr->service_tickets_waiting[service_id]++;
-
-    // Rilascia il mutex
-    sem_op.sem_num = SEM_QUEUE;
-    sem_op.sem_op = 1; // Unlock
-    sem_op.sem_flg = 0;
-
-    if (semop(semid, &sem_op, 1) < 0)
-    {
-        perror("Ticket: Failed to release queue mutex");
-        // Continuiamo comunque poiché la sezione critica è completata
+    // Richiesta di una giornata precedente rimasta nel lotto: va solo scartata
+    if (request_is_stale(shm_ptr, request_index)) {
+        request_release(shm_ptr, request_index);
+        return -1;
     }
     
-    // Notifica gli operatori che c'è un nuovo ticket disponibile
-    struct sembuf ticket_ready_signal;
-    ticket_ready_signal.sem_num = SEM_TICKET_READY;
-    ticket_ready_signal.sem_op = 1; // Signal (operazione V)
-    ticket_ready_signal.sem_flg = 0;
-    
-    if (semop(semid, &ticket_ready_signal, 1) < 0)
-    {
-        perror("Ticket: Failed to signal ticket ready");
-    }
-
-    // NOTIFICA ISTANTANEA: Invia segnale SIGUSR1 a tutti gli operatori attivi per questo servizio
-    // per notificare immediatamente la disponibilità di un nuovo ticket
-    for (int i = 0; i < NOF_WORKERS; i++) {
-        if (shm_ptr->operators[i].active && 
-            (int)shm_ptr->operators[i].current_service == service_id &&
-            shm_ptr->operators[i].status == OPERATOR_WORKING &&
-            shm_ptr->operators[i].pid > 0) {
-            kill(shm_ptr->operators[i].pid, SIGUSR1);
+    // Aggiorna lo stato della richiesta a elaborazione in corso. Se l'utente
+    // ha già rinunciato (fine giornata) la richiesta resta sua e va solo scartata
+    if (!request_change_status(request, REQUEST_PENDING, REQUEST_PROCESSING)) {
+        if (request->status != REQUEST_REJECTED) {
+            printf("Ticket: [ERROR] Richiesta %d non è PENDING (status: %d)\n", 
+                   request_index, request->status);
         }
+        request_release(shm_ptr, request_index);
+        return -1;
     }
 
+    // Ottiene il prossimo numero di ticket per questo servizio specifico
+    // (solo il worker che possiede il servizio scrive il suo contatore)
+    int service_id = request->service_id;
+    int ticket_number = shm_ptr->ticketing[service_id].next_ticket++;
+
     // Genera l'identificativo del ticket (es. L1, B1, ecc.)
     char ticket_id[10];
     sprintf(ticket_id, "%c%d", SERVICE_PREFIXES[service_id], ticket_number);
 
     // Aggiorna la richiesta con le informazioni del ticket
     request->ticket_number = ticket_number;
-    request->status = REQUEST_COMPLETED; // Generazione ticket completata
     strncpy(request->ticket_id, ticket_id, sizeof(request->ticket_id) - 1);
     request->ticket_id[sizeof(request->ticket_id) - 1] = '\0'; // Assicura terminazione null
 
+    // Emissione o rinuncia dell'utente: vince solo una delle due, così un
+    // utente non viene contato sia tra i ticket emessi sia tra i "senza ticket"
+    if (!request_change_status(request, REQUEST_PROCESSING, REQUEST_COMPLETED)) {
+        shm_ptr->ticketing[service_id].next_ticket--;
+        request_release(shm_ptr, request_index);
+        return -1;
+    }
+    shm_ptr->ticketing[service_id].daily_issued++;
+    // Dopo la pubblicazione lo slot può tornare al pool: l'utente va letto prima
+    int user_id = request->user_id;
+    request_publish_outcome(request);
+
+    // Aggiunge il ticket alla coda del servizio: il ring è lock-free, nessun
+    // semaforo da acquisire. Un ticket che non entra in coda resta emesso e
+    // non servito, e a fine giornata viene contato come tale
+    if (!service_queue_push(shm_ptr, service_id, request_index))
+    {
+        printf("Ticket: [ERROR] Coda del servizio %s piena\n", SERVICE_NAMES[service_id]);
+        request_release(shm_ptr, request_index);
+        return -1;
+    }
+    flight_record(shm_ptr, FLIGHT_TICKET_ISSUED, service_id, user_id, ticket_number,
+                  service_queue_length(shm_ptr, service_id));
+    check_explode_threshold();
+
     //printf("Ticket: Assigned ticket %s to user %d for service %s\n",
     //       ticket_id, request->user_id, SERVICE_NAMES[request->service_id]);
-    
-    // Invia un segnale all'utente per notificare che la richiesta è stata elaborata
-    if (user_pid > 0) {
-        //printf("Ticket: Invio segnale SIGUSR1 all'utente %d (PID: %d)\n", 
-        //      msg->user_id, user_pid);
-        kill(user_pid, SIGUSR1);
+
+    return service_id;
+}
+
+// Elabora un lotto di richieste prelevate: prima accoda tutti i ticket, poi
+// notifica una volta sola, con un risveglio cumulativo per servizio (un
+// operatore inattivo per ticket accodato) invece di un FUTEX_WAKE per ticket
+void process_ticket_batch(int *requests, int count)
+{
+    int queued[SERVICE_COUNT] = {0};
+    int total_queued = 0;
+
+    for (int i = 0; i < count; i++) {
+        // Il PID va letto prima di accodare: dopo, un operatore può servire
+        // la richiesta e rilasciarne lo slot prima della notifica all'utente
+        batch_pids[i] = 0;
+        if (requests[i] >= 0 && requests[i] < shm_ptr->request_capacity) {
+            batch_pids[i] = SHM_REQUESTS(shm_ptr)[requests[i]].user_pid;
+        }
+        batch_services[i] = process_new_ticket_request(requests[i]);
+        if (batch_services[i] >= 0) {
+            queued[batch_services[i]]++;
+            total_queued++;
+        }
+    }
+
+    if (total_queued == 0) {
+        return;
+    }
+
+    // Sveglia solo gli operatori inattivi necessari (futex), invece di
+    // mandare SIGUSR1 a tutti gli operatori al lavoro. I ticket rimasti senza
+    // un operatore del servizio possono essere rubati da inattivi di altri servizi
+    for (int service = 0; service < SERVICE_COUNT; service++) {
+        if (queued[service] > 0) {
+            int woken = wake_idle_operators(shm_ptr, service, queued[service]);
+            if (woken < queued[service]) {
+                wake_idle_stealers(shm_ptr, service, queued[service] - woken);
+            }
+        }
+    }
+
+    // Sveglia gli utenti che dormono sull'esito della richiesta (futex),
+    // invece di mandare SIGUSR1. L'host degli utenti non ci dorme: lo
+    // controlla da sé, nessuna chiamata di sistema
+    for (int i = 0; i < count; i++) {
+        if (batch_services[i] >= 0 && batch_pids[i] > 0 && batch_pids[i] != shm_ptr->user_host_pid) {
+            request_wake_user(&SHM_REQUESTS(shm_ptr)[requests[i]]);
+        }
     }
 }
 
-int main()
+int main(int argc, char *argv[])
 {
     // Carica la configurazione dalla variabile d'ambiente
     const char* config_file = getenv("SO_CONFIG_FILE");
     if (!config_file) config_file = "timeout.conf"; // default
     read_config(config_file);
 
+    if (argc > 1)
+    {
+        worker_id = atoi(argv[1]);
+    }
+
     // Imposta i gestori di segnale
     signal(SIGTERM, termination_handler); // Segnale di terminazione
     signal(SIGINT, termination_handler);  // Ctrl+C
-    signal(SIGUSR1, day_start_handler);   // Inizio del giorno
-    signal(SIGUSR2, day_end_handler);     // Fine del giorno
 
     //printf("Ticket process starting...\n");
 
-    // Attacca alla memoria condivisa
-    shmid = shmget(SHM_KEY, sizeof(SharedMemory), 0666);
-    if (shmid == -1)
+    // Attacca la memoria condivisa (SysV o POSIX, vedi shm_backend.h)
+    shm_ptr = shm_segment_attach("Ticket");
+    if (shm_ptr == NULL)
     {
-        perror("Ticket: shmget failed");
         exit(EXIT_FAILURE);
     }
 
-    shm_ptr = (SharedMemory *)shmat(shmid, NULL, 0);
-    if (shm_ptr == (void *)-1)
+    batch_requests = malloc(TICKET_BATCH_SIZE * sizeof(int));
+    batch_services = malloc(TICKET_BATCH_SIZE * sizeof(int));
+    batch_pids = malloc(TICKET_BATCH_SIZE * sizeof(pid_t));
+    if (batch_requests == NULL || batch_services == NULL || batch_pids == NULL)
     {
-        perror("Ticket: shmat failed");
+        perror("Ticket: malloc failed");
+        shm_segment_detach(shm_ptr);
         exit(EXIT_FAILURE);
     }
 
-    // Ottieni accesso ai semafori
-    semid = semget(SEM_KEY, NUM_SEMS, 0666);
-    if (semid == -1)
+    if (worker_id < 0 || worker_id >= shm_ptr->ticket_worker_count)
     {
-        perror("Ticket: semget failed");
-        shmdt(shm_ptr);
-        exit(EXIT_FAILURE);
-    }
-
-    // Crea o accedi alla coda di messaggi
-    msgid = msgget(MSG_QUEUE_KEY, IPC_CREAT | 0666);
-    if (msgid == -1)
-    {
-        perror("Ticket: msgget failed");
+        fprintf(stderr, "Ticket: worker %d non valido (%d worker configurati)\n", worker_id, shm_ptr->ticket_worker_count);
+        shm_segment_detach(shm_ptr);
         exit(EXIT_FAILURE);
     }
+    worker = &shm_ptr->ticket_workers[worker_id];
 
     // Memorizza il nostro PID nella memoria condivisa
-    shm_ptr->ticket_pid = getpid();
-
-    // Inizializzazione iniziale
-    struct sembuf sem_op;
-    sem_op.sem_num = SEM_QUEUE;
-    sem_op.sem_op = -1; // Lock
-    sem_op.sem_flg = 0;
+    worker->pid = getpid();
 
-    if (semop(semid, &sem_op, 1) < 0)
+    // Inizializza i contatori dei servizi del worker: nessun altro processo
+    // li scrive, quindi non serve il mutex delle code
+    for (int i = worker_id; i < SERVICE_COUNT; i += shm_ptr->ticket_worker_count)
     {
-        perror("Ticket: Failed to acquire queue mutex for initialization");
-        shmdt(shm_ptr);
-        exit(EXIT_FAILURE);
-    }
-
-    // Inizializza le code dei servizi
-    for (int i = 0; i < SERVICE_COUNT; i++)
-    {
-        if (shm_ptr->next_service_ticket[i] == 0)
+        if (shm_ptr->ticketing[i].next_ticket == 0)
         {
-            shm_ptr->next_service_ticket[i] = 1; // Inizia ogni servizio con ticket #1
+            shm_ptr->ticketing[i].next_ticket = 1; // Inizia ogni servizio con ticket #1
         }
     }
 
-    // Rilascia il mutex
-    sem_op.sem_num = SEM_QUEUE;
-    sem_op.sem_op = 1; // Unlock
-    sem_op.sem_flg = 0;
-
-    if (semop(semid, &sem_op, 1) < 0)
-    {
-        perror("Ticket: Failed to release queue mutex after initialization");
-        shmdt(shm_ptr);
-        exit(EXIT_FAILURE);
-    }
-
     //printf("Ticket process initialized. PID: %d\n", getpid());
+    day_barrier_ready(shm_ptr);
 
     // Loop principale per la simulazione
     while (running)
     {
-        // Attendi l'inizio della giornata tramite segnale e semaforo
-        if (!shm_ptr->day_in_progress && running)
-        {
-            //printf("Ticket: Attendo l'inizio della giornata...\n");
-            
-            // Configura un set di segnali per attendere il segnale SIGUSR1
-            sigset_t wait_mask;
-            sigfillset(&wait_mask);
-            sigdelset(&wait_mask, SIGUSR1);  // Attendi il segnale di inizio giornata
-            sigdelset(&wait_mask, SIGTERM);  // Permettiamo anche la terminazione
-            
-            // Sospendi l'esecuzione fino a quando non arriva un segnale
-            sigsuspend(&wait_mask);
-            
-            // Se il segnale era di terminazione, esci dal loop
-            if (!running) {
-                continue;
-            }
-            
-            // Dopo aver ricevuto il segnale, attendi anche sul semaforo SEM_DAY_START
-            struct sembuf sem_wait;
-            sem_wait.sem_num = SEM_DAY_START;
-            sem_wait.sem_op = -1;  // Operazione P (wait)
-            sem_wait.sem_flg = 0;
-            
-            //printf("Ticket: Attendo sulla barriera semaforo SEM_DAY_START...\n");
-            
-            // Attendi sul semaforo
-            if (semop(semid, &sem_wait, 1) < 0) {
-                if (errno != EINTR) {  // Ignora se interrotto da segnale
-                    perror("Ticket: semop wait for day start failed");
-                }
-            } else {
-                //printf("Ticket: Semaforo SEM_DAY_START acquisito, giornata iniziata\n");
-            }
-        }
+        // Attendi l'apertura della giornata sulla barriera condivisa
+        // (day_barrier.h); SIGTERM sveglia tramite la coda di invio
+        current_day = day_barrier_wait_open(shm_ptr, current_day, &worker->submit_queue.wakeup_seq, &running);
 
         if (!running)
             break;
 
-        // All'inizio di ogni giornata, resetta i contatori e le code
-        reset_daily_counters();
-
         //-----------------------------------------------------------------------------------------------------------------------------------------------------
         // Loop per la giornata corrente - gestisce le richieste di ticket
         //printf("Ticket: Giorno %d in corso, in attesa di richieste ticket\n", shm_ptr->simulation_day);
         
-        while (shm_ptr->day_in_progress && running)
+        while (running && day_barrier_is_current(shm_ptr, current_day))
         {
-            // ZERO ATTESA ATTIVA: msgrcv bloccante che aspetta istantaneamente i messaggi
-            TicketRequestMsg msg;
-            ssize_t msgsize;
-            
-            // Attesa BLOCCANTE sui messaggi - il processo si blocca fino all'arrivo di un messaggio
-            // o fino a quando viene interrotto da un segnale (es. SIGUSR2 per fine giornata)
-            msgsize = msgrcv(msgid, &msg, sizeof(msg) - sizeof(long),
-                          MSG_TICKET_REQUEST, 0); // 0 = bloccante, nessun IPC_NOWAIT
-            
-            if (msgsize > 0) 
+            // Preleva senza bloccarsi le richieste già inviate, fino a
+            // TICKET_BATCH_SIZE: durante un picco di arrivi si elabora un lotto
+            int count = submit_queue_drain(&worker->submit_queue, SHM_SUBMIT_CELLS(shm_ptr, worker_id),
+                                           batch_requests, TICKET_BATCH_SIZE);
+            if (count > 0)
             {
-                //printf("Ticket: Ricevuta richiesta da utente %d (PID: %d) per servizio %s\n",
-                //      msg.user_id, msg.user_pid, SERVICE_NAMES[msg.service_id]);
-                      
-                if (shm_ptr->day_in_progress) {
-                    // Richiesta ricevuta - processa immediatamente
-                    process_new_ticket_request(&msg);
-                    
-                    // Segnala il completamento dell'elaborazione
-                    //printf("Ticket: Richiesta elaborata per utente %d\n", msg.user_id);
-                } else {
-                    // La giornata è finita mentre elaboravamo la richiesta
-                    //printf("Ticket: Giornata terminata durante l'elaborazione della richiesta per utente %d\n", 
-                    //      msg.user_id);
-                    
-                    // Segnala comunque all'utente che la richiesta è stata ricevuta ma non elaborata
-                    if (msg.user_pid > 0) {
-                        kill(msg.user_pid, SIGUSR2);
-                    }
-                }
+                // Richieste ricevute - processa immediatamente l'intero lotto
+                process_ticket_batch(batch_requests, count);
             }
-            else if (errno == EINTR) 
+            else
             {
-                // Interrotto da un segnale (es. SIGUSR2 per fine giornata) - comportamento normale
-                // Il loop ricontrollerà la condizione day_in_progress
-            }
-            else if (errno != ENOMSG) 
-            {
-                // Errore diverso da "nessun messaggio" o interruzione da segnale
-                perror("Ticket: msgrcv failed");
+                // ZERO ATTESA ATTIVA: il processo dorme sul futex della coda di
+                // invio finché un utente non invia una richiesta, il direttore
+                // non chiude la giornata o SIGTERM non lo sveglia
+                submit_queue_wait_either(&worker->submit_queue, &running, &shm_ptr->day_seq, current_day);
             }
         }
 
         //printf("Ticket: Day %d completed\n", shm_ptr->simulation_day);
+        day_barrier_done(shm_ptr);
     }
 
     //printf("Ticket process terminating...\n");
 
+    free(batch_requests);
+    free(batch_services);
+    free(batch_pids);
+
     if (shm_ptr != NULL && shm_ptr != (void *)-1)
     {
-        shm_ptr->ticket_pid = 0; // Pulisce il nostro PID dalla memoria condivisa
-        shmdt(shm_ptr);
+        worker->pid = 0; // Pulisce il nostro PID dalla memoria condivisa
+        shm_segment_detach(shm_ptr);
     }
 
     //printf("Ticket process terminated\n");
@@ -0,0 +1,114 @@
+#ifndef TICKET_RING_H
+#define TICKET_RING_H
+
+#include <stdatomic.h>
+#include "cache_line.h"
+
+// Coda circolare limitata multi-produttore/multi-consumatore senza lock
+// (schema di D. Vyukov). Ogni cella ha un numero di sequenza che dice se è
+// libera per il produttore del giro corrente o pronta per il consumatore:
+// produttori e consumatori si contendono solo la propria posizione con una
+// compare-and-swap, senza semafori né chiamate di sistema.
+// Le posizioni sono a 64 bit e crescono sempre, quindi non si riavvolgono
+// durante una simulazione. La capacità deve essere una potenza di due.
+// Gli atomici sono lock-free e non dipendono dall'indirizzo, quindi la coda
+// funziona anche tra processi diversi in memoria condivisa.
+// Le due posizioni stanno su linee di cache diverse: produttori e
+// consumatori non si invalidano a vicenda a ogni operazione.
+
+_Static_assert(ATOMIC_LONG_LOCK_FREE == 2, "la coda richiede atomici long lock-free");
+
+typedef struct {
+    atomic_ulong sequence;      // Giro della cella (vedi ring_push/ring_pop)
+    int value;                  // Indice della richiesta in ticket_requests
+} RingCell;
+
+typedef struct {
+    atomic_ulong enqueue_pos CACHE_ALIGNED; // Prossima posizione da scrivere (produttori)
+    atomic_ulong dequeue_pos CACHE_ALIGNED; // Prossima posizione da leggere (consumatori)
+    unsigned long mask CACHE_ALIGNED;       // Capacità - 1 (sola lettura)
+} TicketRing;
+
+void ring_init(TicketRing *ring, RingCell *cells, unsigned long capacity);
+int ring_push(TicketRing *ring, RingCell *cells, int value);
+int ring_pop(TicketRing *ring, RingCell *cells, int *value);
+int ring_count(TicketRing *ring);
+
+// Implementazione delle funzioni
+
+// Svuota la coda. Da chiamare solo quando nessuno la sta usando
+// (creazione del segmento o cambio di giornata)
+void ring_init(TicketRing *ring, RingCell *cells, unsigned long capacity)
+{
+    ring->mask = capacity - 1;
+    for (unsigned long i = 0; i < capacity; i++) {
+        atomic_store_explicit(&cells[i].sequence, i, memory_order_relaxed);
+        cells[i].value = 0;
+    }
+    atomic_store_explicit(&ring->enqueue_pos, 0, memory_order_relaxed);
+    atomic_store_explicit(&ring->dequeue_pos, 0, memory_order_release);
+}
+
+// Inserisce un valore. Ritorna 1 se inserito, 0 se la coda è piena
+int ring_push(TicketRing *ring, RingCell *cells, int value)
+{
+    unsigned long pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+
+    for (;;) {
+        RingCell *cell = &cells[pos & ring->mask];
+        unsigned long seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        long diff = (long)(seq - pos);
+
+        if (diff == 0) {
+            // Cella libera: la si prenota avanzando enqueue_pos
+            if (atomic_compare_exchange_weak_explicit(&ring->enqueue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                cell->value = value;
+                atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+                return 1;
+            }
+            // CAS fallita: pos è stato aggiornato, si riprova
+        } else if (diff < 0) {
+            return 0; // Cella non ancora consumata dal giro precedente: coda piena
+        } else {
+            pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+// Estrae il valore più vecchio. Ritorna 1 se estratto, 0 se la coda è vuota
+int ring_pop(TicketRing *ring, RingCell *cells, int *value)
+{
+    unsigned long pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+
+    for (;;) {
+        RingCell *cell = &cells[pos & ring->mask];
+        unsigned long seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        long diff = (long)(seq - (pos + 1));
+
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->dequeue_pos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                *value = cell->value;
+                // La cella torna libera per il produttore del giro successivo
+                atomic_store_explicit(&cell->sequence, pos + ring->mask + 1, memory_order_release);
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0; // Nessun valore pubblicato in questa posizione: coda vuota
+        } else {
+            pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+        }
+    }
+}
+
+// Elementi in coda. Con produttori e consumatori attivi è una stima
+// (le due posizioni non vengono lette insieme), mai negativa
+int ring_count(TicketRing *ring)
+{
+    unsigned long dequeue = atomic_load_explicit(&ring->dequeue_pos, memory_order_acquire);
+    unsigned long enqueue = atomic_load_explicit(&ring->enqueue_pos, memory_order_acquire);
+    return enqueue > dequeue ? (int)(enqueue - dequeue) : 0;
+}
+
+#endif // TICKET_RING_H
@@ -0,0 +1,189 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stddef.h>
+
+// Timer wheel gerarchico (stile kernel Linux) per gestire migliaia di
+// scadenze in un solo processo. Ogni livello ha TW_SLOTS slot; il livello 0
+// ha la risoluzione di un tick, il livello L copre TW_SLOTS^(L+1) tick.
+// I nodi sono intrusivi: chi li usa li incorpora nella propria struttura,
+// quindi aggiunta e rimozione sono O(1) e non allocano memoria.
+
+#define TW_LEVELS 4
+#define TW_SLOT_BITS 6
+#define TW_SLOTS (1 << TW_SLOT_BITS)
+#define TW_SLOT_MASK (TW_SLOTS - 1)
+#define TW_MAX_DELTA ((1UL << (TW_SLOT_BITS * TW_LEVELS)) - 1)
+
+typedef struct TimerNode {
+    struct TimerNode *next;
+    struct TimerNode *prev;
+    unsigned long expires;      // Tick di scadenza
+} TimerNode;
+
+typedef struct {
+    unsigned long now;                      // Ultimo tick elaborato
+    TimerNode slots[TW_LEVELS][TW_SLOTS];   // Liste circolari con sentinella
+    long armed;                             // Timer attualmente programmati
+} TimerWheel;
+
+void tw_init(TimerWheel *tw, unsigned long now);
+void tw_add(TimerWheel *tw, TimerNode *node, unsigned long expires);
+void tw_del(TimerWheel *tw, TimerNode *node);
+int tw_pending(TimerNode *node);
+TimerNode *tw_advance(TimerWheel *tw, unsigned long now);
+TimerNode *tw_pop_expired(TimerNode **list);
+unsigned long tw_next_expiry(TimerWheel *tw);
+
+// Implementazione delle funzioni
+
+void tw_init(TimerWheel *tw, unsigned long now)
+{
+    tw->now = now;
+    tw->armed = 0;
+    for (int level = 0; level < TW_LEVELS; level++) {
+        for (int slot = 0; slot < TW_SLOTS; slot++) {
+            tw->slots[level][slot].next = &tw->slots[level][slot];
+            tw->slots[level][slot].prev = &tw->slots[level][slot];
+        }
+    }
+}
+
+// Inserisce il nodo nello slot adatto alla distanza dalla scadenza
+void tw_place(TimerWheel *tw, TimerNode *node)
+{
+    unsigned long delta = node->expires - tw->now;
+    unsigned long position = node->expires;
+    int level = 0;
+
+    if (delta > TW_MAX_DELTA) {
+        // Oltre l'orizzonte della ruota: lo slot è quello dell'orizzonte, la
+        // scadenza resta quella vera. La cascata dello slot arriva prima
+        // della scadenza e ricolloca il nodo rispetto a expires
+        position = tw->now + TW_MAX_DELTA;
+        delta = TW_MAX_DELTA;
+    }
+    while (level < TW_LEVELS - 1 && delta >= (1UL << (TW_SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+
+    TimerNode *head = &tw->slots[level][(position >> (TW_SLOT_BITS * level)) & TW_SLOT_MASK];
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+void tw_add(TimerWheel *tw, TimerNode *node, unsigned long expires)
+{
+    // Le scadenze già passate scattano al prossimo tick
+    node->expires = expires > tw->now ? expires : tw->now + 1;
+    tw_place(tw, node);
+    tw->armed++;
+}
+
+void tw_unlink(TimerNode *node)
+{
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->next = NULL;
+    node->prev = NULL;
+}
+
+void tw_del(TimerWheel *tw, TimerNode *node)
+{
+    if (tw_pending(node)) {
+        tw_unlink(node);
+        tw->armed--;
+    }
+}
+
+int tw_pending(TimerNode *node)
+{
+    return node->next != NULL;
+}
+
+// Ridistribuisce lo slot corrente di un livello superiore sui livelli inferiori
+int tw_cascade(TimerWheel *tw, int level)
+{
+    int index = (tw->now >> (TW_SLOT_BITS * level)) & TW_SLOT_MASK;
+    TimerNode *head = &tw->slots[level][index];
+
+    while (head->next != head) {
+        TimerNode *node = head->next;
+        tw_unlink(node);
+        tw_place(tw, node);
+    }
+    return index;
+}
+
+// Avanza la ruota fino al tick "now" e restituisce la lista (collegata tramite
+// next) dei timer scaduti, già rimossi dalla ruota
+TimerNode *tw_advance(TimerWheel *tw, unsigned long now)
+{
+    TimerNode *expired = NULL;
+    TimerNode **tail = &expired;
+
+    while (tw->now < now) {
+        tw->now++;
+        int index = tw->now & TW_SLOT_MASK;
+
+        // A ogni giro completo del livello 0 si scende di un livello
+        if (index == 0) {
+            for (int level = 1; level < TW_LEVELS && tw_cascade(tw, level) == 0; level++) {
+            }
+        }
+
+        TimerNode *head = &tw->slots[0][index];
+        while (head->next != head) {
+            TimerNode *node = head->next;
+            tw_unlink(node);
+            tw->armed--;
+            *tail = node;
+            tail = &node->next;
+        }
+    }
+    return expired;
+}
+
+// Stacca il primo nodo dalla lista restituita da tw_advance. Il nodo torna
+// "non programmato" e può essere riaggiunto alla ruota
+TimerNode *tw_pop_expired(TimerNode **list)
+{
+    TimerNode *node = *list;
+
+    if (node != NULL) {
+        *list = node->next;
+        node->next = NULL;
+    }
+    return node;
+}
+
+// Tick della prossima scadenza (o ~0UL se la ruota è vuota). Per ogni livello
+// basta il primo slot non vuoto a partire dalla posizione corrente
+unsigned long tw_next_expiry(TimerWheel *tw)
+{
+    unsigned long next = ~0UL;
+
+    if (tw->armed == 0) {
+        return next;
+    }
+    for (int level = 0; level < TW_LEVELS; level++) {
+        int current = (tw->now >> (TW_SLOT_BITS * level)) & TW_SLOT_MASK;
+        for (int i = 1; i <= TW_SLOTS; i++) {
+            TimerNode *head = &tw->slots[level][(current + i) & TW_SLOT_MASK];
+            if (head->next == head) {
+                continue;
+            }
+            for (TimerNode *node = head->next; node != head; node = node->next) {
+                if (node->expires < next) {
+                    next = node->expires;
+                }
+            }
+            break;
+        }
+    }
+    return next;
+}
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,153 @@
+#ifndef USER_OPS_H
+#define USER_OPS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/ipc.h>
+#include "config.h"
+#include "request_pool.h"
+#include "shm_sync.h"
+
+// Operazioni lato utente condivise tra il processo utente singolo (utente.c)
+// e l'host che simula l'intera popolazione (utenti.c).
+// Il file che include l'header deve definire shm_ptr.
+
+extern SharedMemory *shm_ptr;
+
+int is_service_available(SharedMemory *shm, int service_id);
+void increment_users_home_stats(int service_id);
+void increment_users_not_arrived_stats();
+int increment_users_no_ticket_stats(int request_index, int service_id);
+int request_ticket(int user_id, int service_id);
+void release_ticket_request(int request_index);
+long user_wakeups();
+void record_user_wakeups(long *last_wakeups);
+
+// Implementazione delle funzioni
+
+// Verifica disponibilità del servizio (sportello + operatore): legge il
+// numero di sportelli presidiati, mantenuto da counter_index.h
+int is_service_available(SharedMemory *shm, int service_id)
+{
+    return atomic_load_explicit(&shm->service_available[service_id], memory_order_acquire) > 0;
+}
+
+// Incrementa conteggio utenti tornati a casa senza servizio
+void increment_users_home_stats(int service_id) {
+    shm_mutex_lock(&shm_ptr->stats_lock, "statistiche");
+    shm_ptr->daily_users_home[service_id]++;
+    shm_ptr->total_users_home++;
+    shm_mutex_unlock(&shm_ptr->stats_lock);
+}
+
+// Incrementa conteggio utenti che non si sono presentati all'ufficio postale
+void increment_users_not_arrived_stats() {
+    // Non sappiamo quale servizio avrebbe scelto, quindi incrementiamo un servizio casuale
+    int random_service = rand() % SERVICE_COUNT;
+
+    shm_mutex_lock(&shm_ptr->stats_lock, "statistiche");
+    shm_ptr->daily_users_not_arrived[random_service]++;
+    shm_ptr->total_users_not_arrived++;
+    shm_ptr->total_users_not_arrived_per_service[random_service]++;
+    shm_mutex_unlock(&shm_ptr->stats_lock);
+}
+
+// Conta come "senza ticket" una richiesta ancora in attesa a fine giornata.
+// Restituisce 1 se la richiesta è stata conteggiata, 0 altrimenti
+int increment_users_no_ticket_stats(int request_index, int service_id) {
+    int counted = 0;
+
+    shm_mutex_lock(&shm_ptr->stats_lock, "statistiche");
+    // Utente non ha ricevuto il ticket entro la fine della giornata: la
+    // rinuncia è uno scambio atomico, in concorrenza con l'emissione
+    TicketRequest *request = &SHM_REQUESTS(shm_ptr)[request_index];
+    if (request_change_status(request, REQUEST_PENDING, REQUEST_REJECTED) ||
+        request_change_status(request, REQUEST_PROCESSING, REQUEST_REJECTED)) {
+        shm_ptr->daily_users_no_ticket[service_id]++;
+        shm_ptr->total_users_no_ticket++;
+        counted = 1;
+    }
+    shm_mutex_unlock(&shm_ptr->stats_lock);
+    return counted;
+}
+
+// Funzione per richiedere un ticket dal processo di gestione ticket
+int request_ticket(int user_id, int service_id)
+{
+    // Verifica se il processo ticket che gestisce il servizio è attivo
+    if (shm_ptr == NULL)
+    {
+        return -1;
+    }
+    int worker_id = TICKET_WORKER_OF(shm_ptr, service_id);
+    TicketWorker *worker = &shm_ptr->ticket_workers[worker_id];
+    if (worker->pid <= 0)
+    {
+        return -1;
+    }
+
+    // Prende uno slot libero dal pool, senza semafori: utenti di servizi
+    // diversi non si contendono nessun lock. Lo slot arriva già azzerato e
+    // resta all'utente (fino a release_ticket_request) e al sistema
+    int request_index = request_alloc(shm_ptr, REQUEST_REFS_USER_AND_SYSTEM);
+    if (request_index < 0) {
+        // Troppe richieste vive insieme
+        return -1;
+    }
+
+    // Crea la richiesta in shared memory
+    TicketRequest *request = &(SHM_REQUESTS(shm_ptr)[request_index]);
+    request->user_id = user_id;         // ID dell'utente
+    request->service_id = service_id;   // Servizio richiesto
+    request->user_pid = getpid();       // Processo da avvisare quando il ticket è pronto
+    request->status = REQUEST_PENDING;  // Indica che è in attesa del ticket
+    clock_gettime(CLOCK_MONOTONIC, &request->request_time); // Per statistiche
+
+    // Invia la richiesta al processo ticket del servizio tramite la sua coda
+    // di invio in memoria condivisa: la richiesta scritta sopra è pubblicata
+    // insieme all'indice, il processo viene svegliato solo se sta dormendo
+    if (!submit_queue_push(&worker->submit_queue, SHM_SUBMIT_CELLS(shm_ptr, worker_id), request_index))
+    {
+        fprintf(stderr, "User: coda di invio delle richieste piena\n");
+        request->status = REQUEST_REJECTED;
+        // Nessuno ha visto la richiesta: si rilasciano entrambi i riferimenti
+        request_release(shm_ptr, request_index);
+        request_release(shm_ptr, request_index);
+        return -1;
+    }
+
+    return request_index;
+}
+
+// L'utente ha finito con la propria richiesta (ticket ricevuto, rifiutato o
+// giornata finita): rilascia il suo riferimento allo slot
+void release_ticket_request(int request_index)
+{
+    request_release(shm_ptr, request_index);
+}
+
+// Cambi di contesto volontari del processo: ogni attesa bloccante che
+// finisce (evento, scadenza o segnale) ne conta uno
+long user_wakeups()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) < 0) {
+        return 0;
+    }
+    return usage.ru_nvcsw;
+}
+
+// Somma ai risvegli della giornata quelli dall'ultima chiamata, da fare
+// prima di day_barrier_done(): il direttore li legge dopo le conferme
+void record_user_wakeups(long *last_wakeups)
+{
+    long now = user_wakeups();
+    atomic_fetch_add_explicit(&shm_ptr->daily_user_wakeups, now - *last_wakeups, memory_order_relaxed);
+    *last_wakeups = now;
+}
+
+#endif // USER_OPS_H
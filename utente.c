@@ -7,28 +7,26 @@
 #include <time.h>
 #include <sys/types.h>
 #include "config.h"
+#include "shm_layout.h"
+#include "shm_backend.h"
+#include "sim_model.h"
+#include "user_ops.h"
+#include "day_barrier.h"
 #include <sys/shm.h>
 #include <sys/ipc.h>
-#include <sys/sem.h>
-#include <sys/msg.h>
 #include <string.h>
 #include <errno.h>
 
 
 int user_id;
 SharedMemory *shm_ptr = NULL;
-volatile int day_started = 0;
 volatile int simulation_active = 1;
-volatile int arrival_time_reached = 0;
-int semid = -1;
-
-// Variabile globale per la coda di messaggi
-static int msgid = -1;
+unsigned int current_day = 0; // Ultima giornata vista (day_barrier.h)
 
 void cleanup_resources() {
     // Stacca la memoria condivisa
     if (shm_ptr != NULL && shm_ptr != (void *)-1) {
-        shmdt(shm_ptr);
+        shm_segment_detach(shm_ptr);
     }
 }
 
@@ -40,168 +38,29 @@ void end_simulation_handler(int signum __attribute__((unused)))
     exit(EXIT_SUCCESS);
 }
 
-// Gestore per il segnale di arrivo
-void arrival_time_handler(int signum __attribute__((unused)))
-{
-    arrival_time_reached = 1;
-}
-
-// Determina se l'utente arriva (e se arriva il servizio scelto)
-int determine_arrival_and_service(int personal_probability)
-{
-    // Lancia un dado da 1 a 100 per decidere se l'utente arriva
-    int arrival_roll = (rand() % 100) + 1;
-
-    // Se il tiro è maggiore della probabilità personale, l'utente non arriva
-    if (arrival_roll > personal_probability)
-    {
-        return -1; // -1 indica che l'utente non si presenta
-    }
-
-    // Se l'utente arriva, determina quale servizio desidera
-    int chosen_service = rand() % SERVICE_COUNT;
-    return chosen_service;
-}
-
-// Calcola la probabilità di arrivo personale per l'utente
-int calculate_personal_probability()
-{
-    if (P_SERV_MAX > 0 && P_SERV_MIN <= P_SERV_MAX)
-    {
-        return P_SERV_MIN + (rand() % (P_SERV_MAX - P_SERV_MIN + 1));
-    }
-    return 0;
-}
-
-// Calcola l'orario di arrivo in minuti (tra 0 e 479)
-int determine_arrival_time()
-{
-    //return 1;
-    return 1 + (rand() % (OFFICE_CLOSE_TIME - 1));
-}
-
-// Converti minuti simulati in nanosecondi per timer preciso
-long minutes_to_simulation_nanoseconds(int minutes)
-{
-    double seconds = ((double)minutes / WORK_DAY_MINUTES) * DAY_SIMULATION_TIME;
-    return (long)(seconds * 1000000000L); // Converti in nanosecondi
-}
-
-// Programma un timer per l'arrivo dell'utente
-int schedule_arrival_timer(int arrival_minute)
+// Aspetta il minuto di arrivo dormendo sulla barriera delle giornate fino
+// all'istante calcolato adesso (inizio giornata), al posto di un timer POSIX
+// con SIGALRM controllato a intervalli: l'utente si sveglia solo alla
+// scadenza o alla chiusura della giornata. Ritorna 1 se l'utente arriva,
+// 0 se la giornata finisce prima
+int wait_for_arrival(int arrival_minute)
 {
     long arrival_ns = minutes_to_simulation_nanoseconds(arrival_minute);
-    
-    // Crea un timer POSIX
-    timer_t timer_id;
-    struct sigevent sev;
-    struct itimerspec its;
-    
-    // Configura il segnale per il timer
-    sev.sigev_notify = SIGEV_SIGNAL;
-    sev.sigev_signo = SIGALRM;
-    sev.sigev_value.sival_ptr = &timer_id;
-    
-    if (timer_create(CLOCK_MONOTONIC, &sev, &timer_id) == -1) {
-        perror("timer_create failed");
-        return -1;
-    }
-    
-    // Configura il tempo di scadenza
-    its.it_value.tv_sec = arrival_ns / 1000000000L;
-    its.it_value.tv_nsec = arrival_ns % 1000000000L;
-    its.it_interval.tv_sec = 0;  // Timer singolo (non ripetuto)
-    its.it_interval.tv_nsec = 0;
-    
-    if (timer_settime(timer_id, 0, &its, NULL) == -1) {
-        perror("timer_settime failed");
-        timer_delete(timer_id);
-        return -1;
-    }
-    
-    return 0;
-}
-
-// Funzione per richiedere un ticket dal processo di gestione ticket
-int request_ticket(int user_id, int service_id)
-{
-    // Verifica se il processo ticket è attivo
-    if (shm_ptr == NULL || shm_ptr->ticket_pid <= 0)
-    {
-        return -1;
-    }
-
-    // Accesso alla coda di messaggi
-    if (msgid == -1)
-    {
-        msgid = msgget(MSG_QUEUE_KEY, 0666);
-        if (msgid == -1)
-        {
-            perror("User: msgget failed");
-            return -1;
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += arrival_ns / 1000000000L;
+    deadline.tv_nsec += arrival_ns % 1000000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    while (simulation_active && day_barrier_is_current(shm_ptr, current_day)) {
+        if (day_barrier_sleep_until(shm_ptr, current_day, NULL, 0, &deadline) == -1 && errno == ETIMEDOUT) {
+            return day_barrier_is_current(shm_ptr, current_day);
         }
     }
-
-    // Acquisisce il mutex per creare la richiesta in memoria condivisa
-    struct sembuf sem_op;
-    sem_op.sem_num = SEM_QUEUE;
-    sem_op.sem_op = -1; // Lock
-    sem_op.sem_flg = 0;
-
-    if (semop(semid, &sem_op, 1) < 0)
-    {
-        perror("Failed to acquire queue mutex");
-        return -1;
-    }
-
-    // Otteniamo l'indice di richiesta corrente e lo incrementiamo
-    int request_index = shm_ptr->next_request_index;
-    if (request_index >= MAX_REQUESTS) {
-        // Limite massimo di richieste raggiunto, errore e unlock
-        sem_op.sem_op = 1; // Unlock
-        semop(semid, &sem_op, 1);
-        return -1;
-    }
-    
-    // Incrementa l'indice per la prossima richiesta
-    shm_ptr->next_request_index++;
-
-    // Crea la richiesta in shared memory
-    TicketRequest *request = &(shm_ptr->ticket_requests[request_index]);
-    request->user_id = user_id;         // ID dell'utente
-    request->service_id = service_id;   // Servizio richiesto
-    request->status = REQUEST_PENDING;  // Indica che è in attesa del ticket
-    clock_gettime(CLOCK_MONOTONIC, &request->request_time); // Per statistiche
-    request->ticket_number = 0;
-    memset(request->ticket_id, 0, sizeof(request->ticket_id)); // Inizializza a vuoto
-
-    // Rilascio del mutex
-    sem_op.sem_op = 1; // Unlock
-    if (semop(semid, &sem_op, 1) < 0)
-    {
-        perror("Failed to release queue mutex");
-        return -1;
-    }
-
-    usleep(1000); // FIX per race condition
-
-    // Invia il messaggio di richiesta ticket
-    TicketRequestMsg msg;
-    msg.mtype = MSG_TICKET_REQUEST;
-    msg.user_id = user_id;
-    msg.service_id = service_id;
-    msg.request_index = request_index;  // Passa l'indice della richiesta
-    msg.request_time = time(NULL);
-    msg.user_pid = getpid();
-
-    // Invia il messaggio alla coda
-    if (msgsnd(msgid, &msg, sizeof(msg) - sizeof(long), 0) == -1)
-    {
-        perror("User: msgsnd failed");
-        return -1;
-    }
-
-    return request_index;
+    return 0;
 }
 
 // Gestione della visita all'ufficio postale
@@ -209,186 +68,49 @@ int handle_post_office_visit(int user_id, int service_id, int request_index)
 {
     if (shm_ptr == NULL)
     {
-        int shmid = shmget(SHM_KEY, sizeof(SharedMemory), 0666);
-        if (shmid == -1)
+        shm_ptr = shm_segment_attach("User");
+        if (shm_ptr == NULL)
         {
-            perror("User: shmget failed");
-            return -1;
-        }
-
-        shm_ptr = (SharedMemory *)shmat(shmid, NULL, 0);
-        if (shm_ptr == (void *)-1)
-        {
-            perror("User: shmdt failed");
             return -1;
         }
     }
 
-    // Registra un gestore di segnale temporaneo per SIGUSR1 come notifica da ticket
-    struct sigaction sa_ticket;
-    memset(&sa_ticket, 0, sizeof(sa_ticket));
-    sa_ticket.sa_handler = SIG_IGN; // Imposta l'handler a SIG_IGN per evitare la terminazione di default
-    sigemptyset(&sa_ticket.sa_mask);
-    sa_ticket.sa_flags = 0;
-    
-    if (sigaction(SIGUSR1, &sa_ticket, NULL) == -1) {
-        perror("User: sigaction for ticket signal failed");
-    }
-    
-    // Prepara il set di segnali per sigtimedwait
-    sigset_t wait_set;
-    sigemptyset(&wait_set);
-    sigaddset(&wait_set, SIGUSR1); // Segnale che indica ticket processato
-    sigaddset(&wait_set, SIGUSR2); // Segnale di fine giornata
-    
-    // Blocca temporaneamente questi segnali per usare sigwait
-    sigprocmask(SIG_BLOCK, &wait_set, NULL);
-    
-    // Imposta un timeout
-    struct timespec timeout;
-    timeout.tv_sec = 0;
-    timeout.tv_nsec = 200000000; // 200ms
-    
-    // Loop principale: attende SIGUSR1 (ticket) o SIGUSR2 (fine giornata)
-    while (shm_ptr->day_in_progress && simulation_active)
+    // Attende l'esito della richiesta dormendo sulla sua parola futex, che
+    // il processo ticket incrementa all'emissione, e sulla barriera delle
+    // giornate: nessun segnale e nessun controllo a intervalli
+    TicketRequest *request = &SHM_REQUESTS(shm_ptr)[request_index];
+    while (simulation_active)
     {
-        // Attende un segnale o il timeout
-        int sig = sigtimedwait(&wait_set, NULL, &timeout);
-        
-        // Controlla lo stato della richiesta dopo il segnale o il timeout
-        if (shm_ptr->ticket_requests[request_index].status == REQUEST_COMPLETED)
+        // La parola va letta prima dello stato: un'emissione successiva la
+        // cambia e fa ritornare subito l'attesa
+        unsigned int outcome_seen = atomic_load_explicit(&request->outcome_seq, memory_order_acquire);
+        RequestStatus status = __atomic_load_n(&request->status, __ATOMIC_ACQUIRE);
+
+        if (status == REQUEST_COMPLETED)
         {
-            // Ricevuto il ticket con successo (rimuove mascheramento)
-            sigprocmask(SIG_UNBLOCK, &wait_set, NULL);
-            return 0; 
+            // Ricevuto il ticket con successo
+            return 0;
         }
-        else if (shm_ptr->ticket_requests[request_index].status == REQUEST_REJECTED)
+        else if (status == REQUEST_REJECTED)
         {
             printf("\t[UTENTE %d] Richiesta ticket rifiutata\n", user_id);
-            sigprocmask(SIG_UNBLOCK, &wait_set, NULL);
             return -1;
         }
 
         // La giornata è finita, esci dal loop
-        if (sig == SIGUSR2 || !shm_ptr->day_in_progress) {
+        if (!day_barrier_is_current(shm_ptr, current_day)) {
             break;
         }
+        day_barrier_sleep(shm_ptr, current_day, &request->outcome_seq, outcome_seen);
     }
-   
-    // Break alla riga 228 -> contiamo come non servito (e non come tornato a casa)
-    struct sembuf sem_op;
-    sem_op.sem_num = SEM_MUTEX;
-    sem_op.sem_op = -1; // Lock
-    sem_op.sem_flg = 0;
-    
-    if (semop(semid, &sem_op, 1) == 0) {
-        // Utente non ha ricevuto il ticket entro la fine della giornata
-        if (shm_ptr->ticket_requests[request_index].status == REQUEST_PENDING ||
-            shm_ptr->ticket_requests[request_index].status == REQUEST_PROCESSING) {
-            shm_ptr->daily_users_no_ticket[service_id]++;
-            shm_ptr->total_users_no_ticket++;
-        } else {
-            printf("\t[UTENTE %d] Richiesta non elaborata o rifiutata alla fine della giornata\n", user_id);
-        }
-        
-        // Rilascia il mutex
-        sem_op.sem_op = 1; // Unlock
-        semop(semid, &sem_op, 1);
-    }
-    
-    // Sblocca i segnali prima di uscire (in caso di break dal loop)
-    sigprocmask(SIG_UNBLOCK, &wait_set, NULL);
-    return -1;
-}
-
-// Verifica disponibilità del servizio (sportello + operatore)
-int is_service_available(SharedMemory *shm, int service_id)
-{
-    for (int i = 0; i < NOF_WORKER_SEATS; i++)
-    {
-        // Controlla se lo sportello è attivo
-        if (shm->counters[i].active && shm->counters[i].current_service == (ServiceType)service_id)
-        {
-            // Controlla se c'è un operatore attivo
-            if (shm->counters[i].operator_pid > 0)
-            {
-                for (int j = 0; j < NOF_WORKERS; j++)
-                {
-                    if (shm->operators[j].active && shm->operators[j].pid == shm->counters[i].operator_pid)
-                    {
-                        return 1;
-                    }
-                }
-            }
-        }
-    }
-    return 0;
-}
-
-// Incrementa conteggio utenti tornati a casa senza servizio
-void increment_users_home_stats(int service_id) {
-
-    struct sembuf sem_op;
-    sem_op.sem_num = SEM_MUTEX;
-    sem_op.sem_op = -1; // Lock
-    sem_op.sem_flg = 0;
-    
-    if (semop(semid, &sem_op, 1) == 0) {
-        shm_ptr->daily_users_home[service_id]++;
-        shm_ptr->total_users_home++;
-        
-        // Rilascia il mutex
-        sem_op.sem_op = 1; // Unlock
-        semop(semid, &sem_op, 1);
-    }
-}
-
-// Incrementa conteggio utenti che non si sono presentati all'ufficio postale
-void increment_users_not_arrived_stats() {
-    struct sembuf sem_op;
-    sem_op.sem_num = SEM_MUTEX;
-    sem_op.sem_op = -1; // Lock
-    sem_op.sem_flg = 0;
-    
-    if (semop(semid, &sem_op, 1) == 0) {
-        // Non sappiamo quale servizio avrebbe scelto, quindi incrementiamo un servizio casuale
-        int random_service = rand() % SERVICE_COUNT;
-        shm_ptr->daily_users_not_arrived[random_service]++;
-        shm_ptr->total_users_not_arrived++;
-        shm_ptr->total_users_not_arrived_per_service[random_service]++;
-        
-        // Rilascia il mutex
-        sem_op.sem_op = 1; // Unlock
-        semop(semid, &sem_op, 1);
-    }
-}
-
-// Funzione di attesa per un segnale specifico con timeout
-void wait_for_signal(int signum, volatile int *condition) {
-    sigset_t wait_set;
-    sigemptyset(&wait_set);
-    sigaddset(&wait_set, signum);
-    sigaddset(&wait_set, SIGTERM);
-
-    sigset_t old_mask;
-    sigprocmask(SIG_BLOCK, &wait_set, &old_mask);
-
-    // Condition è day_in_progress_flag
-    while (*condition && simulation_active) {
-        struct timespec timeout = {.tv_sec = 0, .tv_nsec = 500000000}; // 500ms
-        int sig = sigtimedwait(&wait_set, NULL, &timeout);
 
-        if (sig == signum || !(*condition)) {
-            break;
-        } else if (sig == SIGTERM) {
-            simulation_active = 0;
-            break;
-        }
+    // Fine giornata senza ticket -> contiamo come non servito (e non come tornato a casa)
+    if (!increment_users_no_ticket_stats(request_index, service_id)) {
+        printf("\t[UTENTE %d] Richiesta non elaborata o rifiutata alla fine della giornata\n", user_id);
     }
-    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+    return -1;
 }
 
-
 int main(int argc, char *argv[])
 {
     if (argc < 2)
@@ -413,32 +135,17 @@ int main(int argc, char *argv[])
     signal(SIGUSR1, SIG_IGN);
     signal(SIGUSR2, SIG_IGN);
     signal(SIGTERM, end_simulation_handler);
-    signal(SIGALRM, arrival_time_handler); // Handler per il timer di arrivo
 
-    // Connessione alla memoria condivisa
-    int shmid = shmget(SHM_KEY, sizeof(SharedMemory), 0666);
-    if (shmid == -1)
-    {
-        perror("User: shmget failed");
-        exit(EXIT_FAILURE);
-    }
-
-    // Attacca la memoria condivisa
-    shm_ptr = (SharedMemory *)shmat(shmid, NULL, 0);
-    if (shm_ptr == (void *)-1)
+    // Attacca la memoria condivisa (SysV o POSIX, vedi shm_backend.h)
+    shm_ptr = shm_segment_attach("User");
+    if (shm_ptr == NULL)
     {
-        perror("User: shmat failed");
         exit(EXIT_FAILURE);
     }
 
-    // Accesso ai semafori
-    semid = semget(SEM_KEY, NUM_SEMS, 0666);
-    if (semid == -1)
-    {
-        perror("User: semget failed");
-        shmdt(shm_ptr);
-        exit(EXIT_FAILURE);
-    }
+    // Utente pronto: il direttore può proseguire
+    day_barrier_ready(shm_ptr);
+    long last_wakeups = user_wakeups();
 
     // ------------------------------------------------------------------------------
     // Simulazione principale
@@ -446,29 +153,12 @@ int main(int argc, char *argv[])
 
     while (simulation_active)
     {
-        day_started = 0;
-        
-        // Attende il segnale di inizio giornata (SIGUSR1) dal direttore
-        int day_in_progress_flag = !shm_ptr->day_in_progress;
-        wait_for_signal(SIGUSR1, &day_in_progress_flag);
+        // Attende l'apertura di una nuova giornata dal direttore: una sola
+        // volta per giornata, anche se questa finisce prima dell'arrivo
+        current_day = day_barrier_wait_open(shm_ptr, current_day, NULL, &simulation_active);
         
         if (!simulation_active) break;
         
-        // Semaforo per iniziare la giornata
-        struct sembuf sem_wait;
-        sem_wait.sem_num = SEM_DAY_START;
-        sem_wait.sem_op = -1;
-        sem_wait.sem_flg = 0;
-        
-        // Attendi sul semaforo
-        if (semop(semid, &sem_wait, 1) < 0) {
-            if (errno != EINTR) {  // Ignora se interrotto da segnale
-                perror("User: semop wait for day start failed");
-            }
-        }
-        
-        day_started = 1;
-        
         int service_id = determine_arrival_and_service(personal_arrival_probability);
 
         // Se service_id è >= 0, l'utente ha deciso di visitare l'ufficio postale
@@ -479,74 +169,34 @@ int main(int argc, char *argv[])
             // DEBUG: stampa info arrivo
             //printf("\t\t\t\t\t\t\t\t[UTENTE %d] Scheduled to arrive at minute %d on day %d for service: %s\n", user_id, arrival_minute, shm_ptr->simulation_day, SERVICE_NAMES[service_id]);
 
-            // Programma il timer per l'arrivo
-            arrival_time_reached = 0;
-            if (schedule_arrival_timer(arrival_minute) == 0) {
-                
-                // Aspetta il segnale di arrivo o la fine della giornata
-                sigset_t wait_set;
-                sigemptyset(&wait_set);
-                sigaddset(&wait_set, SIGALRM);  // Timer di arrivo
-                sigaddset(&wait_set, SIGUSR2);  // Fine giornata
-                sigaddset(&wait_set, SIGTERM);  // Terminazione
-                
-                // Blocca i segnali per sigtimedwait
-                sigprocmask(SIG_BLOCK, &wait_set, NULL);
-                
-                int visited = 0;
-                while (shm_ptr->day_in_progress && simulation_active && !visited) {
-                    struct timespec timeout = {.tv_sec = 0, .tv_nsec = 100000000}; // 100ms
-                    int sig = sigtimedwait(&wait_set, NULL, &timeout);
-                    
-                    if (sig == SIGALRM || arrival_time_reached) {
-                        // È ora di arrivare all'ufficio
-                        //printf("\t\t\t\t\t\t\t\t[UTENTE %d] Arrivato al minuto %d per il servizio %s\n", 
-                        //       user_id, arrival_minute, SERVICE_NAMES[service_id]);
-                        
-                        if (!is_service_available(shm_ptr, service_id)) {
-                            // Utente tornato a casa - servizio non disponibile
-                            increment_users_home_stats(service_id);
-                            visited = 1;
-                        } else {
-                            // Richiedi ticket
-                            int request_index = request_ticket(user_id, service_id);
-                            if (request_index >= 0) {
-                                int result = handle_post_office_visit(user_id, service_id, request_index);
-                                if (result < 0) {
-                                    // Errore nella gestione della visita
-                                    visited = 1;
-                                    if (!shm_ptr->day_in_progress) {
-                                        printf("[UTENTE %d] Non è stato possibile ricevere il biglietto per il servizio %s perché il giorno è terminato\n", user_id, SERVICE_NAMES[service_id]);
-                                    }
-                                } else {
-                                    // Successo
-                                    visited = 1;
-                                }
-                            } else {
-                                // Errore nella richiesta ticket
-                                visited = 1;
-                                increment_users_home_stats(service_id);
-                            }
+            // Aspetta l'ora di arrivo o la fine della giornata
+            if (wait_for_arrival(arrival_minute)) {
+                // È ora di arrivare all'ufficio
+                //printf("\t\t\t\t\t\t\t\t[UTENTE %d] Arrivato al minuto %d per il servizio %s\n", 
+                //       user_id, arrival_minute, SERVICE_NAMES[service_id]);
+
+                int available = is_service_available(shm_ptr, service_id);
+                flight_record(shm_ptr, FLIGHT_ARRIVAL, service_id, user_id, available, arrival_minute);
+                if (!available) {
+                    // Utente tornato a casa - servizio non disponibile
+                    increment_users_home_stats(service_id);
+                } else {
+                    // Richiedi ticket
+                    int request_index = request_ticket(user_id, service_id);
+                    if (request_index >= 0) {
+                        int result = handle_post_office_visit(user_id, service_id, request_index);
+                        release_ticket_request(request_index);
+                        if (result < 0 && !shm_ptr->day_in_progress) {
+                            printf("[UTENTE %d] Non è stato possibile ricevere il biglietto per il servizio %s perché il giorno è terminato\n", user_id, SERVICE_NAMES[service_id]);
                         }
-                        break;
-                    } else if (sig == SIGUSR2 || !shm_ptr->day_in_progress) {
-                        // DEBUG: Giornata terminata prima dell'arrivo
-                        //printf("\t[UTENTE %d] Non sono riuscito ad arrivare in tempo (arrivo previsto: minuto %d). Torno a casa.\n", user_id, arrival_minute);
+                    } else {
+                        // Errore nella richiesta ticket
                         increment_users_home_stats(service_id);
-                        visited = 1;
-                        break;
-                    } else if (sig == SIGTERM) {
-                        simulation_active = 0;
-                        break;
                     }
                 }
-                
-                // Ripristina la maschera dei segnali
-                sigprocmask(SIG_UNBLOCK, &wait_set, NULL);
-                
-            } else {
-                // Errore nella programmazione del timer
-                printf("[UTENTE %d] Errore nella programmazione del timer di arrivo. Torno a casa.\n", user_id);
+            } else if (simulation_active) {
+                // DEBUG: Giornata terminata prima dell'arrivo
+                //printf("\t[UTENTE %d] Non sono riuscito ad arrivare in tempo (arrivo previsto: minuto %d). Torno a casa.\n", user_id, arrival_minute);
                 increment_users_home_stats(service_id);
             }
         }
@@ -560,45 +210,11 @@ int main(int argc, char *argv[])
             increment_users_not_arrived_stats();
         }
         
-        // Segnale di inizio giornata mai ricevuto
-        if (!day_started && simulation_active) {
-            printf("[UTENTE %d] La giornata non è mai iniziata per me. Conteggiato come non servito.\n", user_id);
-            
-            increment_users_home_stats(service_id);
-        }
-
-        // Attende il segnale di fine giornata (SIGUSR2) dal direttore
-        if (shm_ptr->day_in_progress && simulation_active) {
-            
-            sigset_t day_end_set;
-            sigemptyset(&day_end_set);
-            sigaddset(&day_end_set, SIGUSR2);
-            sigaddset(&day_end_set, SIGTERM);
-            sigset_t old_mask;
-            sigprocmask(SIG_BLOCK, &day_end_set, &old_mask);
-            
-            // Aspetta segnale di fine giornata o terminazione
-            while (shm_ptr->day_in_progress && simulation_active) {
-                int sig;
-                struct timespec timeout;
-                timeout.tv_sec = 0;
-                timeout.tv_nsec = 20000000;  // 20 ms
-                
-                sig = sigtimedwait(&day_end_set, NULL, &timeout);
-                
-                if (sig == SIGUSR2 || !shm_ptr->day_in_progress) {
-                    day_started = 0;
-                    break;
-                }
-                else if (sig == SIGTERM) {
-                    // Gestisce la terminazione
-                    simulation_active = 0;
-                    break;
-                }
-            }
-            
-            sigprocmask(SIG_SETMASK, &old_mask, NULL);
-        }
+        // Attende la chiusura della giornata dal direttore e la conferma:
+        // da qui in poi l'utente non tocca più le statistiche della giornata
+        day_barrier_wait_close(shm_ptr, current_day, NULL, &simulation_active);
+        record_user_wakeups(&last_wakeups);
+        day_barrier_done(shm_ptr);
     }
 
     cleanup_resources();
@@ -0,0 +1,231 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/types.h>
+#include "config.h"
+#include "shm_layout.h"
+#include "shm_backend.h"
+#include "sim_model.h"
+#include "user_ops.h"
+#include "timer_wheel.h"
+#include "day_barrier.h"
+#include <sys/shm.h>
+#include <sys/ipc.h>
+
+// Host degli utenti: un unico processo simula l'intera popolazione.
+// Gli arrivi della giornata sono timer in un timer wheel gerarchico con
+// risoluzione di 1ms, quindi memoria e carico sullo scheduler crescono con il
+// numero di eventi e non con il numero di processi. Tra un arrivo e l'altro
+// l'host dorme sulla barriera delle giornate (day_barrier.h): lo svegliano
+// solo il prossimo arrivo o la chiusura della giornata.
+
+#define HOST_TICK_NS 1000000L       // Durata di un tick della ruota (1ms)
+
+// Stato di un utente simulato. Il nodo del timer è il primo campo, così dal
+// nodo scaduto si risale direttamente all'utente
+typedef struct {
+    TimerNode arrival_timer;    // Timer di arrivo all'ufficio
+    int personal_probability;   // Probabilità personale di presentarsi
+    int service_id;             // Servizio scelto per la giornata
+    int request_index;          // Richiesta ticket della giornata (-1 se nessuna)
+} HostedUser;
+
+SharedMemory *shm_ptr = NULL;
+volatile int simulation_active = 1;
+
+HostedUser *users = NULL;
+int *pending_users = NULL;      // Utenti con richiesta ticket inviata nella giornata
+int pending_count = 0;
+TimerWheel wheel;
+struct timespec day_start;
+
+void cleanup_resources() {
+    free(users);
+    free(pending_users);
+    // Stacca la memoria condivisa
+    if (shm_ptr != NULL && shm_ptr != (void *)-1) {
+        shm_segment_detach(shm_ptr);
+    }
+}
+
+// Gestore per la terminazione della simulazione
+void end_simulation_handler(int signum __attribute__((unused)))
+{
+    simulation_active = 0;
+    cleanup_resources();
+    exit(EXIT_SUCCESS);
+}
+
+// Tick correnti dall'inizio della giornata
+unsigned long current_tick()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long elapsed_ns = (now.tv_sec - day_start.tv_sec) * 1000000000L + (now.tv_nsec - day_start.tv_nsec);
+    return elapsed_ns / HOST_TICK_NS;
+}
+
+// Dorme sulla barriera fino al tick indicato (orologio assoluto, niente
+// deriva) o alla chiusura della giornata. Con la ruota vuota (~0UL) resta
+// solo la chiusura
+void sleep_until_tick(unsigned int day, unsigned long tick)
+{
+    if (tick == ~0UL) {
+        day_barrier_sleep(shm_ptr, day, NULL, 0);
+        return;
+    }
+
+    long offset_ns = (long)tick * HOST_TICK_NS;
+    struct timespec deadline;
+    deadline.tv_sec = day_start.tv_sec + offset_ns / 1000000000L;
+    deadline.tv_nsec = day_start.tv_nsec + offset_ns % 1000000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    day_barrier_sleep_until(shm_ptr, day, NULL, 0, &deadline);
+}
+
+// Arrivo di un utente all'ufficio postale
+void handle_arrival(int user_id)
+{
+    HostedUser *user = &users[user_id];
+
+    int available = shm_ptr->day_in_progress && is_service_available(shm_ptr, user->service_id);
+    flight_record(shm_ptr, FLIGHT_ARRIVAL, user->service_id, user_id, available, -1);
+    if (!available) {
+        // Utente tornato a casa - servizio non disponibile o giornata finita
+        increment_users_home_stats(user->service_id);
+        return;
+    }
+
+    user->request_index = request_ticket(user_id, user->service_id);
+    if (user->request_index < 0) {
+        // Errore nella richiesta ticket
+        increment_users_home_stats(user->service_id);
+        return;
+    }
+    pending_users[pending_count++] = user_id;
+}
+
+// Chiude la giornata: chi non è ancora arrivato torna a casa, chi è in attesa
+// del ticket viene contato come senza ticket
+void close_day()
+{
+    int not_arrived_in_time = 0;
+    int no_ticket = 0;
+
+    for (int i = 0; i < NOF_USERS; i++) {
+        if (tw_pending(&users[i].arrival_timer)) {
+            tw_del(&wheel, &users[i].arrival_timer);
+            increment_users_home_stats(users[i].service_id);
+            not_arrived_in_time++;
+        }
+    }
+    for (int i = 0; i < pending_count; i++) {
+        HostedUser *user = &users[pending_users[i]];
+        no_ticket += increment_users_no_ticket_stats(user->request_index, user->service_id);
+        release_ticket_request(user->request_index);
+    }
+
+    if (not_arrived_in_time > 0 || no_ticket > 0) {
+        printf("[UTENTI] Fine giornata: %d utenti non arrivati in tempo, %d senza ticket\n", not_arrived_in_time, no_ticket);
+    }
+}
+
+// Simula la giornata day di tutti gli utenti, fino alla chiusura decisa dal direttore
+void run_day(unsigned int day)
+{
+    clock_gettime(CLOCK_MONOTONIC, &day_start);
+    tw_init(&wheel, 0);
+    pending_count = 0;
+
+    // Stesse decisioni del processo utente: arrivo, servizio e minuto di arrivo
+    for (int i = 0; i < NOF_USERS; i++) {
+        HostedUser *user = &users[i];
+        user->request_index = -1;
+        user->service_id = determine_arrival_and_service(user->personal_probability);
+        if (user->service_id < 0) {
+            increment_users_not_arrived_stats();
+            continue;
+        }
+        long arrival_ns = minutes_to_simulation_nanoseconds(determine_arrival_time());
+        tw_add(&wheel, &user->arrival_timer, arrival_ns / HOST_TICK_NS);
+    }
+
+    // La fine giornata la decide il direttore: l'attesa sulla barriera
+    // termina appena la chiude, senza ricontrolli periodici
+    while (simulation_active && day_barrier_is_current(shm_ptr, day)) {
+        TimerNode *expired = tw_advance(&wheel, current_tick());
+        TimerNode *node;
+
+        while ((node = tw_pop_expired(&expired)) != NULL) {
+            handle_arrival((int)((HostedUser *)node - users));
+        }
+
+        sleep_until_tick(day, tw_next_expiry(&wheel));
+    }
+
+    close_day();
+}
+
+int main()
+{
+    // Carica la configurazione dalla variabile d'ambiente
+    const char* config_file = getenv("SO_CONFIG_FILE");
+    if (!config_file) config_file = "timeout.conf"; // default
+    read_config(config_file);
+
+    // Seme per il generatore di numeri casuali
+    srand(getpid() ^ time(NULL));
+
+    // Impostazione gestori di segnale: l'host controlla da sé l'esito delle
+    // richieste in memoria condivisa, il processo ticket non lo sveglia
+    signal(SIGUSR2, SIG_IGN);
+    signal(SIGTERM, end_simulation_handler);
+
+    users = calloc(NOF_USERS, sizeof(HostedUser));
+    pending_users = malloc(NOF_USERS * sizeof(int));
+    if (users == NULL || pending_users == NULL) {
+        perror("User host: malloc failed");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < NOF_USERS; i++) {
+        users[i].personal_probability = calculate_personal_probability();
+    }
+
+    // Attacca la memoria condivisa (SysV o POSIX, vedi shm_backend.h)
+    shm_ptr = shm_segment_attach("User host");
+    if (shm_ptr == NULL)
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    printf("[UTENTI] Host avviato: %d utenti simulati in un solo processo\n", NOF_USERS);
+    day_barrier_ready(shm_ptr);
+    long last_wakeups = user_wakeups();
+
+    // ------------------------------------------------------------------------------
+    // Simulazione principale
+    // ------------------------------------------------------------------------------
+
+    // Una giornata alla volta: l'host dorme sulla barriera (day_barrier.h)
+    // fino all'apertura della successiva
+    unsigned int current_day = 0;
+    while (simulation_active)
+    {
+        current_day = day_barrier_wait_open(shm_ptr, current_day, NULL, &simulation_active);
+        if (!simulation_active) break;
+
+        run_day(current_day);
+        record_user_wakeups(&last_wakeups);
+        day_barrier_done(shm_ptr);
+    }
+
+    cleanup_resources();
+    return 0;
+}
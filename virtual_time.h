@@ -0,0 +1,481 @@
+#ifndef VIRTUAL_TIME_H
+#define VIRTUAL_TIME_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "config.h"
+#include "sim_model.h"
+#include "statistics.h"
+#include "counter_balance.h"
+
+// Motore a eventi discreti per la modalità --virtual-time del direttore.
+// Il modello è lo stesso dei processi reali (sportelli, code per servizio,
+// pause, soglia di esplosione) ma l'orologio salta da un evento al successivo
+// invece di dormire. Il tempo virtuale è espresso negli stessi nanosecondi
+// della simulazione reale (DAY_SIMULATION_TIME secondi per giornata), quindi
+// le statistiche in memoria condivisa restano confrontabili.
+
+// Intervallo del controllo di esplosione (come il loop del direttore)
+#define VT_EXPLODE_CHECK_NS 100000000L
+
+typedef enum {
+    VT_EVENT_USER_ARRIVAL,   // Un utente arriva all'ufficio postale
+    VT_EVENT_SERVICE_END,    // Un operatore termina il servizio corrente
+    VT_EVENT_EXPLODE_CHECK,  // Controllo periodico della soglia di esplosione
+    VT_EVENT_REBALANCE       // Ribilanciamento periodico degli sportelli
+} VirtualEventType;
+
+typedef struct {
+    long time_ns;            // Istante virtuale dell'evento
+    long seq;                // Ordine di inserimento (a parità di istante)
+    VirtualEventType type;
+    int id;                  // Utente o operatore coinvolto
+    int service_id;          // Servizio richiesto (solo per gli arrivi)
+} VirtualEvent;
+
+typedef struct {
+    VirtualEvent *heap;      // Coda di priorità (min-heap su time_ns, seq)
+    int size;
+    int capacity;
+    long next_seq;
+    long now_ns;             // Orologio virtuale corrente
+
+    int *user_probability;   // Probabilità personale di arrivo di ogni utente
+    int *operator_counter;   // Sportello occupato da ogni operatore (-1 se nessuno)
+    int *operator_ticket;    // Richiesta in servizio (-1 se libero)
+    int rebalance_served[SERVICE_COUNT]; // Ticket serviti all'ultimo ribilanciamento
+
+    long events_processed;   // Eventi elaborati nell'ultima giornata
+} VirtualEngine;
+
+VirtualEngine virtual_engine = {0};
+
+void vt_init(SharedMemory *shm);
+int vt_run_day(SharedMemory *shm);
+void vt_destroy();
+
+// Implementazione delle funzioni
+
+// Confronto tra eventi: prima il più vicino nel tempo, poi il più vecchio
+int vt_event_before(const VirtualEvent *a, const VirtualEvent *b)
+{
+    if (a->time_ns != b->time_ns) {
+        return a->time_ns < b->time_ns;
+    }
+    return a->seq < b->seq;
+}
+
+void vt_schedule(long time_ns, VirtualEventType type, int id, int service_id)
+{
+    VirtualEngine *vt = &virtual_engine;
+
+    if (vt->size == vt->capacity) {
+        int new_capacity = vt->capacity > 0 ? vt->capacity * 2 : 1024;
+        VirtualEvent *new_heap = realloc(vt->heap, new_capacity * sizeof(VirtualEvent));
+        if (new_heap == NULL) {
+            perror("Virtual time: realloc event heap failed");
+            exit(EXIT_FAILURE);
+        }
+        vt->heap = new_heap;
+        vt->capacity = new_capacity;
+    }
+
+    // Inserimento in fondo e risalita
+    int pos = vt->size++;
+    VirtualEvent ev = { time_ns, vt->next_seq++, type, id, service_id };
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (!vt_event_before(&ev, &vt->heap[parent])) {
+            break;
+        }
+        vt->heap[pos] = vt->heap[parent];
+        pos = parent;
+    }
+    vt->heap[pos] = ev;
+}
+
+VirtualEvent vt_pop()
+{
+    VirtualEngine *vt = &virtual_engine;
+    VirtualEvent top = vt->heap[0];
+    VirtualEvent last = vt->heap[--vt->size];
+
+    // Discesa dell'ultimo elemento dalla radice
+    int pos = 0;
+    while (1) {
+        int child = 2 * pos + 1;
+        if (child >= vt->size) {
+            break;
+        }
+        if (child + 1 < vt->size && vt_event_before(&vt->heap[child + 1], &vt->heap[child])) {
+            child++;
+        }
+        if (!vt_event_before(&vt->heap[child], &last)) {
+            break;
+        }
+        vt->heap[pos] = vt->heap[child];
+        pos = child;
+    }
+    if (vt->size > 0) {
+        vt->heap[pos] = last;
+    }
+    return top;
+}
+
+// Inizializza operatori e utenti una volta per tutta la simulazione,
+// come fanno i processi reali al loro avvio
+void vt_init(SharedMemory *shm)
+{
+    VirtualEngine *vt = &virtual_engine;
+
+    vt->user_probability = malloc(NOF_USERS * sizeof(int));
+    vt->operator_counter = malloc(NOF_WORKERS * sizeof(int));
+    vt->operator_ticket = malloc(NOF_WORKERS * sizeof(int));
+    if (!vt->user_probability || !vt->operator_counter || !vt->operator_ticket) {
+        perror("Virtual time: malloc failed");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < NOF_WORKERS; i++) {
+        // PID virtuale (indice + 1): non esiste un processo reale
+        SHM_OPERATORS(shm)[i].pid = i + 1;
+        SHM_OPERATORS(shm)[i].current_service = rand() % SERVICE_COUNT;
+        SHM_OPERATORS(shm)[i].skills = assign_operator_skills(SHM_OPERATORS(shm)[i].current_service);
+        SHM_OPERATORS(shm)[i].active = 1;
+        SHM_OPERATORS(shm)[i].total_served = 0;
+        SHM_OPERATORS(shm)[i].total_pauses = 0;
+        SHM_OPERATORS(shm)[i].status = OPERATOR_WAITING;
+    }
+
+    for (int i = 0; i < NOF_USERS; i++) {
+        vt->user_probability[i] = calculate_personal_probability();
+    }
+}
+
+void vt_destroy()
+{
+    VirtualEngine *vt = &virtual_engine;
+    free(vt->heap);
+    free(vt->user_probability);
+    free(vt->operator_counter);
+    free(vt->operator_ticket);
+    memset(vt, 0, sizeof(*vt));
+}
+
+void vt_try_serve(SharedMemory *shm, int op_id);
+void vt_counter_handover(SharedMemory *shm, int op_id);
+
+// Un operatore senza sportello ne prende uno libero del suo servizio o si
+// mette in coda (come acquire_counter())
+void vt_seat_operator(SharedMemory *shm, int op_id)
+{
+    VirtualEngine *vt = &virtual_engine;
+    Operator *op = &SHM_OPERATORS(shm)[op_id];
+
+    int counter_id = counter_free_pop(shm, op->current_service);
+    if (counter_id < 0) {
+        op->status = OPERATOR_WAITING;
+        waiting_operator_enqueue(shm, op_id);
+        return;
+    }
+    counter_staff(shm, counter_id, op->pid);
+    op->counter_id = counter_id;
+    op->status = OPERATOR_WORKING;
+    vt->operator_counter[op_id] = counter_id;
+    vt_try_serve(shm, op_id);
+}
+
+// Consegna lo sportello liberato al primo operatore in coda (come
+// release_counter()), che inizia subito a servire
+void vt_handoff_counter(SharedMemory *shm, int counter_id)
+{
+    VirtualEngine *vt = &virtual_engine;
+
+    int next_op = counter_handoff(shm, counter_id);
+    if (next_op >= 0) {
+        vt->operator_counter[next_op] = counter_id;
+        vt_try_serve(shm, next_op);
+    }
+}
+
+// L'operatore lascia il proprio sportello
+void vt_release_counter(SharedMemory *shm, int op_id)
+{
+    VirtualEngine *vt = &virtual_engine;
+    int counter_id = vt->operator_counter[op_id];
+
+    vt->operator_counter[op_id] = -1;
+    SHM_OPERATORS(shm)[op_id].counter_id = -1;
+    vt_handoff_counter(shm, counter_id);
+}
+
+// Un operatore libero allo sportello prende il prossimo ticket del suo
+// servizio o, se la coda è vuota, ne ruba uno (come serve_customer())
+void vt_try_serve(SharedMemory *shm, int op_id)
+{
+    VirtualEngine *vt = &virtual_engine;
+    int service = SHM_OPERATORS(shm)[op_id].current_service;
+
+    if (SHM_OPERATORS(shm)[op_id].status != OPERATOR_WORKING || vt->operator_ticket[op_id] >= 0) {
+        return;
+    }
+    if (service_queue_length(shm, service) <= 0) {
+        service = steal_candidate_service(shm, op_id);
+        if (service < 0) {
+            return;
+        }
+    }
+
+    // Probabilità di pausa prima di servire l'utente
+    if (shm->total_pauses_simulation < NOF_PAUSE && (rand() % 100) < BREAK_PROBABILITY) {
+        SHM_OPERATORS(shm)[op_id].total_pauses++;
+        shm->total_pauses_simulation++;
+        SHM_OPERATORS(shm)[op_id].status = OPERATOR_ON_BREAK;
+
+        // Libera lo sportello per un operatore in attesa
+        vt_release_counter(shm, op_id);
+        return;
+    }
+
+    int ticket_idx;
+    if (!service_queue_pop(shm, service, &ticket_idx)) {
+        return;
+    }
+
+    TicketRequest *ticket = &SHM_REQUESTS(shm)[ticket_idx];
+    ticket->being_served = 1;
+    ticket->serving_operator_pid = SHM_OPERATORS(shm)[op_id].pid;
+    ticket->service_start_time.tv_sec = vt->now_ns / 1000000000L;
+    ticket->service_start_time.tv_nsec = vt->now_ns % 1000000000L;
+    ticket->wait_time_ns = (ticket->service_start_time.tv_sec - ticket->request_time.tv_sec) * 1000000000L +
+                           (ticket->service_start_time.tv_nsec - ticket->request_time.tv_nsec);
+
+    vt->operator_ticket[op_id] = ticket_idx;
+    vt_schedule(vt->now_ns + calculate_random_service_time(service), VT_EVENT_SERVICE_END, op_id, service);
+}
+
+// Arrivo dell'utente: controllo disponibilità, emissione ticket e accodamento
+void vt_handle_arrival(SharedMemory *shm, int user_id, int service_id)
+{
+    VirtualEngine *vt = &virtual_engine;
+
+    if (!atomic_load_explicit(&shm->service_available[service_id], memory_order_relaxed)) {
+        shm->daily_users_home[service_id]++;
+        shm->total_users_home++;
+        return;
+    }
+
+    // Nessun utente attende l'esito: lo slot ha solo il riferimento del sistema
+    int request_index = request_alloc(shm, REQUEST_REFS_SYSTEM);
+    if (request_index < 0) {
+        shm->daily_users_home[service_id]++;
+        shm->total_users_home++;
+        return;
+    }
+
+    // L'emissione del ticket è istantanea nel tempo virtuale
+    TicketRequest *request = &SHM_REQUESTS(shm)[request_index];
+    request->user_id = user_id;
+    request->service_id = service_id;
+    request->request_time.tv_sec = vt->now_ns / 1000000000L;
+    request->request_time.tv_nsec = vt->now_ns % 1000000000L;
+    request->ticket_number = shm->ticketing[service_id].next_ticket++;
+    snprintf(request->ticket_id, sizeof(request->ticket_id), "%c%d",
+             SERVICE_PREFIXES[service_id], request->ticket_number);
+    request->status = REQUEST_COMPLETED;
+
+    if (!service_queue_push(shm, service_id, request_index)) {
+        request_release(shm, request_index);
+        return;
+    }
+    shm->ticketing[service_id].daily_issued++;
+
+    // Il primo operatore libero del servizio prende il ticket; se sono tutti
+    // occupati e la coda supera la soglia, un operatore libero che sa erogare
+    // il servizio lo ruba
+    for (int op_id = 0; op_id < NOF_WORKERS && service_queue_length(shm, service_id) > 0; op_id++) {
+        if ((int)SHM_OPERATORS(shm)[op_id].current_service == service_id) {
+            vt_try_serve(shm, op_id);
+        }
+    }
+    for (int op_id = 0; op_id < NOF_WORKERS && service_queue_length(shm, service_id) >= STEAL_THRESHOLD; op_id++) {
+        if ((int)SHM_OPERATORS(shm)[op_id].current_service != service_id &&
+            (SHM_OPERATORS(shm)[op_id].skills & (1 << service_id))) {
+            vt_try_serve(shm, op_id);
+        }
+    }
+}
+
+void vt_handle_service_end(SharedMemory *shm, int op_id)
+{
+    VirtualEngine *vt = &virtual_engine;
+    TicketRequest *ticket = &SHM_REQUESTS(shm)[vt->operator_ticket[op_id]];
+    int service = ticket->service_id; // Diverso da quello dell'operatore se il ticket è rubato
+    long start_ns = ticket->service_start_time.tv_sec * 1000000000L + ticket->service_start_time.tv_nsec;
+
+    record_completed_service(shm, op_id, service, ticket->wait_time_ns, vt->now_ns - start_ns);
+
+    ticket->counter_id = vt->operator_counter[op_id];
+    ticket->served_successfully = 1;
+    ticket->being_served = 0;
+    ticket->serving_operator_pid = 0;
+    request_release(shm, vt->operator_ticket[op_id]);
+    vt->operator_ticket[op_id] = -1;
+
+    if (SHM_COUNTERS(shm)[vt->operator_counter[op_id]].handover_to != 0) {
+        vt_counter_handover(shm, op_id);
+        return;
+    }
+    vt_try_serve(shm, op_id);
+}
+
+// L'operatore lascia lo sportello passato a un altro servizio (come
+// handle_counter_handover()): lo sportello va a un operatore in coda del
+// nuovo servizio e l'operatore cerca un altro sportello del proprio
+void vt_counter_handover(SharedMemory *shm, int op_id)
+{
+    VirtualEngine *vt = &virtual_engine;
+    Counter *counter = &SHM_COUNTERS(shm)[vt->operator_counter[op_id]];
+
+    counter_unstaff(shm, vt->operator_counter[op_id]);
+    counter->current_service = counter->handover_to - 1;
+    counter->handover_to = 0;
+    vt_release_counter(shm, op_id);
+    vt_seat_operator(shm, op_id);
+}
+
+// Ribilanciamento degli sportelli (come rebalance_counters() del direttore).
+// Lo sportello di un operatore libero cambia servizio subito
+void vt_rebalance(SharedMemory *shm)
+{
+    VirtualEngine *vt = &virtual_engine;
+    int recent_served[SERVICE_COUNT];
+    for (int s = 0; s < SERVICE_COUNT; s++) {
+        int served = operator_stats_served(shm, s);
+        recent_served[s] = served - vt->rebalance_served[s];
+        vt->rebalance_served[s] = served;
+    }
+
+    int counter_id, service;
+    if (!rebalance_pick_move(shm, recent_served, &counter_id, &service)) {
+        return;
+    }
+    shm->daily_counter_moves++;
+    shm->total_counter_moves++;
+
+    Counter *counter = &SHM_COUNTERS(shm)[counter_id];
+    if (counter->operator_pid == 0) {
+        counter_free_remove(shm, counter_id);
+        counter->current_service = service;
+        vt_handoff_counter(shm, counter_id);
+        return;
+    }
+    counter->handover_to = service + 1;
+    int op_id = counter->operator_pid - 1; // PID virtuale = indice + 1
+    if (vt->operator_ticket[op_id] < 0) {
+        vt_counter_handover(shm, op_id);
+    }
+}
+
+// Simula un'intera giornata lavorativa. Ritorna -1 se la soglia di
+// esplosione viene superata (lo stato resta quello del momento del superamento)
+int vt_run_day(SharedMemory *shm)
+{
+    VirtualEngine *vt = &virtual_engine;
+    const long day_length_ns = (long)DAY_SIMULATION_TIME * 1000000000L;
+
+    vt->size = 0;
+    vt->now_ns = 0;
+    vt->events_processed = 0;
+
+    // Reset giornaliero della numerazione ticket (come il direttore): gli slot
+    // delle richieste tornano al pool man mano che vengono serviti
+    for (int i = 0; i < SERVICE_COUNT; i++) {
+        shm->ticketing[i].next_ticket = 1;
+    }
+
+    // Gli operatori tornano dalla pausa e cercano uno sportello del loro servizio
+    for (int op_id = 0; op_id < NOF_WORKERS; op_id++) {
+        SHM_OPERATORS(shm)[op_id].status = OPERATOR_WAITING;
+        vt->operator_counter[op_id] = -1;
+        vt->operator_ticket[op_id] = -1;
+    }
+    for (int op_id = 0; op_id < NOF_WORKERS; op_id++) {
+        vt_seat_operator(shm, op_id);
+    }
+
+    // Ogni utente decide se e quando presentarsi
+    for (int user_id = 0; user_id < NOF_USERS; user_id++) {
+        int service_id = determine_arrival_and_service(vt->user_probability[user_id]);
+        if (service_id >= 0) {
+            int arrival_minute = determine_arrival_time();
+            vt_schedule(minutes_to_simulation_nanoseconds(arrival_minute), VT_EVENT_USER_ARRIVAL, user_id, service_id);
+        } else {
+            int random_service = rand() % SERVICE_COUNT;
+            shm->daily_users_not_arrived[random_service]++;
+            shm->total_users_not_arrived++;
+            shm->total_users_not_arrived_per_service[random_service]++;
+        }
+    }
+
+    vt_schedule(VT_EXPLODE_CHECK_NS, VT_EVENT_EXPLODE_CHECK, 0, 0);
+    const long rebalance_interval_ns = REBALANCE_INTERVAL > 0 ? minutes_to_simulation_nanoseconds(REBALANCE_INTERVAL) : 0;
+    memset(vt->rebalance_served, 0, sizeof(vt->rebalance_served));
+    if (rebalance_interval_ns > 0) {
+        vt_schedule(rebalance_interval_ns, VT_EVENT_REBALANCE, 0, 0);
+    }
+
+    int exploded = 0;
+    while (vt->size > 0 && !exploded) {
+        VirtualEvent ev = vt_pop();
+        if (ev.time_ns > day_length_ns) {
+            break; // Gli eventi oltre la chiusura non avvengono
+        }
+        vt->now_ns = ev.time_ns;
+        vt->events_processed++;
+
+        switch (ev.type) {
+        case VT_EVENT_USER_ARRIVAL:
+            vt_handle_arrival(shm, ev.id, ev.service_id);
+            break;
+        case VT_EVENT_SERVICE_END:
+            vt_handle_service_end(shm, ev.id);
+            break;
+        case VT_EVENT_EXPLODE_CHECK: {
+            if (count_waiting_users(shm) > EXPLODE_THRESHOLD) {
+                exploded = 1;
+            } else if (vt->now_ns + VT_EXPLODE_CHECK_NS <= day_length_ns) {
+                vt_schedule(vt->now_ns + VT_EXPLODE_CHECK_NS, VT_EVENT_EXPLODE_CHECK, 0, 0);
+            }
+            break;
+        }
+        case VT_EVENT_REBALANCE:
+            vt_rebalance(shm);
+            if (vt->now_ns + rebalance_interval_ns <= day_length_ns) {
+                vt_schedule(vt->now_ns + rebalance_interval_ns, VT_EVENT_REBALANCE, 0, 0);
+            }
+            break;
+        }
+    }
+
+    // Fine giornata: i servizi in corso restano interrotti, gli sportelli si liberano
+    for (int op_id = 0; op_id < NOF_WORKERS; op_id++) {
+        SHM_OPERATORS(shm)[op_id].status = OPERATOR_FINISHED;
+        if (vt->operator_ticket[op_id] >= 0) {
+            SHM_REQUESTS(shm)[vt->operator_ticket[op_id]].being_served = 0;
+            SHM_REQUESTS(shm)[vt->operator_ticket[op_id]].serving_operator_pid = 0;
+            request_release(shm, vt->operator_ticket[op_id]);
+            vt->operator_ticket[op_id] = -1;
+        }
+    }
+    for (int i = 0; i < NOF_WORKER_SEATS; i++) {
+        counter_unstaff(shm, i);
+    }
+    vt->size = 0;
+
+    return exploded ? -1 : 0;
+}
+
+#endif // VIRTUAL_TIME_H